@@ -58,6 +58,18 @@ namespace UnrealBuildTool.Rules
                 PublicDelayLoadDLLs.Add("Decklink64.dll");
                 PublicDelayLoadDLLs.Add("DeckLinkAPI64.dll");
             }
+            else if (Target.Platform == UnrealTargetPlatform.Linux)
+            {
+                // headers of the Linux SDK, the driver's libDeckLinkAPI.so is opened at runtime by the SDK's dispatch code
+                string SdkIncludeDir = Path.Combine(SdiDir, "DeckLinkSDK", "Linux", "include");
+                if (!Directory.Exists(SdkIncludeDir))
+                {
+                    System.Console.WriteLine("DeckLinkMedia needs the include directory of the DeckLink SDK 10.8 for Linux in " + SdkIncludeDir);
+                }
+                PrivateIncludePaths.Add(SdkIncludeDir);
+                PublicAdditionalLibraries.Add("dl");
+                PublicAdditionalLibraries.Add("pthread");
+            }
             else
             {
                 System.Console.WriteLine("DeckLinkMedia does not supported this platform");
@@ -21,6 +21,10 @@
 #pragma warning( disable: 4049 )  /* more than 64k source lines */
 
 #include "DeckLinkMediaPrivate.h"
+
+// the Linux SDK defines its interface IDs in its headers
+#if PLATFORM_WINDOWS
+
 #include "DeckLinkAPI_h.h"
 
 #ifdef __cplusplus
@@ -374,5 +378,4 @@ MIDL_DEFINE_GUID(IID, IID_IDeckLinkInput_v7_1,0x2B54EDEF,0x5B32,0x429F,0xBA,0x11
 }
 #endif
 
-
-
+#endif // PLATFORM_WINDOWS
@@ -0,0 +1,165 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkAncillary.h"
+#include "DeckLinkPixelConversion.h"
+
+#include <cstring>
+
+void DeckLinkAncillaryBuffer::Reserve( size_t capacity )
+{
+	if( capacity > mCapacity.load( std::memory_order_relaxed ) ) {
+		mData.reset( new uint8_t[capacity] );
+		mCapacity.store( capacity, std::memory_order_relaxed );
+	}
+	Clear();
+}
+
+bool DeckLinkAncillaryBuffer::Append( const DeckLinkAncillaryPacket& header, const uint8_t* data )
+{
+	const size_t bytes = sizeof( DeckLinkAncillaryPacket ) + header.dataCount;
+	if( mSize + bytes > mCapacity.load( std::memory_order_relaxed ) )
+		return false;
+
+	memcpy( mData.get() + mSize, &header, sizeof( DeckLinkAncillaryPacket ) );
+	memcpy( mData.get() + mSize + sizeof( DeckLinkAncillaryPacket ), data, header.dataCount );
+	mSize += bytes;
+	++mPacketCount;
+	return true;
+}
+
+DeckLinkAncillaryReader::DeckLinkAncillaryReader()
+	: mFirstLine{ DefaultFirstLine }
+	, mLastLine{ DefaultLastLine }
+	, mPackets{ 0 }
+	, mFiltered{ 0 }
+	, mChecksumErrors{ 0 }
+	, mOverflows{ 0 }
+{ }
+
+void DeckLinkAncillaryReader::SetLines( uint32_t firstLine, uint32_t lastLine )
+{
+	mFirstLine = FMath::Max<uint32_t>( firstLine, 1 );
+	mLastLine = FMath::Max( lastLine, mFirstLine );
+}
+
+void DeckLinkAncillaryReader::Prepare( long width )
+{
+	// whole v210 groups, so unpacking never has to stop mid group
+	mWords.resize( DeckLinkPixelConversion::GetV210RowBytes( width ) / 16 * 12 );
+}
+
+bool DeckLinkAncillaryReader::Accepts( uint8_t did, uint8_t sdid ) const
+{
+	if( mFilters.empty() )
+		return true;
+
+	for( const DeckLinkAncillaryFilter& filter : mFilters ) {
+		if( filter.Matches( did, sdid ) )
+			return true;
+	}
+	return false;
+}
+
+void DeckLinkAncillaryReader::Read( IDeckLinkVideoInputFrame* frame, DeckLinkAncillaryBuffer& buffer )
+{
+	buffer.Clear();
+
+	IDeckLinkVideoFrameAncillary* ancillary = NULL;
+	if( frame->GetAncillaryData( &ancillary ) != S_OK || ancillary == NULL )
+		return;
+
+	if( ancillary->GetPixelFormat() == bmdFormat10BitYUV ) {
+		const long width = frame->GetWidth();
+		const uint32_t groupCount = static_cast<uint32_t>( DeckLinkPixelConversion::GetV210RowBytes( width ) / 16 );
+		if( mWords.size() < groupCount * 12 )
+			Prepare( width );
+
+		const uint32_t samples = static_cast<uint32_t>( width * 2 );
+		for( uint32_t line = mFirstLine; line <= mLastLine; ++line ) {
+			void* bytes = NULL;
+			if( ancillary->GetBufferForVerticalBlankingLine( line, &bytes ) != S_OK || bytes == NULL )
+				continue;
+
+			// three 10-bit samples in the low 30 bits of every little endian word
+			const uint32_t* packed = static_cast<const uint32_t*>( bytes );
+			uint16_t* words = mWords.data();
+			for( uint32_t index = 0; index < groupCount * 4; ++index ) {
+				const uint32_t value = packed[index];
+				words[0] = static_cast<uint16_t>( value & 0x3ff );
+				words[1] = static_cast<uint16_t>( ( value >> 10 ) & 0x3ff );
+				words[2] = static_cast<uint16_t>( ( value >> 20 ) & 0x3ff );
+				words += 3;
+			}
+
+			if( width <= 720 ) {
+				// SD multiplexes ancillary data across both sample streams
+				ParseWords( mWords.data(), samples, 1, static_cast<uint16_t>( line ), 0, buffer );
+			}
+			else {
+				ParseWords( mWords.data() + 1, samples / 2, 2, static_cast<uint16_t>( line ), 0, buffer );
+				ParseWords( mWords.data(), samples / 2, 2, static_cast<uint16_t>( line ), DeckLinkAncillaryPacket::Chroma, buffer );
+			}
+		}
+	}
+
+	ancillary->Release();
+}
+
+void DeckLinkAncillaryReader::ParseWords( const uint16_t* words, uint32_t count, uint32_t stride, uint16_t line, uint8_t flags, DeckLinkAncillaryBuffer& buffer )
+{
+	// ADF, DID, SDID/DBN, DC, then DC user data words and a checksum
+	static const uint32_t HeaderWords = 6;
+
+	uint8_t data[255];
+	uint32_t index = 0;
+	while( index + HeaderWords < count ) {
+		if( words[index * stride] != 0x000 || words[( index + 1 ) * stride] != 0x3ff || words[( index + 2 ) * stride] != 0x3ff ) {
+			++index;
+			continue;
+		}
+
+		const uint8_t did = static_cast<uint8_t>( words[( index + 3 ) * stride] );
+		const uint8_t sdid = static_cast<uint8_t>( words[( index + 4 ) * stride] );
+		const uint8_t dataCount = static_cast<uint8_t>( words[( index + 5 ) * stride] );
+		if( index + HeaderWords + dataCount >= count ) {
+			// runs past the end of the line
+			++mChecksumErrors;
+			return;
+		}
+
+		// nine bit sum of DID through the last user data word, bit 9 is the inverse of bit 8
+		uint32_t sum = 0;
+		for( uint32_t word = 3; word < HeaderWords + dataCount; ++word ) {
+			sum += words[( index + word ) * stride] & 0x1ff;
+		}
+		sum &= 0x1ff;
+		sum |= ( ~sum << 1 ) & 0x200;
+
+		const uint16_t checksum = words[( index + HeaderWords + dataCount ) * stride];
+		if( checksum != sum ) {
+			++mChecksumErrors;
+			++index;
+			continue;
+		}
+
+		++mPackets;
+		if( Accepts( did, sdid ) ) {
+			for( uint32_t word = 0; word < dataCount; ++word ) {
+				data[word] = static_cast<uint8_t>( words[( index + HeaderWords + word ) * stride] );
+			}
+
+			DeckLinkAncillaryPacket header;
+			header.line = line;
+			header.did = did;
+			header.sdid = sdid;
+			header.dataCount = dataCount;
+			header.flags = flags;
+			if( ! buffer.Append( header, data ) )
+				++mOverflows;
+		}
+		else {
+			++mFiltered;
+		}
+
+		index += HeaderWords + dataCount + 1;
+	}
+}
@@ -0,0 +1,160 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include "DeckLinkPlatform.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Header of one SMPTE 291 ancillary packet in a DeckLinkAncillaryBuffer.
+ * dataCount user data bytes follow it directly, the next header follows those.
+ */
+struct DeckLinkAncillaryPacket {
+	enum Flags : uint8_t {
+		/** Found in the chroma samples rather than the luma ones (HD only). */
+		Chroma = 1 << 0,
+	};
+
+	uint16_t	line;
+	uint8_t		did;
+	uint8_t		sdid;
+	uint8_t		dataCount;
+	uint8_t		flags;
+};
+static_assert( sizeof( DeckLinkAncillaryPacket ) == 6, "DeckLinkAncillaryPacket is a wire format" );
+
+/** Selects packets by DID, and by SDID unless anySdid is set. */
+struct DeckLinkAncillaryFilter {
+	DeckLinkAncillaryFilter() : did{ 0 }, sdid{ 0 }, anySdid{ true } { }
+	DeckLinkAncillaryFilter( uint8_t inDid ) : did{ inDid }, sdid{ 0 }, anySdid{ true } { }
+	DeckLinkAncillaryFilter( uint8_t inDid, uint8_t inSdid ) : did{ inDid }, sdid{ inSdid }, anySdid{ false } { }
+
+	bool Matches( uint8_t packetDid, uint8_t packetSdid ) const { return did == packetDid && ( anySdid || sdid == packetSdid ); }
+
+	uint8_t		did;
+	uint8_t		sdid;
+	bool		anySdid;
+};
+
+/**
+ * Fixed capacity store for the ancillary packets of one frame.
+ *
+ * Packets are laid out back to back as a DeckLinkAncillaryPacket followed by
+ * its user data, so the whole buffer can be handed to a consumer as is.
+ * Memory is only allocated by Reserve, a packet that does not fit is dropped.
+ */
+class DeckLinkAncillaryBuffer {
+public:
+	static const size_t DefaultCapacity = 16 * 1024;
+
+	DeckLinkAncillaryBuffer() : mSize{ 0 }, mCapacity{ 0 }, mPacketCount{ 0 } { }
+
+	DeckLinkAncillaryBuffer( const DeckLinkAncillaryBuffer& ) = delete;
+	DeckLinkAncillaryBuffer& operator=( const DeckLinkAncillaryBuffer& ) = delete;
+
+	/** Grows the buffer to hold at least capacity bytes, and empties it. */
+	void						Reserve( size_t capacity );
+	void						Clear() { mSize = 0; mPacketCount = 0; }
+
+	/** Appends a packet, returns false and leaves the buffer as it was if there is no room. */
+	bool						Append( const DeckLinkAncillaryPacket& header, const uint8_t* data );
+
+	const uint8_t*				GetData() const { return mData.get(); }
+	size_t						GetSize() const { return mSize; }
+	size_t						GetCapacity() const { return mCapacity.load( std::memory_order_relaxed ); }
+	uint32_t					GetPacketCount() const { return mPacketCount; }
+
+private:
+	std::unique_ptr<uint8_t[]>	mData;
+	size_t						mSize;
+	// read by the frame pool stats on another thread while a reserve grows it
+	std::atomic<size_t>			mCapacity;
+	uint32_t					mPacketCount;
+};
+
+/**
+ * Finds SMPTE 291 ancillary packets in the vertical blanking lines of a
+ * captured frame.
+ *
+ * Only 10-bit (v210) lines are parsed, 8-bit capture drops the low bits of
+ * every word and cannot carry ancillary data intact. HD lines are searched
+ * for packets in the luma and then the chroma samples, SD lines in the
+ * multiplexed sample stream.
+ */
+class DeckLinkAncillaryReader {
+public:
+	static const uint32_t DefaultFirstLine = 1;
+	static const uint32_t DefaultLastLine = 41;
+
+	DeckLinkAncillaryReader();
+
+	DeckLinkAncillaryReader( const DeckLinkAncillaryReader& ) = delete;
+	DeckLinkAncillaryReader& operator=( const DeckLinkAncillaryReader& ) = delete;
+
+	/** Keeps only packets matching one of the filters, or every packet if there are none. Not thread safe with Read. */
+	void						SetFilters( const std::vector<DeckLinkAncillaryFilter>& filters ) { mFilters = filters; }
+	const std::vector<DeckLinkAncillaryFilter>&	GetFilters() const { return mFilters; }
+
+	/** Selects the blanking lines to search, inclusive. Not thread safe with Read. */
+	void						SetLines( uint32_t firstLine, uint32_t lastLine );
+
+	/** Sizes the scratch space for lines of the given width so Read never allocates. */
+	void						Prepare( long width );
+
+	/** Clears buffer and fills it with the matching packets found in the frame's blanking lines. */
+	void						Read( IDeckLinkVideoInputFrame* frame, DeckLinkAncillaryBuffer& buffer );
+
+	uint64_t					GetPacketCount() const { return mPackets; }
+	uint64_t					GetFilteredCount() const { return mFiltered; }
+	uint64_t					GetChecksumErrorCount() const { return mChecksumErrors; }
+	uint64_t					GetOverflowCount() const { return mOverflows; }
+
+private:
+	void						ParseWords( const uint16_t* words, uint32_t count, uint32_t stride, uint16_t line, uint8_t flags, DeckLinkAncillaryBuffer& buffer );
+	bool						Accepts( uint8_t did, uint8_t sdid ) const;
+
+	std::vector<DeckLinkAncillaryFilter>	mFilters;
+	uint32_t					mFirstLine;
+	uint32_t					mLastLine;
+
+	// one line of samples in stream order, Cb Y Cr Y ...
+	std::vector<uint16_t>		mWords;
+
+	std::atomic<uint64_t>		mPackets;
+	std::atomic<uint64_t>		mFiltered;
+	std::atomic<uint64_t>		mChecksumErrors;
+	std::atomic<uint64_t>		mOverflows;
+};
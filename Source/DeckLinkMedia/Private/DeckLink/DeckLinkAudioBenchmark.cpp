@@ -0,0 +1,251 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkAudioBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+using namespace DeckLinkPixelConversion;
+
+namespace {
+	/** Deterministic interleaved packet, with full-scale samples now and then. */
+	std::vector<uint8_t> MakePacket( uint32_t channels, uint32_t frames, DeckLinkAudioSampleType type, uint32_t seed )
+	{
+		const uint32_t samples = channels * frames;
+		const uint32_t sampleBytes = GetAudioSampleBytes( type );
+		std::vector<uint8_t> packet( samples * sampleBytes );
+
+		uint32_t state = seed * 2654435761u + 1;
+		for( uint32_t i = 0; i < samples; ++i ) {
+			state = state * 1664525u + 1013904223u;
+			const uint32_t value = ( i % 61 == 0 ) ? 0x80000000u : ( ( i % 67 == 0 ) ? 0x7fffffffu : state );
+			if( type == DeckLinkAudioSampleType::Int16 ) {
+				const uint16_t sample = static_cast<uint16_t>( value >> 16 );
+				memcpy( &packet[i * sampleBytes], &sample, sampleBytes );
+			}
+			else {
+				memcpy( &packet[i * sampleBytes], &value, sampleBytes );
+			}
+		}
+		return packet;
+	}
+
+	/**
+	 * DrainAudio's work on one packet into work, which must hold the packet's
+	 * output at 32 bits per sample. Without a channel map the player converts
+	 * the samples it read in place; here they go from src to work, through
+	 * the same kernel.
+	 */
+	const int16_t* ProcessPacket( const DeckLinkAudioBenchmarkLayout& layout, DeckLinkAudioSampleType type, InstructionSet isa, const uint8_t* src, uint8_t* work, uint32_t frames )
+	{
+		const uint32_t dstChannels = layout.GetDstChannels();
+		const void* samples = src;
+		if( ! layout.channelMap.empty() ) {
+			DeckLinkAudioConversion::RemapChannels( src, layout.srcChannels, work, layout.channelMap.data(), dstChannels, frames, type, isa );
+			samples = work;
+		}
+
+		int16_t* output = reinterpret_cast<int16_t*>( work );
+		DeckLinkAudioConversion::ConvertToInt16( samples, type, output, frames * dstChannels, isa );
+		return output;
+	}
+
+	/** Index of the first differing sample, or count if there is none. */
+	uint32_t FindMismatch( const int16_t* a, const int16_t* b, uint32_t count )
+	{
+		for( uint32_t i = 0; i < count; ++i ) {
+			if( a[i] != b[i] )
+				return i;
+		}
+		return count;
+	}
+
+	bool IsSupported( InstructionSet isa )
+	{
+		return ResolveInstructionSet( isa ) == isa;
+	}
+}
+
+DeckLinkAudioBenchmarkSettings::DeckLinkAudioBenchmarkSettings()
+	: framesPerPacket{ 1601 }
+	, secondsPerCase{ 0.25 }
+	, minimumPackets{ 100 }
+{
+	sampleTypes.push_back( DeckLinkAudioSampleType::Int16 );
+	sampleTypes.push_back( DeckLinkAudioSampleType::Int32 );
+
+	// the widest variant against the reference
+	instructionSets.push_back( InstructionSet::Scalar );
+	if( DetectInstructionSet() != InstructionSet::Scalar )
+		instructionSets.push_back( DetectInstructionSet() );
+}
+
+std::vector<DeckLinkAudioBenchmarkLayout> DeckLinkAudioBenchmark::GetDefaultLayouts()
+{
+	std::vector<DeckLinkAudioBenchmarkLayout> layouts;
+	layouts.push_back( { "2ch", 2, {} } );
+	layouts.push_back( { "8ch-to-2", 8, { 0, 1 } } );
+	layouts.push_back( { "16ch-to-2", 16, { 0, 1 } } );
+	layouts.push_back( { "16ch-reversed", 16, { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 } } );
+	layouts.push_back( { "16ch-to-8-silence", 16, { 0, 1, 2, 3, -1, -1, 6, 7 } } );
+	layouts.push_back( { "16ch", 16, {} } );
+	return layouts;
+}
+
+std::vector<DeckLinkAudioBenchmarkResult> DeckLinkAudioBenchmark::Run( const DeckLinkAudioBenchmarkSettings& settings, const std::function<void( const DeckLinkAudioBenchmarkResult& )>& progress )
+{
+	const std::vector<DeckLinkAudioBenchmarkLayout> layouts = settings.layouts.empty() ? GetDefaultLayouts() : settings.layouts;
+	const uint32_t frames = std::max( settings.framesPerPacket, 1u );
+
+	std::vector<DeckLinkAudioBenchmarkResult> results;
+	for( const DeckLinkAudioBenchmarkLayout& layout : layouts ) {
+		const uint32_t dstChannels = layout.GetDstChannels();
+		for( DeckLinkAudioSampleType type : settings.sampleTypes ) {
+			const std::vector<uint8_t> packet = MakePacket( layout.srcChannels, frames, type, 1 );
+			std::vector<uint8_t> work( frames * dstChannels * sizeof( int32_t ) );
+
+			const int16_t* output = ProcessPacket( layout, type, InstructionSet::Scalar, packet.data(), work.data(), frames );
+			const std::vector<int16_t> reference( output, output + frames * dstChannels );
+
+			for( InstructionSet isa : settings.instructionSets ) {
+				if( ! IsSupported( isa ) )
+					continue;
+
+				DeckLinkAudioBenchmarkResult result;
+				result.layout = layout.name;
+				result.srcChannels = layout.srcChannels;
+				result.dstChannels = dstChannels;
+				result.sampleType = type;
+				result.instructionSet = isa;
+				result.framesPerPacket = frames;
+
+				// the warm up packet is also the one checked
+				output = ProcessPacket( layout, type, isa, packet.data(), work.data(), frames );
+				result.matchesScalar = ( FindMismatch( reference.data(), output, frames * dstChannels ) == frames * dstChannels );
+
+				typedef std::chrono::steady_clock Clock;
+				const Clock::time_point start = Clock::now();
+				Clock::time_point now = start;
+				uint64_t packets = 0;
+				do {
+					ProcessPacket( layout, type, isa, packet.data(), work.data(), frames );
+					++packets;
+					now = Clock::now();
+				} while( packets < settings.minimumPackets || std::chrono::duration<double>( now - start ).count() < settings.secondsPerCase );
+
+				result.packets = packets;
+				result.seconds = std::chrono::duration<double>( now - start ).count();
+
+				results.push_back( result );
+				if( progress )
+					progress( result );
+			}
+		}
+	}
+	return results;
+}
+
+std::vector<std::string> DeckLinkAudioBenchmark::Verify()
+{
+	// around every vector width, plus whole packets at 59.94 and 29.97
+	const uint32_t lengths[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 801, 1601 };
+	const InstructionSet variants[] = { InstructionSet::SSE41, InstructionSet::AVX2 };
+	const DeckLinkAudioSampleType types[] = { DeckLinkAudioSampleType::Int16, DeckLinkAudioSampleType::Int32 };
+
+	std::vector<std::string> mismatches;
+	char line[256];
+	for( const DeckLinkAudioBenchmarkLayout& layout : GetDefaultLayouts() ) {
+		const uint32_t dstChannels = layout.GetDstChannels();
+		for( DeckLinkAudioSampleType type : types ) {
+			for( uint32_t frames : lengths ) {
+				const std::vector<uint8_t> packet = MakePacket( layout.srcChannels, frames, type, frames );
+				std::vector<uint8_t> work( frames * dstChannels * sizeof( int32_t ) );
+
+				const int16_t* output = ProcessPacket( layout, type, InstructionSet::Scalar, packet.data(), work.data(), frames );
+				const std::vector<int16_t> reference( output, output + frames * dstChannels );
+
+				for( InstructionSet isa : variants ) {
+					if( ! IsSupported( isa ) )
+						continue;
+
+					output = ProcessPacket( layout, type, isa, packet.data(), work.data(), frames );
+					uint32_t mismatch = FindMismatch( reference.data(), output, frames * dstChannels );
+
+					// without a map the player converts in place
+					if( mismatch == frames * dstChannels && layout.channelMap.empty() ) {
+						memcpy( work.data(), packet.data(), packet.size() );
+						output = reinterpret_cast<int16_t*>( work.data() );
+						DeckLinkAudioConversion::ConvertToInt16( work.data(), type, reinterpret_cast<int16_t*>( work.data() ), frames * dstChannels, isa );
+						mismatch = FindMismatch( reference.data(), output, frames * dstChannels );
+					}
+
+					if( mismatch != frames * dstChannels ) {
+						snprintf( line, sizeof( line ), "%s %s %s %u frames: sample %u is %d, scalar %d",
+							layout.name.c_str(), GetSampleTypeName( type ), GetInstructionSetName( isa ), frames, mismatch, output[mismatch], reference[mismatch] );
+						mismatches.push_back( line );
+					}
+				}
+			}
+		}
+	}
+	return mismatches;
+}
+
+const char* DeckLinkAudioBenchmark::GetSampleTypeName( DeckLinkAudioSampleType type )
+{
+	return ( type == DeckLinkAudioSampleType::Int16 ) ? "Int16" : "Int32";
+}
+
+std::string DeckLinkAudioBenchmark::FormatLine( const DeckLinkAudioBenchmarkResult& result )
+{
+	char line[256];
+	snprintf( line, sizeof( line ), "%-18s %-5s %-7s %5u frames: %9.2f us/packet %7.3f ns/sample%s",
+		result.layout.c_str(), GetSampleTypeName( result.sampleType ), GetInstructionSetName( result.instructionSet ), result.framesPerPacket,
+		result.GetMicrosecondsPerPacket(), result.GetNanosecondsPerSample(), result.matchesScalar ? "" : "  DIFFERS FROM SCALAR" );
+	return line;
+}
+
+std::string DeckLinkAudioBenchmark::FormatCsv( const std::vector<DeckLinkAudioBenchmarkResult>& results )
+{
+	std::string csv = "layout,srcChannels,dstChannels,sampleType,instructionSet,framesPerPacket,packets,seconds,usPerPacket,nsPerSample,matchesScalar\n";
+	char line[512];
+	for( const DeckLinkAudioBenchmarkResult& result : results ) {
+		snprintf( line, sizeof( line ), "%s,%u,%u,%s,%s,%u,%llu,%.6f,%.3f,%.4f,%d\n",
+			result.layout.c_str(), result.srcChannels, result.dstChannels, GetSampleTypeName( result.sampleType ), GetInstructionSetName( result.instructionSet ),
+			result.framesPerPacket, static_cast<unsigned long long>( result.packets ), result.seconds,
+			result.GetMicrosecondsPerPacket(), result.GetNanosecondsPerSample(), result.matchesScalar ? 1 : 0 );
+		csv += line;
+	}
+	return csv;
+}
+
+std::string DeckLinkAudioBenchmark::FormatJson( const std::vector<DeckLinkAudioBenchmarkResult>& results, const std::string& machine )
+{
+	std::string escaped;
+	for( char c : machine ) {
+		if( c == '"' || c == '\\' )
+			escaped += '\\';
+		if( static_cast<unsigned char>( c ) >= 0x20 )
+			escaped += c;
+	}
+
+	char line[512];
+	snprintf( line, sizeof( line ), "{\"machine\":\"%s\",\"hardwareThreads\":%u,\"instructionSet\":\"%s\",\"results\":[",
+		escaped.c_str(), std::thread::hardware_concurrency(), GetInstructionSetName( DetectInstructionSet() ) );
+	std::string json = line;
+
+	bool first = true;
+	for( const DeckLinkAudioBenchmarkResult& result : results ) {
+		snprintf( line, sizeof( line ), "%s\n{\"layout\":\"%s\",\"srcChannels\":%u,\"dstChannels\":%u,\"sampleType\":\"%s\",\"instructionSet\":\"%s\",\"framesPerPacket\":%u,"
+			"\"packets\":%llu,\"seconds\":%.6f,\"usPerPacket\":%.3f,\"nsPerSample\":%.4f,\"matchesScalar\":%s}",
+			first ? "" : ",",
+			result.layout.c_str(), result.srcChannels, result.dstChannels, GetSampleTypeName( result.sampleType ), GetInstructionSetName( result.instructionSet ), result.framesPerPacket,
+			static_cast<unsigned long long>( result.packets ), result.seconds,
+			result.GetMicrosecondsPerPacket(), result.GetNanosecondsPerSample(), result.matchesScalar ? "true" : "false" );
+		json += line;
+		first = false;
+	}
+	return json + "\n]}";
+}
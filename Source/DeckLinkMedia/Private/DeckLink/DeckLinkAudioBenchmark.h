@@ -0,0 +1,121 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#pragma once
+
+#include "DeckLinkAudioConversion.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/** A captured channel layout and what the player makes of it. */
+struct DeckLinkAudioBenchmarkLayout {
+	std::string											name;
+	uint32_t											srcChannels;
+
+	/** AudioChannelMap of the player, no remap if empty. */
+	std::vector<int32_t>								channelMap;
+
+	uint32_t											GetDstChannels() const { return channelMap.empty() ? srcChannels : static_cast<uint32_t>( channelMap.size() ); }
+};
+
+struct DeckLinkAudioBenchmarkSettings {
+	DeckLinkAudioBenchmarkSettings();
+
+	/** Layouts to measure, DeckLinkAudioBenchmark::GetDefaultLayouts if empty. */
+	std::vector<DeckLinkAudioBenchmarkLayout>			layouts;
+
+	std::vector<DeckLinkAudioSampleType>				sampleTypes;
+
+	/** Kernel variants, unsupported ones are skipped. */
+	std::vector<DeckLinkPixelConversion::InstructionSet>	instructionSets;
+
+	/** Sample frames per packet; 1601 or 1602 at 29.97, 800 or 801 at 59.94. */
+	uint32_t											framesPerPacket;
+
+	/** Minimum time and packet count spent on each case after one warm up packet. */
+	double												secondsPerCase;
+	uint32_t											minimumPackets;
+};
+
+/** One kernel variant running the player's audio path on packets of one layout. */
+struct DeckLinkAudioBenchmarkResult {
+	std::string								layout;
+	uint32_t								srcChannels;
+	uint32_t								dstChannels;
+	DeckLinkAudioSampleType					sampleType;
+	DeckLinkPixelConversion::InstructionSet	instructionSet;
+	uint32_t								framesPerPacket;
+
+	uint64_t								packets;
+	double									seconds;
+
+	/** True if the measured output was identical to the scalar path's. */
+	bool									matchesScalar;
+
+	double									GetMicrosecondsPerPacket() const { return ( packets > 0 ) ? seconds * 1.0e6 / packets : 0.0; }
+	double									GetNanosecondsPerSample() const { return ( packets > 0 ) ? seconds * 1.0e9 / ( static_cast<double>( packets ) * framesPerPacket * srcChannels ) : 0.0; }
+};
+
+/**
+ * Measures and checks the audio kernels on synthetic packets, without a card.
+ *
+ * Every case runs what FDeckLinkMediaPlayer::DrainAudio does to a packet:
+ * RemapChannels into a second buffer if the layout has a channel map, then
+ * ConvertToInt16 in place.
+ */
+class DeckLinkAudioBenchmark {
+public:
+	/** Stereo out of 2, 8 and 16 channels, 16 channels reversed, 8 out of 16 with silence, and all 16 untouched. */
+	static std::vector<DeckLinkAudioBenchmarkLayout>	GetDefaultLayouts();
+
+	/** Runs every case, calling progress after each one. */
+	static std::vector<DeckLinkAudioBenchmarkResult>	Run( const DeckLinkAudioBenchmarkSettings& settings, const std::function<void( const DeckLinkAudioBenchmarkResult& )>& progress );
+
+	/**
+	 * Compares every supported kernel variant with the scalar path, bit for
+	 * bit, on the default layouts, both sample types, packet lengths around
+	 * every vector width and full-scale samples.
+	 *
+	 * @return One line per mismatch, empty if all match.
+	 */
+	static std::vector<std::string>						Verify();
+
+	static const char*									GetSampleTypeName( DeckLinkAudioSampleType type );
+
+	/** One line per result, for the log. */
+	static std::string									FormatLine( const DeckLinkAudioBenchmarkResult& result );
+	static std::string									FormatCsv( const std::vector<DeckLinkAudioBenchmarkResult>& results );
+	static std::string									FormatJson( const std::vector<DeckLinkAudioBenchmarkResult>& results, const std::string& machine );
+};
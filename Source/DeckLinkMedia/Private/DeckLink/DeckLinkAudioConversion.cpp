@@ -0,0 +1,164 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkAudioConversion.h"
+
+#include <cstring>
+
+#if defined( _M_X64 ) || defined( __x86_64__ )
+	#define DECKLINK_AUDIO_X86 1
+	#include <immintrin.h>
+	#if defined( _MSC_VER )
+		#define DECKLINK_TARGET_SSE41
+		#define DECKLINK_TARGET_AVX2
+	#else
+		#define DECKLINK_TARGET_SSE41 __attribute__(( target( "sse4.1" ) ))
+		#define DECKLINK_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+	#endif
+#else
+	#define DECKLINK_AUDIO_X86 0
+#endif
+
+namespace DeckLinkAudioConversion
+{
+	namespace
+	{
+		void Int32ToInt16Scalar( const int32_t* src, int16_t* dst, uint32_t begin, uint32_t count )
+		{
+			for( uint32_t i = begin; i < count; ++i )
+				dst[i] = static_cast<int16_t>( src[i] >> 16 );
+		}
+
+		template<typename SampleType>
+		void RemapScalar( const SampleType* src, uint32_t srcChannels, SampleType* dst, const int32_t* channelMap, uint32_t dstChannels, uint32_t frames )
+		{
+			for( uint32_t frame = 0; frame < frames; ++frame ) {
+				const SampleType* in = src + frame * srcChannels;
+				SampleType* out = dst + frame * dstChannels;
+				for( uint32_t channel = 0; channel < dstChannels; ++channel ) {
+					const int32_t source = channelMap[channel];
+					out[channel] = ( source >= 0 ) ? in[source] : SampleType( 0 );
+				}
+			}
+		}
+
+#if DECKLINK_AUDIO_X86
+
+		// Every result of >> 16 fits 16 bits, so the saturating pack never clamps.
+		DECKLINK_TARGET_SSE41 uint32_t Int32ToInt16SSE41( const int32_t* src, int16_t* dst, uint32_t count )
+		{
+			uint32_t i = 0;
+			for( ; i + 8 <= count; i += 8 ) {
+				const __m128i lo = _mm_srai_epi32( _mm_loadu_si128( (const __m128i*)( src + i ) ), 16 );
+				const __m128i hi = _mm_srai_epi32( _mm_loadu_si128( (const __m128i*)( src + i + 4 ) ), 16 );
+				_mm_storeu_si128( (__m128i*)( dst + i ), _mm_packs_epi32( lo, hi ) );
+			}
+			return i;
+		}
+
+		DECKLINK_TARGET_AVX2 uint32_t Int32ToInt16AVX2( const int32_t* src, int16_t* dst, uint32_t count )
+		{
+			uint32_t i = 0;
+			for( ; i + 16 <= count; i += 16 ) {
+				const __m256i lo = _mm256_srai_epi32( _mm256_loadu_si256( (const __m256i*)( src + i ) ), 16 );
+				const __m256i hi = _mm256_srai_epi32( _mm256_loadu_si256( (const __m256i*)( src + i + 8 ) ), 16 );
+				// packs works per lane, put the 64-bit quarters back in order
+				const __m256i packed = _mm256_permute4x64_epi64( _mm256_packs_epi32( lo, hi ), 0xd8 );
+				_mm256_storeu_si256( (__m256i*)( dst + i ), packed );
+			}
+			return i;
+		}
+
+		inline int32_t LoadPair( const int16_t* src )
+		{
+			int32_t pair;
+			memcpy( &pair, src, sizeof( pair ) );
+			return pair;
+		}
+
+		// Stereo out of any layout is the common case: one 32-bit load per frame.
+		DECKLINK_TARGET_SSE41 uint32_t RemapStereoInt16SSE41( const int16_t* src, uint32_t srcChannels, int16_t* dst, const int32_t* channelMap, uint32_t frames )
+		{
+			if( channelMap[0] != 0 || channelMap[1] != 1 )
+				return 0;
+
+			uint32_t frame = 0;
+			for( ; frame + 4 <= frames; frame += 4 ) {
+				const __m128i pairs = _mm_setr_epi32(
+					LoadPair( src + ( frame + 0 ) * srcChannels ),
+					LoadPair( src + ( frame + 1 ) * srcChannels ),
+					LoadPair( src + ( frame + 2 ) * srcChannels ),
+					LoadPair( src + ( frame + 3 ) * srcChannels ) );
+				_mm_storeu_si128( (__m128i*)( dst + frame * 2 ), pairs );
+			}
+			return frame;
+		}
+
+		DECKLINK_TARGET_AVX2 uint32_t RemapInt32AVX2( const int32_t* src, uint32_t srcChannels, int32_t* dst, const int32_t* channelMap, uint32_t dstChannels, uint32_t frames )
+		{
+			// only maps without silence and with whole vectors of output channels
+			if( dstChannels % 8 != 0 )
+				return 0;
+			for( uint32_t channel = 0; channel < dstChannels; ++channel ) {
+				if( channelMap[channel] < 0 )
+					return 0;
+			}
+
+			for( uint32_t frame = 0; frame < frames; ++frame ) {
+				const int32_t* in = src + frame * srcChannels;
+				int32_t* out = dst + frame * dstChannels;
+				for( uint32_t channel = 0; channel < dstChannels; channel += 8 ) {
+					const __m256i indices = _mm256_loadu_si256( (const __m256i*)( channelMap + channel ) );
+					_mm256_storeu_si256( (__m256i*)( out + channel ), _mm256_i32gather_epi32( (const int*)in, indices, 4 ) );
+				}
+			}
+			return frames;
+		}
+
+#endif
+	}
+
+	void ConvertToInt16( const void* src, DeckLinkAudioSampleType srcType, int16_t* dst, uint32_t sampleCount, InstructionSet isa )
+	{
+		if( srcType == DeckLinkAudioSampleType::Int16 ) {
+			if( src != dst )
+				memmove( dst, src, sampleCount * sizeof( int16_t ) );
+			return;
+		}
+
+		const int32_t* samples = static_cast<const int32_t*>( src );
+		uint32_t i = 0;
+
+#if DECKLINK_AUDIO_X86
+		// forward in place is safe: every store lands on bytes already loaded
+		if( isa == InstructionSet::AVX2 )
+			i = Int32ToInt16AVX2( samples, dst, sampleCount );
+		else if( isa == InstructionSet::SSE41 )
+			i = Int32ToInt16SSE41( samples, dst, sampleCount );
+#endif
+
+		Int32ToInt16Scalar( samples, dst, i, sampleCount );
+	}
+
+	void RemapChannels( const void* src, uint32_t srcChannels, void* dst, const int32_t* channelMap, uint32_t dstChannels, uint32_t frames, DeckLinkAudioSampleType sampleType, InstructionSet isa )
+	{
+		if( sampleType == DeckLinkAudioSampleType::Int16 ) {
+			const int16_t* in = static_cast<const int16_t*>( src );
+			int16_t* out = static_cast<int16_t*>( dst );
+			uint32_t frame = 0;
+#if DECKLINK_AUDIO_X86
+			if( dstChannels == 2 && isa != InstructionSet::Scalar )
+				frame = RemapStereoInt16SSE41( in, srcChannels, out, channelMap, frames );
+#endif
+			RemapScalar( in + frame * srcChannels, srcChannels, out + frame * dstChannels, channelMap, dstChannels, frames - frame );
+		}
+		else {
+			const int32_t* in = static_cast<const int32_t*>( src );
+			int32_t* out = static_cast<int32_t*>( dst );
+			uint32_t frame = 0;
+#if DECKLINK_AUDIO_X86
+			if( isa == InstructionSet::AVX2 )
+				frame = RemapInt32AVX2( in, srcChannels, out, channelMap, dstChannels, frames );
+#endif
+			RemapScalar( in + frame * srcChannels, srcChannels, out + frame * dstChannels, channelMap, dstChannels, frames - frame );
+		}
+	}
+}
@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include "DeckLinkPixelConversion.h"
+#include "DeckLinkAudioRing.h"
+
+#include <cstdint>
+
+/**
+ * Sample conversion kernels for captured audio.
+ *
+ * The card delivers interleaved 16 or 32-bit integer PCM. These kernels
+ * pick or reorder its channels and convert it to the 16-bit PCM the audio
+ * sink takes, see DeckLinkAudioBenchmark for their timings. All
+ * instruction set variants produce identical results; the scalar path is
+ * the reference. Instruction sets are shared with the pixel converters.
+ */
+namespace DeckLinkAudioConversion
+{
+	typedef DeckLinkPixelConversion::InstructionSet InstructionSet;
+
+	/** Converts sampleCount samples to 16-bit by keeping their top bits. dst may be the same buffer as src. */
+	void						ConvertToInt16( const void* src, DeckLinkAudioSampleType srcType, int16_t* dst, uint32_t sampleCount, InstructionSet isa );
+
+	/**
+	 * Builds dstChannels interleaved channels from srcChannels interleaved
+	 * channels of the same sample type. channelMap[i] is the source channel
+	 * of output channel i, or -1 for silence. src and dst must not overlap.
+	 */
+	void						RemapChannels( const void* src, uint32_t srcChannels, void* dst, const int32_t* channelMap, uint32_t dstChannels, uint32_t frames, DeckLinkAudioSampleType sampleType, InstructionSet isa );
+}
@@ -0,0 +1,129 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkAudioRing.h"
+
+#include <cstring>
+
+DeckLinkAudioRing::DeckLinkAudioRing()
+	: mCapacityFrames{ 0 }
+	, mChannels{ 0 }
+	, mSampleRate{ 0 }
+	, mSampleType{ DeckLinkAudioSampleType::Int16 }
+	, mFrameBytes{ 0 }
+	, mAnchors{ MaxAnchors }
+	, mHasNextAnchor{ false }
+	, mReadPosition{ 0 }
+	, mWritePosition{ 0 }
+	, mDroppedPackets{ 0 }
+	, mDroppedFrames{ 0 }
+{ }
+
+void DeckLinkAudioRing::Configure( uint32_t channels, uint32_t sampleRate, DeckLinkAudioSampleType sampleType, uint32_t milliseconds )
+{
+	uint32_t capacityFrames = 1;
+	const uint64_t requiredFrames = static_cast<uint64_t>( sampleRate ) * milliseconds / 1000;
+	while( capacityFrames < requiredFrames )
+		capacityFrames <<= 1;
+
+	const uint32_t frameBytes = channels * GetAudioSampleBytes( sampleType );
+	if( capacityFrames * frameBytes != mCapacityFrames * mFrameBytes ) {
+		mBuffer.reset( new uint8_t[capacityFrames * frameBytes] );
+	}
+
+	mCapacityFrames = capacityFrames;
+	mChannels = channels;
+	mSampleRate = sampleRate;
+	mSampleType = sampleType;
+	mFrameBytes = frameBytes;
+
+	Reset();
+}
+
+void DeckLinkAudioRing::Reset()
+{
+	Anchor anchor;
+	while( mAnchors.Pop( anchor ) ) { }
+
+	mCurrentAnchor = Anchor();
+	mHasNextAnchor = false;
+	mReadPosition = 0;
+	mWritePosition = 0;
+}
+
+bool DeckLinkAudioRing::Write( const void* samples, uint32_t sampleFrames, int64_t time )
+{
+	const uint64_t writePosition = mWritePosition.load( std::memory_order_relaxed );
+	const uint64_t used = writePosition - mReadPosition.load( std::memory_order_acquire );
+	if( sampleFrames > mCapacityFrames - used ) {
+		++mDroppedPackets;
+		mDroppedFrames += sampleFrames;
+		return false;
+	}
+
+	const uint32_t offset = static_cast<uint32_t>( writePosition & ( mCapacityFrames - 1 ) );
+	const uint32_t firstFrames = FMath::Min( sampleFrames, mCapacityFrames - offset );
+	memcpy( mBuffer.get() + offset * mFrameBytes, samples, firstFrames * mFrameBytes );
+	if( firstFrames < sampleFrames ) {
+		memcpy( mBuffer.get(), static_cast<const uint8_t*>( samples ) + firstFrames * mFrameBytes, ( sampleFrames - firstFrames ) * mFrameBytes );
+	}
+
+	// without an anchor the reader extrapolates from the previous packet
+	mAnchors.Push( Anchor( writePosition, time ) );
+	mWritePosition.store( writePosition + sampleFrames, std::memory_order_release );
+	return true;
+}
+
+uint32_t DeckLinkAudioRing::Read( void* samples, uint32_t maxSampleFrames, int64_t& time )
+{
+	const uint64_t readPosition = mReadPosition.load( std::memory_order_relaxed );
+	const uint64_t available = mWritePosition.load( std::memory_order_acquire ) - readPosition;
+	const uint32_t sampleFrames = static_cast<uint32_t>( FMath::Min<uint64_t>( available, maxSampleFrames ) );
+	if( sampleFrames == 0 )
+		return 0;
+
+	time = TimeAt( readPosition );
+
+	const uint32_t offset = static_cast<uint32_t>( readPosition & ( mCapacityFrames - 1 ) );
+	const uint32_t firstFrames = FMath::Min( sampleFrames, mCapacityFrames - offset );
+	memcpy( samples, mBuffer.get() + offset * mFrameBytes, firstFrames * mFrameBytes );
+	if( firstFrames < sampleFrames ) {
+		memcpy( static_cast<uint8_t*>( samples ) + firstFrames * mFrameBytes, mBuffer.get(), ( sampleFrames - firstFrames ) * mFrameBytes );
+	}
+
+	mReadPosition.store( readPosition + sampleFrames, std::memory_order_release );
+	return sampleFrames;
+}
+
+bool DeckLinkAudioRing::PeekTime( int64_t& time )
+{
+	const uint64_t readPosition = mReadPosition.load( std::memory_order_relaxed );
+	if( mWritePosition.load( std::memory_order_acquire ) == readPosition )
+		return false;
+
+	time = TimeAt( readPosition );
+	return true;
+}
+
+uint32_t DeckLinkAudioRing::Skip( uint32_t maxSampleFrames )
+{
+	const uint64_t readPosition = mReadPosition.load( std::memory_order_relaxed );
+	const uint64_t available = mWritePosition.load( std::memory_order_acquire ) - readPosition;
+	const uint32_t sampleFrames = static_cast<uint32_t>( FMath::Min<uint64_t>( available, maxSampleFrames ) );
+
+	mReadPosition.store( readPosition + sampleFrames, std::memory_order_release );
+	return sampleFrames;
+}
+
+int64_t DeckLinkAudioRing::TimeAt( uint64_t readPosition )
+{
+	// advance to the last packet that starts at or before the read position
+	for( ;; ) {
+		if( ! mHasNextAnchor && ! mAnchors.Pop( mNextAnchor ) )
+			break;
+		mHasNextAnchor = true;
+		if( mNextAnchor.position > readPosition )
+			break;
+		mCurrentAnchor = mNextAnchor;
+		mHasNextAnchor = false;
+	}
+	return mCurrentAnchor.time + static_cast<int64_t>( ( readPosition - mCurrentAnchor.position ) * TimeScale / mSampleRate );
+}
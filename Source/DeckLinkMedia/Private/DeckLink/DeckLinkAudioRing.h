@@ -0,0 +1,124 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include "DeckLinkSpscQueue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+enum class DeckLinkAudioSampleType {
+	Int16,
+	Int32,
+};
+
+inline uint32_t				GetAudioSampleBytes( DeckLinkAudioSampleType type ) { return ( type == DeckLinkAudioSampleType::Int16 ) ? 2 : 4; }
+
+/**
+ * Captured audio waiting for the player, as interleaved PCM in the capture layout.
+ *
+ * Single producer (the device's processing thread) and single consumer.
+ * Writes and reads never lock or allocate. Every packet also records where
+ * it starts and when it was captured, so the reader can tell the capture
+ * time of whatever it reads.
+ */
+class DeckLinkAudioRing {
+public:
+	/** Stream time in DeckLinkFrameTimes::TimeScale units. */
+	static const int64_t TimeScale = 10000000;
+
+	DeckLinkAudioRing();
+
+	DeckLinkAudioRing( const DeckLinkAudioRing& ) = delete;
+	DeckLinkAudioRing& operator=( const DeckLinkAudioRing& ) = delete;
+
+	/** Sizes the ring for at least the given amount of audio and empties it. Only valid while capture is stopped. */
+	void						Configure( uint32_t channels, uint32_t sampleRate, DeckLinkAudioSampleType sampleType, uint32_t milliseconds );
+
+	/** Empties the ring. Only valid while capture is stopped. */
+	void						Reset();
+
+	/** Producer side. Appends a whole packet captured at time; drops it and returns false if it does not fit. */
+	bool						Write( const void* samples, uint32_t sampleFrames, int64_t time );
+
+	/** Consumer side. Copies up to maxSampleFrames and returns how many were read; time receives the capture time of the first one. */
+	uint32_t					Read( void* samples, uint32_t maxSampleFrames, int64_t& time );
+
+	/** Consumer side. Capture time of the next frame Read would return; false if the ring is empty. */
+	bool						PeekTime( int64_t& time );
+
+	/** Consumer side. Discards up to maxSampleFrames unread frames and returns how many were discarded. */
+	uint32_t					Skip( uint32_t maxSampleFrames );
+
+	uint32_t					GetAvailableFrames() const { return static_cast<uint32_t>( mWritePosition.load( std::memory_order_acquire ) - mReadPosition.load( std::memory_order_acquire ) ); }
+	uint32_t					GetCapacityFrames() const { return mCapacityFrames; }
+	uint32_t					GetChannels() const { return mChannels; }
+	uint32_t					GetSampleRate() const { return mSampleRate; }
+	DeckLinkAudioSampleType		GetSampleType() const { return mSampleType; }
+	uint32_t					GetFrameBytes() const { return mFrameBytes; }
+
+	uint64_t					GetWrittenFrames() const { return mWritePosition; }
+	uint64_t					GetDroppedPackets() const { return mDroppedPackets; }
+	uint64_t					GetDroppedFrames() const { return mDroppedFrames; }
+
+private:
+	struct Anchor {
+		Anchor() : position{ 0 }, time{ 0 } { }
+		Anchor( uint64_t inPosition, int64_t inTime ) : position{ inPosition }, time{ inTime } { }
+
+		uint64_t	position;
+		int64_t		time;
+	};
+
+	static const uint32_t MaxAnchors = 256;
+
+	int64_t						TimeAt( uint64_t readPosition );
+
+	std::unique_ptr<uint8_t[]>	mBuffer;
+	uint32_t					mCapacityFrames;
+	uint32_t					mChannels;
+	uint32_t					mSampleRate;
+	DeckLinkAudioSampleType		mSampleType;
+	uint32_t					mFrameBytes;
+
+	// packet start positions and times, consumed by the reader as it passes them
+	DeckLinkSpscQueue<Anchor>	mAnchors;
+	Anchor						mCurrentAnchor;
+	Anchor						mNextAnchor;
+	bool						mHasNextAnchor;
+
+	alignas( 64 ) std::atomic<uint64_t>	mReadPosition;
+	alignas( 64 ) std::atomic<uint64_t>	mWritePosition;
+	std::atomic<uint64_t>				mDroppedPackets;
+	std::atomic<uint64_t>				mDroppedFrames;
+};
@@ -0,0 +1,56 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkAvSync.h"
+
+DeckLinkAvSync::DeckLinkAvSync()
+	: mOffset{ 0 }
+	, mTolerance{ DefaultTolerance }
+	, mLastError{ 0 }
+	, mCorrections{ 0 }
+	, mSkippedFrames{ 0 }
+{ }
+
+void DeckLinkAvSync::Configure( int64_t offset, int64_t tolerance )
+{
+	mOffset = offset;
+	mTolerance = FMath::Max<int64_t>( tolerance, 0 );
+}
+
+void DeckLinkAvSync::Reset()
+{
+	mLastError = 0;
+	mCorrections = 0;
+	mSkippedFrames = 0;
+}
+
+uint32_t DeckLinkAvSync::Read( DeckLinkAudioRing& ring, void* samples, uint32_t maxSampleFrames, int64_t videoTime, int64_t videoDuration, int64_t& time )
+{
+	// the span of capture time whose audio plays alongside this frame
+	const int64_t start = videoTime - mOffset;
+	const int64_t end = start + videoDuration;
+	const int64_t sampleRate = ring.GetSampleRate();
+
+	int64_t audioTime = 0;
+	if( sampleRate == 0 || ! ring.PeekTime( audioTime ) )
+		return 0;
+
+	mLastError = audioTime - start;
+	if( audioTime < start - mTolerance ) {
+		// audio trails the picture, drop what the picture has already passed
+		const int64_t behind = ( start - audioTime ) * sampleRate / DeckLinkAudioRing::TimeScale;
+		mSkippedFrames += ring.Skip( static_cast<uint32_t>( FMath::Min<int64_t>( behind, UINT32_MAX ) ) );
+		++mCorrections;
+
+		if( ! ring.PeekTime( audioTime ) )
+			return 0;
+	}
+
+	if( audioTime >= end )
+		return 0;
+
+	// round to the nearest sample, the next read starts from the ring's own time so nothing accumulates
+	const int64_t wanted = ( ( end - audioTime ) * sampleRate + DeckLinkAudioRing::TimeScale / 2 ) / DeckLinkAudioRing::TimeScale;
+	const uint32_t sampleFrames = ring.Read( samples, static_cast<uint32_t>( FMath::Min<int64_t>( wanted, maxSampleFrames ) ), audioTime );
+
+	time = audioTime + mOffset;
+	return sampleFrames;
+}
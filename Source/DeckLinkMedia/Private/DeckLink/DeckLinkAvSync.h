@@ -0,0 +1,93 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include "DeckLinkAudioRing.h"
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Lines captured audio up with captured video on the input's stream clock.
+ *
+ * Audio packet times and video frame stream times both count from
+ * StartStreams on the same clock, so the audio belonging to a frame is the
+ * audio captured during the frame's duration, shifted by the A/V offset.
+ * Each Read releases exactly that span. Anything the ring still holds from
+ * before the frame is dropped once it trails by more than the tolerance, so
+ * audio can never drift behind the picture; audio ahead of the picture is
+ * simply held until its frame comes up.
+ *
+ * Used only from the consumer side of the audio ring.
+ */
+class DeckLinkAvSync {
+public:
+	/** Times in DeckLinkAudioRing::TimeScale units. */
+	static const int64_t DefaultTolerance = DeckLinkAudioRing::TimeScale / 50;
+
+	DeckLinkAvSync();
+
+	DeckLinkAvSync( const DeckLinkAvSync& ) = delete;
+	DeckLinkAvSync& operator=( const DeckLinkAvSync& ) = delete;
+
+	/**
+	 * offset delays audio against video, negative values play it early.
+	 * tolerance is how far audio may trail the picture before it is dropped to catch up.
+	 */
+	void						Configure( int64_t offset, int64_t tolerance );
+
+	/** Clears the statistics. */
+	void						Reset();
+
+	/**
+	 * Reads the audio to present with a video frame captured at videoTime for
+	 * videoDuration. time receives the first sample's position on the video
+	 * timeline, which is its capture time plus the offset.
+	 */
+	uint32_t					Read( DeckLinkAudioRing& ring, void* samples, uint32_t maxSampleFrames, int64_t videoTime, int64_t videoDuration, int64_t& time );
+
+	int64_t						GetOffset() const { return mOffset; }
+	int64_t						GetTolerance() const { return mTolerance; }
+
+	/** How far the audio was from the last frame's start when it was released, positive when ahead. */
+	int64_t						GetLastError() const { return mLastError; }
+	uint64_t					GetCorrectionCount() const { return mCorrections; }
+	uint64_t					GetSkippedFrames() const { return mSkippedFrames; }
+
+private:
+	int64_t						mOffset;
+	int64_t						mTolerance;
+
+	std::atomic<int64_t>		mLastError;
+	std::atomic<uint64_t>		mCorrections;
+	std::atomic<uint64_t>		mSkippedFrames;
+};
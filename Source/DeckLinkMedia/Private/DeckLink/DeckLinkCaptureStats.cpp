@@ -0,0 +1,107 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkCaptureStats.h"
+
+#include <algorithm>
+#include <limits>
+
+DeckLinkRollingTiming::DeckLinkRollingTiming()
+	: mMin{ 0 }
+	, mAverage{ 0 }
+	, mMax{ 0 }
+	, mPeak{ 0 }
+	, mCount{ 0 }
+{
+	Reset();
+}
+
+void DeckLinkRollingTiming::Reset()
+{
+	mWindowMin = std::numeric_limits<int64_t>::max();
+	mWindowMax = 0;
+	mWindowSum = 0;
+	mWindowCount = 0;
+	mPublishedWindow = false;
+
+	mMin = 0;
+	mAverage = 0;
+	mMax = 0;
+	mPeak = 0;
+	mCount = 0;
+}
+
+void DeckLinkRollingTiming::Add( int64_t microseconds )
+{
+	mWindowMin = std::min( mWindowMin, microseconds );
+	mWindowMax = std::max( mWindowMax, microseconds );
+	mWindowSum += microseconds;
+	++mWindowCount;
+
+	if( microseconds > mPeak.load( std::memory_order_relaxed ) )
+		mPeak.store( microseconds, std::memory_order_relaxed );
+	mCount.store( mCount.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+
+	if( mWindowCount == WindowSize ) {
+		Publish();
+		mPublishedWindow = true;
+		mWindowMin = std::numeric_limits<int64_t>::max();
+		mWindowMax = 0;
+		mWindowSum = 0;
+		mWindowCount = 0;
+	}
+	else if( ! mPublishedWindow ) {
+		Publish();
+	}
+}
+
+void DeckLinkRollingTiming::Publish()
+{
+	mMin.store( mWindowMin, std::memory_order_relaxed );
+	mAverage.store( mWindowSum / mWindowCount, std::memory_order_relaxed );
+	mMax.store( mWindowMax, std::memory_order_relaxed );
+}
+
+DeckLinkCaptureStats::DeckLinkCaptureStats()
+	: mArrivedFrames{ 0 }
+	, mNoSignalFrames{ 0 }
+	, mCardDroppedFrames{ 0 }
+	, mCapturedFrames{ 0 }
+	, mConversionFailures{ 0 }
+	, mPoolExhaustedDrops{ 0 }
+	, mLastStreamTime{ 0 }
+	, mHasLastStreamTime{ false }
+{ }
+
+void DeckLinkCaptureStats::Reset()
+{
+	mArrivedFrames = 0;
+	mNoSignalFrames = 0;
+	mCardDroppedFrames = 0;
+	mCapturedFrames = 0;
+	mConversionFailures = 0;
+	mPoolExhaustedDrops = 0;
+	mLastStreamTime = 0;
+	mHasLastStreamTime = false;
+	mConversionTiming.Reset();
+	mProcessingTiming.Reset();
+}
+
+void DeckLinkCaptureStats::FrameArrived( int64_t streamTime, int64_t streamDuration )
+{
+	++mArrivedFrames;
+
+	// consecutive frames are one duration apart, anything more was never delivered
+	if( mHasLastStreamTime && streamDuration > 0 ) {
+		const int64_t frames = ( streamTime - mLastStreamTime + streamDuration / 2 ) / streamDuration;
+		if( frames > 1 )
+			mCardDroppedFrames += static_cast<uint64_t>( frames - 1 );
+	}
+	mLastStreamTime = streamTime;
+	mHasLastStreamTime = true;
+}
+
+void DeckLinkCaptureStats::FrameCaptured( int64_t conversionMicroseconds, int64_t processingMicroseconds )
+{
+	++mCapturedFrames;
+	mConversionTiming.Add( conversionMicroseconds );
+	mProcessingTiming.Add( processingMicroseconds );
+}
@@ -0,0 +1,133 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Rolling minimum, average and maximum of a duration in microseconds.
+ *
+ * Samples are gathered over a window of WindowSize and the finished window
+ * is published with a handful of relaxed stores, so the single writer never
+ * waits and readers on any thread see a consistent enough picture. Until
+ * the first window fills, the partial one is published as it grows.
+ */
+class DeckLinkRollingTiming {
+public:
+	static const uint32_t WindowSize = 64;
+
+	DeckLinkRollingTiming();
+
+	/** Writer side. */
+	void						Add( int64_t microseconds );
+	void						Reset();
+
+	int64_t						GetMin() const { return mMin.load( std::memory_order_relaxed ); }
+	int64_t						GetAverage() const { return mAverage.load( std::memory_order_relaxed ); }
+	int64_t						GetMax() const { return mMax.load( std::memory_order_relaxed ); }
+	/** Highest sample since the last Reset. */
+	int64_t						GetPeak() const { return mPeak.load( std::memory_order_relaxed ); }
+	uint64_t					GetCount() const { return mCount.load( std::memory_order_relaxed ); }
+
+private:
+	void						Publish();
+
+	// the window being gathered, only touched by the writer
+	int64_t						mWindowMin;
+	int64_t						mWindowMax;
+	int64_t						mWindowSum;
+	uint32_t					mWindowCount;
+	bool						mPublishedWindow;
+
+	std::atomic<int64_t>		mMin;
+	std::atomic<int64_t>		mAverage;
+	std::atomic<int64_t>		mMax;
+	std::atomic<int64_t>		mPeak;
+	std::atomic<uint64_t>		mCount;
+};
+
+/**
+ * Capture counters and timings of one device.
+ *
+ * Written from the driver callback and the processing thread only, each
+ * counter by exactly one of them, and read from anywhere without locking.
+ * Cleared when capture starts.
+ */
+class DeckLinkCaptureStats {
+public:
+	DeckLinkCaptureStats();
+
+	DeckLinkCaptureStats( const DeckLinkCaptureStats& ) = delete;
+	DeckLinkCaptureStats& operator=( const DeckLinkCaptureStats& ) = delete;
+
+	void						Reset();
+
+	/**
+	 * Driver callback side: counts a delivered video frame and, from the gap
+	 * in stream time since the previous one, the frames the card dropped.
+	 */
+	void						FrameArrived( int64_t streamTime, int64_t streamDuration );
+	void						NoSignalFrameArrived() { ++mNoSignalFrames; }
+
+	/** Processing thread side. */
+	void						FrameCaptured( int64_t conversionMicroseconds, int64_t processingMicroseconds );
+	void						ConversionFailed() { ++mConversionFailures; }
+	void						PoolExhausted() { ++mPoolExhaustedDrops; }
+
+	uint64_t					GetArrivedFrames() const { return mArrivedFrames; }
+	uint64_t					GetNoSignalFrames() const { return mNoSignalFrames; }
+	uint64_t					GetCardDroppedFrames() const { return mCardDroppedFrames; }
+	uint64_t					GetCapturedFrames() const { return mCapturedFrames; }
+	uint64_t					GetConversionFailures() const { return mConversionFailures; }
+	uint64_t					GetPoolExhaustedDrops() const { return mPoolExhaustedDrops; }
+
+	/** Time spent converting one frame. */
+	const DeckLinkRollingTiming&	GetConversionTiming() const { return mConversionTiming; }
+	/** Time from the driver callback to the frame being queued for the player. */
+	const DeckLinkRollingTiming&	GetProcessingTiming() const { return mProcessingTiming; }
+
+private:
+	std::atomic<uint64_t>		mArrivedFrames;
+	std::atomic<uint64_t>		mNoSignalFrames;
+	std::atomic<uint64_t>		mCardDroppedFrames;
+	std::atomic<uint64_t>		mCapturedFrames;
+	std::atomic<uint64_t>		mConversionFailures;
+	std::atomic<uint64_t>		mPoolExhaustedDrops;
+
+	// driver callback only
+	int64_t						mLastStreamTime;
+	bool						mHasLastStreamTime;
+
+	DeckLinkRollingTiming		mConversionTiming;
+	DeckLinkRollingTiming		mProcessingTiming;
+};
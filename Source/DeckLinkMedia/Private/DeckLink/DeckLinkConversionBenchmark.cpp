@@ -0,0 +1,301 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkConversionBenchmark.h"
+#include "DeckLinkFrameConverter.h"
+#include "DeckLinkTestPattern.h"
+#include "DeckLinkVirtualDevice.h"
+#include "DecklinkDevice.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <thread>
+#include <tuple>
+
+using namespace DeckLinkPixelConversion;
+
+namespace {
+	/** Captured frame stand-in, filled once with a test pattern. */
+	class BenchmarkSourceFrame : public IDeckLinkVideoFrame {
+	public:
+		BenchmarkSourceFrame( const DeckLinkTestPattern& pattern, BMDPixelFormat pixelFormat, uint64_t frameNumber )
+			: mWidth{ pattern.GetWidth() }
+			, mHeight{ pattern.GetHeight() }
+			, mRowBytes{ pattern.GetRowBytes() }
+			, mPixelFormat{ pixelFormat }
+			, mData{ static_cast<uint8_t*>( FMemory::Malloc( mRowBytes * mHeight, 64 ) ) }
+		{
+			pattern.Render( mData, mRowBytes, frameNumber );
+		}
+
+		~BenchmarkSourceFrame()
+		{
+			FMemory::Free( mData );
+		}
+
+		virtual long				STDMETHODCALLTYPE GetWidth() override { return mWidth; }
+		virtual long				STDMETHODCALLTYPE GetHeight() override { return mHeight; }
+		virtual long				STDMETHODCALLTYPE GetRowBytes() override { return mRowBytes; }
+		virtual BMDPixelFormat		STDMETHODCALLTYPE GetPixelFormat() override { return mPixelFormat; }
+		virtual BMDFrameFlags		STDMETHODCALLTYPE GetFlags() override { return bmdFrameFlagDefault; }
+		virtual HRESULT				STDMETHODCALLTYPE GetBytes( void** buffer ) override { *buffer = mData; return S_OK; }
+		virtual HRESULT				STDMETHODCALLTYPE GetTimecode( BMDTimecodeFormat format, IDeckLinkTimecode** timecode ) override { return E_NOINTERFACE; }
+		virtual HRESULT				STDMETHODCALLTYPE GetAncillaryData( IDeckLinkVideoFrameAncillary** ancillary ) override { return E_NOINTERFACE; }
+
+		// lives on the stack of the benchmark, the converters only borrow it
+		virtual HRESULT				STDMETHODCALLTYPE QueryInterface( REFIID iid, LPVOID* ppv ) override { return E_NOINTERFACE; }
+		virtual ULONG				STDMETHODCALLTYPE AddRef() override { return 1; }
+		virtual ULONG				STDMETHODCALLTYPE Release() override { return 1; }
+
+		uint64_t					GetSize() const { return static_cast<uint64_t>( mRowBytes ) * mHeight; }
+
+	private:
+		long						mWidth;
+		long						mHeight;
+		long						mRowBytes;
+		BMDPixelFormat				mPixelFormat;
+		uint8_t*					mData;
+	};
+
+	const DeckLinkConversionPath AllPaths[] = {
+		DeckLinkConversionPath::UYVYToBGRA8,
+		DeckLinkConversionPath::V210ToBGRA8,
+		DeckLinkConversionPath::V210ToA2B10G10R10,
+		DeckLinkConversionPath::V210ToRGBA16,
+	};
+
+	BMDPixelFormat GetSourceFormat( DeckLinkConversionPath path )
+	{
+		return ( path == DeckLinkConversionPath::UYVYToBGRA8 ) ? bmdFormat8BitYUV : bmdFormat10BitYUV;
+	}
+
+	OutputFormat GetOutputFormat( DeckLinkConversionPath path )
+	{
+		switch( path ) {
+		case DeckLinkConversionPath::V210ToA2B10G10R10:	return OutputFormat::A2B10G10R10;
+		case DeckLinkConversionPath::V210ToRGBA16:		return OutputFormat::RGBA16;
+		default:										return OutputFormat::BGRA8;
+		}
+	}
+
+	/** Converts frames until both the time and the frame minimum are reached. */
+	void Measure( DeckLinkFrameConverter& converter, BenchmarkSourceFrame* const sources[2], DeckLinkVideoFrame& destination, const DeckLinkConversionBenchmarkSettings& settings, DeckLinkConversionResult& result )
+	{
+		result.succeeded = ( converter.Convert( sources[0], &destination ) == S_OK );
+		if( ! result.succeeded )
+			return;
+
+		typedef std::chrono::steady_clock Clock;
+		const Clock::time_point start = Clock::now();
+		Clock::time_point now = start;
+		uint64_t frames = 0;
+		do {
+			converter.Convert( sources[frames & 1], &destination );
+			++frames;
+			now = Clock::now();
+		} while( frames < settings.minimumFrames || std::chrono::duration<double>( now - start ).count() < settings.secondsPerCase );
+
+		result.frames = frames;
+		result.seconds = std::chrono::duration<double>( now - start ).count();
+	}
+
+	std::string GetModeName( BMDDisplayMode mode )
+	{
+		const std::string name = DeckLinkDevice::GetDisplayModeString( mode );
+		return ( name.compare( 0, 5, "Mode " ) == 0 ) ? name.substr( 5 ) : name;
+	}
+}
+
+DeckLinkConversionBenchmarkSettings::DeckLinkConversionBenchmarkSettings()
+	: includeSdk{ true }
+	, secondsPerCase{ 0.5 }
+	, minimumFrames{ 5 }
+{
+	// powers of two up to every hardware thread
+	const uint32_t hardwareThreads = std::max( std::thread::hardware_concurrency(), 1u );
+	for( uint32_t threads = 1; threads < hardwareThreads; threads *= 2 )
+		threadCounts.push_back( threads );
+	threadCounts.push_back( hardwareThreads );
+
+	instructionSets.push_back( DetectInstructionSet() );
+}
+
+DeckLinkConversionBenchmark::DeckLinkConversionBenchmark( IDeckLinkVideoConversion* sdkConverter )
+	: mSdkConverter{ sdkConverter }
+{ }
+
+std::vector<DeckLinkConversionResult> DeckLinkConversionBenchmark::Run( const DeckLinkConversionBenchmarkSettings& settings, const std::function<void( const DeckLinkConversionResult& )>& progress ) const
+{
+	std::vector<BMDDisplayMode> modes = settings.modes;
+	if( modes.empty() ) {
+		size_t count = 0;
+		const DeckLinkVirtualModeInfo* all = DeckLinkVirtualModeInfo::GetAll( count );
+		for( size_t index = 0; index < count; ++index )
+			modes.push_back( all[index].mode );
+	}
+
+	std::vector<DeckLinkConversionPath> paths = settings.paths;
+	if( paths.empty() )
+		paths.assign( std::begin( AllPaths ), std::end( AllPaths ) );
+
+	// the kernels do not care about the frame rate, modes of the same size share measurements
+	typedef std::tuple<long, long, DeckLinkConversionPath, bool, InstructionSet, uint32_t> CaseKey;
+	std::map<CaseKey, DeckLinkConversionResult> measured;
+
+	std::vector<DeckLinkConversionResult> results;
+	for( BMDDisplayMode mode : modes ) {
+		const DeckLinkVirtualModeInfo* info = DeckLinkVirtualModeInfo::Find( mode );
+		if( info == NULL )
+			continue;
+
+		for( DeckLinkConversionPath path : paths ) {
+			const BMDPixelFormat sourceFormat = GetSourceFormat( path );
+			const OutputFormat outputFormat = GetOutputFormat( path );
+
+			// two different frames, sources are only built when a case is not measured yet
+			std::unique_ptr<DeckLinkTestPattern> pattern;
+			std::unique_ptr<BenchmarkSourceFrame> sourceFrames[2];
+			BenchmarkSourceFrame* sources[2] = { nullptr, nullptr };
+			DeckLinkVideoFrame destination;
+
+			auto runCase = [&]( bool sdk, InstructionSet isa, uint32_t threads ) {
+				DeckLinkConversionResult result;
+				result.mode = mode;
+				result.modeName = GetModeName( mode );
+				result.width = info->width;
+				result.height = info->height;
+				result.modeFps = static_cast<double>( info->timeScale ) / info->frameDuration;
+				result.path = path;
+				result.sdk = sdk;
+				result.instructionSet = isa;
+				result.threads = threads;
+				result.succeeded = false;
+				result.frames = 0;
+				result.seconds = 0.0;
+
+				const CaseKey key( info->width, info->height, path, sdk, isa, threads );
+				auto found = measured.find( key );
+				if( found != measured.end() ) {
+					result.succeeded = found->second.succeeded;
+					result.frames = found->second.frames;
+					result.seconds = found->second.seconds;
+					result.bytesPerFrame = found->second.bytesPerFrame;
+				}
+				else {
+					if( ! pattern ) {
+						const DeckLinkTestPattern::Format patternFormat = ( sourceFormat == bmdFormat10BitYUV ) ? DeckLinkTestPattern::Format::V210 : DeckLinkTestPattern::Format::UYVY;
+						pattern.reset( new DeckLinkTestPattern( info->width, info->height, patternFormat ) );
+						for( int index = 0; index < 2; ++index ) {
+							sourceFrames[index].reset( new BenchmarkSourceFrame( *pattern, sourceFormat, index * 31 ) );
+							sources[index] = sourceFrames[index].get();
+						}
+						destination.Allocate( info->width, info->height, outputFormat );
+					}
+
+					result.bytesPerFrame = sources[0]->GetSize() + static_cast<uint64_t>( destination.GetRowBytes() ) * info->height;
+
+					DeckLinkConverterSettings converterSettings;
+					converterSettings.type = sdk ? DeckLinkConverterType::Sdk : DeckLinkConverterType::Native;
+					converterSettings.instructionSet = isa;
+					converterSettings.workerThreads = threads - 1;
+					converterSettings.parallelMinHeight = 0;
+					std::unique_ptr<DeckLinkFrameConverter> converter = DeckLinkFrameConverter::Create( converterSettings, mSdkConverter );
+
+					Measure( *converter, sources, destination, settings, result );
+					measured[key] = result;
+				}
+
+				results.push_back( result );
+				if( progress )
+					progress( result );
+			};
+
+			for( InstructionSet requested : settings.instructionSets ) {
+				if( ResolveInstructionSet( requested ) != requested )
+					continue;
+				for( uint32_t threads : settings.threadCounts )
+					runCase( false, requested, std::max( threads, 1u ) );
+			}
+
+			if( settings.includeSdk && mSdkConverter != NULL && outputFormat == OutputFormat::BGRA8 )
+				runCase( true, InstructionSet::Scalar, 1 );
+		}
+	}
+	return results;
+}
+
+const char* DeckLinkConversionBenchmark::GetPathName( DeckLinkConversionPath path )
+{
+	switch( path ) {
+	case DeckLinkConversionPath::UYVYToBGRA8:			return "UYVYToBGRA8";
+	case DeckLinkConversionPath::V210ToBGRA8:			return "V210ToBGRA8";
+	case DeckLinkConversionPath::V210ToA2B10G10R10:		return "V210ToA2B10G10R10";
+	case DeckLinkConversionPath::V210ToRGBA16:			return "V210ToRGBA16";
+	default:											return "Unknown";
+	}
+}
+
+std::string DeckLinkConversionBenchmark::GetConverterName( const DeckLinkConversionResult& result )
+{
+	return result.sdk ? "SDK" : std::string( "Native " ) + GetInstructionSetName( result.instructionSet );
+}
+
+std::string DeckLinkConversionBenchmark::FormatLine( const DeckLinkConversionResult& result )
+{
+	char line[256];
+	if( ! result.succeeded ) {
+		snprintf( line, sizeof( line ), "%-14s %-18s %-14s %2u threads: failed", result.modeName.c_str(), GetPathName( result.path ), GetConverterName( result ).c_str(), result.threads );
+		return line;
+	}
+
+	snprintf( line, sizeof( line ), "%-14s %-18s %-14s %2u threads: %9.1f fps %10.1f MB/s %7.3f ns/pixel %6.2fx realtime",
+		result.modeName.c_str(), GetPathName( result.path ), GetConverterName( result ).c_str(), result.threads,
+		result.GetFramesPerSecond(), result.GetMegabytesPerSecond(), result.GetNanosecondsPerPixel(), result.GetRealtimeFactor() );
+	return line;
+}
+
+std::string DeckLinkConversionBenchmark::FormatCsv( const std::vector<DeckLinkConversionResult>& results )
+{
+	std::string csv = "mode,width,height,modeFps,path,converter,instructionSet,threads,succeeded,frames,seconds,fps,mbPerSecond,nsPerPixel,realtime\n";
+	char line[512];
+	for( const DeckLinkConversionResult& result : results ) {
+		snprintf( line, sizeof( line ), "%s,%ld,%ld,%.3f,%s,%s,%s,%u,%d,%llu,%.6f,%.3f,%.3f,%.4f,%.3f\n",
+			result.modeName.c_str(), result.width, result.height, result.modeFps,
+			GetPathName( result.path ), result.sdk ? "SDK" : "Native", result.sdk ? "" : GetInstructionSetName( result.instructionSet ), result.threads,
+			result.succeeded ? 1 : 0, static_cast<unsigned long long>( result.frames ), result.seconds,
+			result.GetFramesPerSecond(), result.GetMegabytesPerSecond(), result.GetNanosecondsPerPixel(), result.GetRealtimeFactor() );
+		csv += line;
+	}
+	return csv;
+}
+
+std::string DeckLinkConversionBenchmark::FormatJson( const std::vector<DeckLinkConversionResult>& results, const std::string& machine )
+{
+	std::string escaped;
+	for( char c : machine ) {
+		if( c == '"' || c == '\\' )
+			escaped += '\\';
+		if( static_cast<unsigned char>( c ) >= 0x20 )
+			escaped += c;
+	}
+
+	char line[512];
+	snprintf( line, sizeof( line ), "{\"machine\":\"%s\",\"hardwareThreads\":%u,\"instructionSet\":\"%s\",\"results\":[",
+		escaped.c_str(), std::thread::hardware_concurrency(), GetInstructionSetName( DetectInstructionSet() ) );
+	std::string json = line;
+
+	bool first = true;
+	for( const DeckLinkConversionResult& result : results ) {
+		snprintf( line, sizeof( line ), "%s\n{\"mode\":\"%s\",\"width\":%ld,\"height\":%ld,\"modeFps\":%.3f,\"path\":\"%s\",\"converter\":\"%s\",\"instructionSet\":\"%s\",\"threads\":%u,"
+			"\"succeeded\":%s,\"frames\":%llu,\"seconds\":%.6f,\"fps\":%.3f,\"mbPerSecond\":%.3f,\"nsPerPixel\":%.4f,\"realtime\":%.3f}",
+			first ? "" : ",",
+			result.modeName.c_str(), result.width, result.height, result.modeFps,
+			GetPathName( result.path ), result.sdk ? "SDK" : "Native", result.sdk ? "" : GetInstructionSetName( result.instructionSet ), result.threads,
+			result.succeeded ? "true" : "false", static_cast<unsigned long long>( result.frames ), result.seconds,
+			result.GetFramesPerSecond(), result.GetMegabytesPerSecond(), result.GetNanosecondsPerPixel(), result.GetRealtimeFactor() );
+		json += line;
+		first = false;
+	}
+	return json + "\n]}";
+}
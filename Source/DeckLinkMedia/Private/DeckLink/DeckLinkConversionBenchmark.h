@@ -0,0 +1,130 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "DeckLinkPlatform.h"
+#include "DeckLinkPixelConversion.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/** Source and destination layouts the frame converters handle. */
+enum class DeckLinkConversionPath {
+	UYVYToBGRA8,
+	V210ToBGRA8,
+	V210ToA2B10G10R10,
+	V210ToRGBA16,
+};
+
+struct DeckLinkConversionBenchmarkSettings {
+	DeckLinkConversionBenchmarkSettings();
+
+	/** Display modes to measure, every mode DeckLinkDevice::GetDisplayModeString knows if empty. */
+	std::vector<BMDDisplayMode>							modes;
+
+	/** Paths to measure, all of them if empty. */
+	std::vector<DeckLinkConversionPath>					paths;
+
+	/** Threads converting each frame, counting the calling thread. The native converter only. */
+	std::vector<uint32_t>								threadCounts;
+
+	/** Native kernel variants, unsupported ones are skipped. */
+	std::vector<DeckLinkPixelConversion::InstructionSet>	instructionSets;
+
+	/** Also measures the SDK converter, single threaded, for the paths it supports. */
+	bool												includeSdk;
+
+	/** Minimum time and frame count spent on each case after one warm up frame. */
+	double												secondsPerCase;
+	uint32_t											minimumFrames;
+};
+
+/** One converter configuration converting frames of one display mode. */
+struct DeckLinkConversionResult {
+	BMDDisplayMode							mode;
+	std::string								modeName;
+	long									width;
+	long									height;
+	double									modeFps;
+
+	DeckLinkConversionPath					path;
+	bool									sdk;
+	DeckLinkPixelConversion::InstructionSet	instructionSet;
+	uint32_t								threads;
+
+	/** False if the converter rejected the frame, nothing was measured. */
+	bool									succeeded;
+	uint64_t								frames;
+	double									seconds;
+
+	/** Source bytes read plus destination bytes written per frame. */
+	uint64_t								bytesPerFrame;
+
+	double									GetFramesPerSecond() const { return ( seconds > 0.0 ) ? frames / seconds : 0.0; }
+	double									GetMegabytesPerSecond() const { return GetFramesPerSecond() * bytesPerFrame / 1.0e6; }
+	double									GetNanosecondsPerPixel() const { return ( frames > 0 ) ? seconds * 1.0e9 / ( static_cast<double>( frames ) * width * height ) : 0.0; }
+
+	/** How many inputs of the mode one converter keeps up with. */
+	double									GetRealtimeFactor() const { return ( modeFps > 0.0 ) ? GetFramesPerSecond() / modeFps : 0.0; }
+};
+
+/**
+ * Measures the frame converters on synthetic frames, without a card.
+ *
+ * Every case runs a DeckLinkNativeConverter or DeckLinkSdkConverter exactly
+ * as a device would, on two alternating DeckLinkTestPattern frames so the
+ * source is not cache resident at HD and above. Modes that share a frame size
+ * are measured once and reported for each mode.
+ */
+class DeckLinkConversionBenchmark {
+public:
+	/** sdkConverter may be NULL, the SDK cases are skipped then. */
+	explicit DeckLinkConversionBenchmark( IDeckLinkVideoConversion* sdkConverter );
+
+	DeckLinkConversionBenchmark( const DeckLinkConversionBenchmark& ) = delete;
+	DeckLinkConversionBenchmark& operator=( const DeckLinkConversionBenchmark& ) = delete;
+
+	/** Runs every case, calling progress after each one. */
+	std::vector<DeckLinkConversionResult>	Run( const DeckLinkConversionBenchmarkSettings& settings, const std::function<void( const DeckLinkConversionResult& )>& progress ) const;
+
+	static const char*						GetPathName( DeckLinkConversionPath path );
+	static std::string						GetConverterName( const DeckLinkConversionResult& result );
+
+	/** One line per result, for the log. */
+	static std::string						FormatLine( const DeckLinkConversionResult& result );
+	static std::string						FormatCsv( const std::vector<DeckLinkConversionResult>& results );
+	static std::string						FormatJson( const std::vector<DeckLinkConversionResult>& results, const std::string& machine );
+
+private:
+	IDeckLinkVideoConversion*				mSdkConverter;
+};
@@ -0,0 +1,82 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkFrameConverter.h"
+
+using namespace DeckLinkPixelConversion;
+
+std::unique_ptr<DeckLinkFrameConverter> DeckLinkFrameConverter::Create( const DeckLinkConverterSettings& settings, IDeckLinkVideoConversion* sdkConverter )
+{
+	if( settings.type == DeckLinkConverterType::Sdk )
+		return std::unique_ptr<DeckLinkFrameConverter>( new DeckLinkSdkConverter( sdkConverter ) );
+
+	return std::unique_ptr<DeckLinkFrameConverter>( new DeckLinkNativeConverter( sdkConverter, settings ) );
+}
+
+HRESULT DeckLinkSdkConverter::Convert( IDeckLinkVideoFrame* source, DeckLinkVideoFrame* destination )
+{
+	if( mConverter == NULL )
+		return E_FAIL;
+
+	if( destination->GetOutputFormat() != OutputFormat::BGRA8 )
+		return E_NOTIMPL;
+
+	return mConverter->ConvertFrame( source, destination );
+}
+
+DeckLinkNativeConverter::DeckLinkNativeConverter( IDeckLinkVideoConversion* fallback, const DeckLinkConverterSettings& settings )
+	: mFallback{ fallback }
+	, mInstructionSet{ ResolveInstructionSet( settings.instructionSet ) }
+	, mWorkers{ settings.workerThreads > 0 ? new DeckLinkWorkerPool( settings.workerThreads ) : nullptr }
+	, mParallelMinHeight{ settings.parallelMinHeight }
+{ }
+
+std::string DeckLinkNativeConverter::GetDescription() const
+{
+	const uint32_t threads = mWorkers ? mWorkers->GetThreadCount() + 1 : 1;
+	return std::string( "Native (" ) + GetInstructionSetName( mInstructionSet ) + ", " + std::to_string( threads ) + ( threads == 1 ? " thread)" : " threads)" );
+}
+
+HRESULT DeckLinkNativeConverter::Convert( IDeckLinkVideoFrame* source, DeckLinkVideoFrame* destination )
+{
+	const long width = source->GetWidth();
+	const long height = source->GetHeight();
+
+	if( destination->GetWidth() != width || destination->GetHeight() != height )
+		return E_INVALIDARG;
+
+	void* sourceBytes = nullptr;
+	if( source->GetBytes( &sourceBytes ) != S_OK || sourceBytes == nullptr )
+		return E_FAIL;
+
+	const OutputFormat format = destination->GetOutputFormat();
+	const BMDPixelFormat pixelFormat = source->GetPixelFormat();
+
+	const bool supported = ( pixelFormat == bmdFormat10BitYUV ) || ( pixelFormat == bmdFormat8BitYUV && format == OutputFormat::BGRA8 );
+	if( ! supported )
+		return mFallback.Convert( source, destination );
+
+	const uint8_t* src = (const uint8_t*)sourceBytes;
+	const long srcRowBytes = source->GetRowBytes();
+	uint8_t* dst = destination->data();
+	const long dstRowBytes = destination->GetRowBytes();
+	const Colorimetry colorimetry = GetColorimetryForHeight( height );
+	const InstructionSet isa = mInstructionSet;
+
+	auto convertRows = [=]( long rowBegin, long rowEnd ) {
+		if( pixelFormat == bmdFormat10BitYUV )
+			ConvertV210( src, srcRowBytes, dst, dstRowBytes, width, rowBegin, rowEnd, format, colorimetry, isa );
+		else
+			ConvertUYVYToBGRA( src, srcRowBytes, dst, dstRowBytes, width, rowBegin, rowEnd, colorimetry, isa );
+	};
+
+	if( ! mWorkers || height < mParallelMinHeight ) {
+		convertRows( 0, height );
+		return S_OK;
+	}
+
+	const uint32_t stripes = mWorkers->GetThreadCount() + 1;
+	mWorkers->ParallelFor( stripes, [&]( uint32_t stripe ) {
+		convertRows( height * stripe / stripes, height * ( stripe + 1 ) / stripes );
+	} );
+
+	return S_OK;
+}
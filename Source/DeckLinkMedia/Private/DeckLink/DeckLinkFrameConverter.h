@@ -0,0 +1,111 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include "DeckLinkPlatform.h"
+#include "DeckLinkFramePool.h"
+#include "DeckLinkPixelConversion.h"
+#include "DeckLinkWorkerPool.h"
+
+#include <memory>
+#include <string>
+
+enum class DeckLinkConverterType {
+	Native,
+	Sdk,
+};
+
+/** How a device converts captured frames. */
+struct DeckLinkConverterSettings {
+	DeckLinkConverterSettings()
+		: type{ DeckLinkConverterType::Native }
+		, instructionSet{ DeckLinkPixelConversion::InstructionSet::AVX2 }
+		, workerThreads{ 0 }
+		, parallelMinHeight{ 1080 }
+	{ }
+
+	DeckLinkConverterType						type;
+	DeckLinkPixelConversion::InstructionSet		instructionSet;
+
+	/** Extra threads converting stripes alongside the capture thread, 0 converts serially. */
+	uint32_t									workerThreads;
+
+	/** Frames shorter than this are always converted serially. */
+	long										parallelMinHeight;
+};
+
+/**
+ * Converts captured frames into pool frames.
+ *
+ * The SDK converter wraps the shared IDeckLinkVideoConversion instance and can
+ * only produce BGRA. The native converter runs the in-plugin SIMD kernels
+ * (UYVY to BGRA, v210 to every output format) and hands anything else to the
+ * SDK converter.
+ */
+class DeckLinkFrameConverter {
+public:
+	virtual ~DeckLinkFrameConverter() { }
+
+	virtual HRESULT				Convert( IDeckLinkVideoFrame* source, DeckLinkVideoFrame* destination ) = 0;
+	virtual std::string			GetDescription() const = 0;
+
+	static std::unique_ptr<DeckLinkFrameConverter>	Create( const DeckLinkConverterSettings& settings, IDeckLinkVideoConversion* sdkConverter );
+};
+
+class DeckLinkSdkConverter : public DeckLinkFrameConverter {
+public:
+	explicit DeckLinkSdkConverter( IDeckLinkVideoConversion* converter ) : mConverter{ converter } { }
+
+	virtual HRESULT				Convert( IDeckLinkVideoFrame* source, DeckLinkVideoFrame* destination ) override;
+	virtual std::string			GetDescription() const override { return "SDK"; }
+
+private:
+	IDeckLinkVideoConversion*	mConverter;
+};
+
+/**
+ * Native converter. Large frames are split into horizontal stripes that run
+ * on a private worker pool, with the calling thread converting one of them.
+ */
+class DeckLinkNativeConverter : public DeckLinkFrameConverter {
+public:
+	DeckLinkNativeConverter( IDeckLinkVideoConversion* fallback, const DeckLinkConverterSettings& settings );
+
+	virtual HRESULT				Convert( IDeckLinkVideoFrame* source, DeckLinkVideoFrame* destination ) override;
+	virtual std::string			GetDescription() const override;
+
+private:
+	DeckLinkSdkConverter					mFallback;
+	DeckLinkPixelConversion::InstructionSet	mInstructionSet;
+	std::unique_ptr<DeckLinkWorkerPool>		mWorkers;
+	long									mParallelMinHeight;
+};
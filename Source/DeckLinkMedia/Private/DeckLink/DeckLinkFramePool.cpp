@@ -0,0 +1,136 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkFramePool.h"
+
+namespace {
+	uint32_t MaskForDepth( uint32_t depth )
+	{
+		return ( depth >= 32 ) ? 0xffffffffu : ( ( 1u << depth ) - 1u );
+	}
+}
+
+ULONG DeckLinkVideoFrame::Release()
+{
+	const uint32_t refCount = --mRefCount;
+	if( refCount == 0 && mPool != nullptr ) {
+		mPool->Recycle( this );
+	}
+	return refCount;
+}
+
+DeckLinkFramePool::DeckLinkFramePool( uint32_t depth )
+	: mDepth{ 0 }
+	, mFormat{ DeckLinkPixelConversion::OutputFormat::BGRA8 }
+	, mFreeMask{ 0 }
+	, mSlotsInUse{ 0 }
+	, mPeakSlotsInUse{ 0 }
+	, mExhaustedCount{ 0 }
+	, mReallocationCount{ 0 }
+{
+	SetDepth( depth );
+}
+
+bool DeckLinkFramePool::SetDepth( uint32_t depth )
+{
+	depth = FMath::Clamp<uint32_t>( depth, 1, MaxDepth );
+	if( depth == mDepth )
+		return true;
+
+	// a handle outliving the capture, in a sink or a frame callback, still points into the slots
+	if( mSlotsInUse != 0 )
+		return false;
+
+	mSlots.reset( new DeckLinkVideoFrame[depth] );
+	for( uint32_t index = 0; index < depth; ++index ) {
+		mSlots[index].mPool = this;
+		mSlots[index].mPoolIndex = static_cast<int32_t>( index );
+	}
+
+	mDepth = depth;
+	mFreeMask = MaskForDepth( depth );
+	mPeakSlotsInUse = 0;
+	return true;
+}
+
+void DeckLinkFramePool::Resize( long width, long height, DeckLinkPixelConversion::OutputFormat format )
+{
+	mFormat = format;
+
+	// Take every currently free slot out of circulation while it is resized,
+	// slots held by a consumer are resized lazily on their next Acquire.
+	uint32_t taken = mFreeMask.exchange( 0 );
+
+	for( uint32_t index = 0; index < mDepth; ++index ) {
+		if( ( taken & ( 1u << index ) ) && ! mSlots[index].Matches( width, height, format ) ) {
+			mSlots[index].Allocate( width, height, format );
+		}
+	}
+
+	mFreeMask.fetch_or( taken );
+}
+
+void DeckLinkFramePool::ReserveAncillary( size_t bytes )
+{
+	// as in Resize, a slot still held by a consumer keeps its old buffer
+	uint32_t taken = mFreeMask.exchange( 0 );
+
+	for( uint32_t index = 0; index < mDepth; ++index ) {
+		if( taken & ( 1u << index ) ) {
+			mSlots[index].mAncillary.Reserve( bytes );
+		}
+	}
+
+	mFreeMask.fetch_or( taken );
+}
+
+int32_t DeckLinkFramePool::AcquireIndex()
+{
+	uint32_t mask = mFreeMask.load();
+	while( mask != 0 ) {
+		const uint32_t index = FMath::CountTrailingZeros( mask );
+		if( mFreeMask.compare_exchange_weak( mask, mask & ~( 1u << index ) ) )
+			return static_cast<int32_t>( index );
+	}
+	return -1;
+}
+
+DeckLinkFrameRef DeckLinkFramePool::Acquire( long width, long height )
+{
+	const int32_t index = AcquireIndex();
+	if( index < 0 ) {
+		++mExhaustedCount;
+		return DeckLinkFrameRef();
+	}
+
+	DeckLinkVideoFrame* frame = &mSlots[index];
+	const DeckLinkPixelConversion::OutputFormat format = mFormat.load();
+	if( ! frame->Matches( width, height, format ) ) {
+		// only happens when the signal changes without Resize being called first
+		++mReallocationCount;
+		frame->Allocate( width, height, format );
+	}
+
+	const uint32_t inUse = ++mSlotsInUse;
+	uint32_t peak = mPeakSlotsInUse.load();
+	while( inUse > peak && ! mPeakSlotsInUse.compare_exchange_weak( peak, inUse ) ) { }
+
+	check( frame->mRefCount == 0 );
+	return DeckLinkFrameRef( frame );
+}
+
+void DeckLinkFramePool::Recycle( DeckLinkVideoFrame* frame )
+{
+	check( frame->mPoolIndex >= 0 && frame->mPoolIndex < static_cast<int32_t>( mDepth ) );
+	check( &mSlots[frame->mPoolIndex] == frame );
+
+	--mSlotsInUse;
+	mFreeMask.fetch_or( 1u << frame->mPoolIndex );
+}
+
+size_t DeckLinkFramePool::GetAllocatedBytes() const
+{
+	size_t bytes = 0;
+	for( uint32_t index = 0; index < mDepth; ++index ) {
+		bytes += mSlots[index].AllocatedBytes() + mSlots[index].GetAncillaryPackets().GetCapacity();
+	}
+	return bytes;
+}
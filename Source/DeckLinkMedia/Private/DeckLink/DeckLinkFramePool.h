@@ -0,0 +1,225 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "DeckLinkPlatform.h"
+#include "DeckLinkPixelConversion.h"
+#include "DeckLinkTimecode.h"
+#include "DeckLinkAncillary.h"
+#include "DeckLinkLatency.h"
+#include "DeckLinkMediaStats.h"
+#include "CoreMinimal.h"
+#include "Templates/RefCounting.h"
+
+#include <atomic>
+#include <memory>
+
+class DeckLinkFramePool;
+
+/**
+ * Capture times of a frame, all in DeckLinkFrameTimes::TimeScale units
+ * (100ns, the same ticks as FTimespan).
+ *
+ * Stream time counts from StartStreams on the input's own clock; the
+ * hardware reference time is on the card's free running clock and can be
+ * compared with IDeckLinkInput::GetHardwareReferenceClock to measure latency.
+ *
+ * The sequence number counts every video frame the driver delivered since
+ * Start, including the ones dropped before reaching the player, so a gap
+ * between two frames tells how many were lost in between.
+ */
+struct DeckLinkFrameTimes {
+	static const int64_t TimeScale = 10000000;
+
+	DeckLinkFrameTimes() : streamTime{ 0 }, streamDuration{ 0 }, hardwareTime{ 0 }, hardwareDuration{ 0 }, sequence{ 0 } { }
+
+	int64_t streamTime;
+	int64_t streamDuration;
+	int64_t hardwareTime;
+	int64_t hardwareDuration;
+	uint64_t sequence;
+};
+
+/**
+ * A converted video frame living in a DeckLinkFramePool slot.
+ *
+ * The frame implements IDeckLinkVideoFrame so it can be handed to the SDK
+ * converter as a destination. Its storage is only (re)allocated when the
+ * requested dimensions change, never per captured frame. AddRef/Release are
+ * real reference counts: the slot goes back to its pool when the last
+ * DeckLinkFrameRef lets go of it.
+ */
+class DeckLinkVideoFrame : public IDeckLinkVideoFrame {
+public:
+
+	typedef DeckLinkPixelConversion::OutputFormat OutputFormat;
+
+	/** Pixel rows start on a cache line so the SIMD kernels never split a load. */
+	static const size_t DataAlignment = 64;
+
+	DeckLinkVideoFrame() : mWidth{ 0 }, mHeight{ 0 }, mFormat{ OutputFormat::BGRA8 }, mData{ nullptr }, mCapacity{ 0 }, mPool{ nullptr }, mPoolIndex{ -1 }, mRefCount{ 0 } { }
+	~DeckLinkVideoFrame()
+	{
+		DEC_MEMORY_STAT_BY( STAT_DeckLinkMedia_FramePoolMemory, mCapacity.load( std::memory_order_relaxed ) );
+		FMemory::Free( mData );
+	}
+
+	void Allocate( long width, long height, OutputFormat format )
+	{
+		mWidth = width;
+		mHeight = height;
+		mFormat = format;
+
+		// like a vector, only grows
+		const size_t bytes = height * width * DeckLinkPixelConversion::GetBytesPerPixel( format );
+		const size_t capacity = mCapacity.load( std::memory_order_relaxed );
+		if( bytes > capacity ) {
+			FMemory::Free( mData );
+			mData = static_cast<uint8_t*>( FMemory::Malloc( bytes, DataAlignment ) );
+			INC_MEMORY_STAT_BY( STAT_DeckLinkMedia_FramePoolMemory, bytes - capacity );
+			mCapacity.store( bytes, std::memory_order_relaxed );
+		}
+	}
+
+	bool Matches( long width, long height, OutputFormat format ) const { return mWidth == width && mHeight == height && mFormat == format; }
+	OutputFormat GetOutputFormat() const { return mFormat; }
+	size_t AllocatedBytes() const { return mCapacity.load( std::memory_order_relaxed ); }
+	int32_t PoolIndex() const { return mPoolIndex; }
+
+	const DeckLinkFrameTimes& GetTimes() const { return mTimes; }
+	void SetTimes( const DeckLinkFrameTimes& times ) { mTimes = times; }
+
+	/** When the frame passed each stage up to the capture queue. */
+	const DeckLinkStageTimes& GetStageTimes() const { return mStageTimes; }
+	void SetStageTimes( const DeckLinkStageTimes& stageTimes ) { mStageTimes = stageTimes; }
+
+	const DeckLinkTimecodes& GetTimecodes() const { return mTimecodes; }
+	void SetTimecodes( const DeckLinkTimecodes& timecodes ) { mTimecodes = timecodes; }
+
+	/** Ancillary packets captured with the frame, sized by DeckLinkFramePool::ReserveAncillary. */
+	const DeckLinkAncillaryBuffer& GetAncillaryPackets() const { return mAncillary; }
+	DeckLinkAncillaryBuffer& GetAncillaryPackets() { return mAncillary; }
+
+	uint8_t * data() const { return mData; }
+
+	//override these methods for virtual
+	virtual long			GetWidth( void ) { return mWidth; }
+	virtual long			GetHeight( void ) { return mHeight; }
+	virtual long			GetRowBytes( void ) { return mWidth * DeckLinkPixelConversion::GetBytesPerPixel( mFormat ); }
+	// the 10 and 16-bit layouts have no SDK equivalent, so only BGRA frames can take the SDK converter
+	virtual BMDPixelFormat	GetPixelFormat( void ) { return ( mFormat == OutputFormat::BGRA8 ) ? bmdFormat8BitBGRA : static_cast<BMDPixelFormat>( 0 ); }
+	virtual BMDFrameFlags	GetFlags( void ) { return 0; }
+	virtual HRESULT			GetBytes( void **buffer )
+	{
+		*buffer = mData;
+		return S_OK;
+	}
+
+	virtual HRESULT			GetTimecode( BMDTimecodeFormat format, IDeckLinkTimecode **timecode ) { return E_NOINTERFACE; };
+	virtual HRESULT			GetAncillaryData( IDeckLinkVideoFrameAncillary **ancillary ) { return E_NOINTERFACE; };
+	virtual HRESULT			QueryInterface( REFIID iid, LPVOID *ppv ) { return E_NOINTERFACE; }
+	virtual ULONG			AddRef() { return ++mRefCount; }
+	virtual ULONG			Release();
+private:
+	long mWidth, mHeight;
+	OutputFormat mFormat;
+	uint8_t* mData;
+	// read by the stats on another thread while a resize grows it
+	std::atomic<size_t> mCapacity;
+	DeckLinkFrameTimes mTimes;
+	DeckLinkStageTimes mStageTimes;
+	DeckLinkTimecodes mTimecodes;
+	DeckLinkAncillaryBuffer mAncillary;
+
+	DeckLinkFramePool* mPool;
+	int32_t mPoolIndex;
+	std::atomic<uint32_t> mRefCount;
+	friend class DeckLinkFramePool;
+};
+
+/** Shared, read-only handle to a pooled frame. */
+typedef TRefCountPtr<DeckLinkVideoFrame> DeckLinkFrameRef;
+
+/**
+ * Fixed set of preallocated capture frames for one device.
+ *
+ * Slots are sized when a display mode is selected, so the capture callback
+ * only ever picks a free slot instead of allocating. Acquiring is lock-free,
+ * and a slot is returned from whichever thread drops its last reference.
+ */
+class DeckLinkFramePool {
+public:
+	static const uint32_t DefaultDepth = 4;
+	static const uint32_t MaxDepth = 32;
+
+	explicit DeckLinkFramePool( uint32_t depth = DefaultDepth );
+
+	DeckLinkFramePool( const DeckLinkFramePool& ) = delete;
+	DeckLinkFramePool& operator=( const DeckLinkFramePool& ) = delete;
+
+	/** Changes the number of slots, returns false and keeps the current ones while any slot is still held. */
+	bool						SetDepth( uint32_t depth );
+
+	/** Preallocates every free slot for the given frame size and output format. May run while another thread acquires. */
+	void						Resize( long width, long height, DeckLinkPixelConversion::OutputFormat format );
+
+	/** Preallocates the ancillary packet buffer of every free slot. */
+	void						ReserveAncillary( size_t bytes );
+
+	/** Returns a free slot sized for width x height in the current format, or an empty handle if all slots are in use. */
+	DeckLinkFrameRef			Acquire( long width, long height );
+
+	/** Maps a slot index, as published between threads, back to its frame. */
+	DeckLinkVideoFrame*			GetSlot( int32_t index ) { return &mSlots[index]; }
+
+	uint32_t					GetDepth() const { return mDepth; }
+	uint32_t					GetSlotsInUse() const { return mSlotsInUse; }
+	uint32_t					GetPeakSlotsInUse() const { return mPeakSlotsInUse; }
+	uint64_t					GetExhaustedCount() const { return mExhaustedCount; }
+	uint64_t					GetReallocationCount() const { return mReallocationCount; }
+	size_t						GetAllocatedBytes() const;
+
+private:
+	int32_t						AcquireIndex();
+	void						Recycle( DeckLinkVideoFrame* frame );
+
+	std::unique_ptr<DeckLinkVideoFrame[]>	mSlots;
+	uint32_t							mDepth;
+	std::atomic<DeckLinkPixelConversion::OutputFormat>	mFormat;
+
+	std::atomic<uint32_t>				mFreeMask;
+	std::atomic<uint32_t>				mSlotsInUse;
+	std::atomic<uint32_t>				mPeakSlotsInUse;
+	std::atomic<uint64_t>				mExhaustedCount;
+	std::atomic<uint64_t>				mReallocationCount;
+
+	friend class DeckLinkVideoFrame;
+};
@@ -0,0 +1,169 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkFrameQueue.h"
+
+#include <chrono>
+
+DeckLinkFrameQueue::DeckLinkFrameQueue()
+	: mDepth{ 1 }
+	, mPolicy{ DeckLinkQueuePolicy::LatestOnly }
+	, mLatest{ nullptr }
+	, mFrames{ new DeckLinkFrameRef[MaxDepth] }
+	, mHead{ 0 }
+	, mCount{ 0 }
+	, mInterrupted{ false }
+	, mPushedCount{ 0 }
+	, mPoppedCount{ 0 }
+	, mOverwrittenCount{ 0 }
+	, mDroppedOldestCount{ 0 }
+	, mDroppedNewestCount{ 0 }
+	, mBlockedCount{ 0 }
+	, mBlockedMicroseconds{ 0 }
+{ }
+
+DeckLinkFrameQueue::~DeckLinkFrameQueue()
+{
+	Clear();
+}
+
+void DeckLinkFrameQueue::Configure( uint32_t depth, DeckLinkQueuePolicy policy )
+{
+	Clear();
+
+	mPolicy = policy;
+	mDepth = ( policy == DeckLinkQueuePolicy::LatestOnly ) ? 1 : FMath::Clamp<uint32_t>( depth, 1, MaxDepth );
+}
+
+bool DeckLinkFrameQueue::Push( const DeckLinkFrameRef& frame )
+{
+	if( mPolicy == DeckLinkQueuePolicy::LatestOnly )
+		return PushLatest( frame );
+
+	std::unique_lock<std::mutex> lock( mMutex );
+
+	if( mCount == mDepth ) {
+		switch( mPolicy ) {
+		case DeckLinkQueuePolicy::DropNewest:
+			++mDroppedNewestCount;
+			return false;
+
+		case DeckLinkQueuePolicy::DropOldest:
+			mFrames[mHead].SafeRelease();
+			mHead = ( mHead + 1 ) % mDepth;
+			--mCount;
+			++mDroppedOldestCount;
+			break;
+
+		case DeckLinkQueuePolicy::Block:
+		{
+			++mBlockedCount;
+			const auto waitStart = std::chrono::steady_clock::now();
+			mSpaceAvailable.wait( lock, [this]() { return mCount < mDepth || mInterrupted; } );
+			mBlockedMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - waitStart ).count();
+			if( mCount == mDepth )
+				return false;
+			break;
+		}
+
+		default:
+			return false;
+		}
+	}
+
+	mFrames[( mHead + mCount ) % mDepth] = frame;
+	++mCount;
+	++mPushedCount;
+	return true;
+}
+
+DeckLinkFrameRef DeckLinkFrameQueue::Pop()
+{
+	if( mPolicy == DeckLinkQueuePolicy::LatestOnly )
+		return PopLatest();
+
+	DeckLinkFrameRef frame;
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		if( mCount == 0 )
+			return frame;
+
+		frame = mFrames[mHead];
+		mFrames[mHead].SafeRelease();
+		mHead = ( mHead + 1 ) % mDepth;
+		--mCount;
+	}
+
+	++mPoppedCount;
+	mSpaceAvailable.notify_one();
+	return frame;
+}
+
+bool DeckLinkFrameQueue::PushLatest( const DeckLinkFrameRef& frame )
+{
+	// the slot owns one reference to whatever frame it holds
+	DeckLinkVideoFrame* incoming = frame.GetReference();
+	incoming->AddRef();
+
+	DeckLinkVideoFrame* previous = mLatest.exchange( incoming );
+	if( previous != nullptr ) {
+		// the consumer never picked this one up
+		previous->Release();
+		++mOverwrittenCount;
+	}
+
+	++mPushedCount;
+	return true;
+}
+
+DeckLinkFrameRef DeckLinkFrameQueue::PopLatest()
+{
+	DeckLinkVideoFrame* latest = mLatest.exchange( nullptr );
+	if( latest == nullptr )
+		return DeckLinkFrameRef();
+
+	++mPoppedCount;
+
+	// adopt the reference the slot was holding
+	return DeckLinkFrameRef( latest, false );
+}
+
+void DeckLinkFrameQueue::Clear()
+{
+	DeckLinkVideoFrame* latest = mLatest.exchange( nullptr );
+	if( latest != nullptr )
+		latest->Release();
+
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		for( uint32_t index = 0; index < MaxDepth; ++index ) {
+			mFrames[index].SafeRelease();
+		}
+		mHead = 0;
+		mCount = 0;
+	}
+
+	mSpaceAvailable.notify_all();
+}
+
+void DeckLinkFrameQueue::Interrupt()
+{
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mInterrupted = true;
+	}
+	mSpaceAvailable.notify_all();
+}
+
+void DeckLinkFrameQueue::Resume()
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	mInterrupted = false;
+}
+
+uint32_t DeckLinkFrameQueue::Num() const
+{
+	if( mPolicy == DeckLinkQueuePolicy::LatestOnly )
+		return ( mLatest.load() != nullptr ) ? 1 : 0;
+
+	std::lock_guard<std::mutex> lock( mMutex );
+	return mCount;
+}
@@ -0,0 +1,126 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include "DeckLinkFramePool.h"
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+enum class DeckLinkQueuePolicy {
+	/** Keep only the newest frame; an unread frame is overwritten. Lowest latency. */
+	LatestOnly,
+
+	/** When full, discard the oldest queued frame to make room. */
+	DropOldest,
+
+	/** When full, discard the incoming frame. */
+	DropNewest,
+
+	/** When full, wait on the processing thread until the consumer catches up. */
+	Block,
+};
+
+/**
+ * Converted frames waiting for the consumer.
+ *
+ * Written by the device's processing thread and read by whoever calls
+ * GetFrame. LatestOnly is a lock-free single slot exchange; the other
+ * policies keep up to depth frames in a small ring guarded by a mutex that
+ * is only held to move references, never while touching pixels.
+ */
+class DeckLinkFrameQueue {
+public:
+	static const uint32_t MaxDepth = 16;
+
+	DeckLinkFrameQueue();
+	~DeckLinkFrameQueue();
+
+	DeckLinkFrameQueue( const DeckLinkFrameQueue& ) = delete;
+	DeckLinkFrameQueue& operator=( const DeckLinkFrameQueue& ) = delete;
+
+	/** Changes depth and policy and drops anything queued. Only valid while capture is stopped. */
+	void						Configure( uint32_t depth, DeckLinkQueuePolicy policy );
+
+	/** Producer side. Returns false if the frame was not queued. */
+	bool						Push( const DeckLinkFrameRef& frame );
+
+	/** Consumer side. Returns the oldest queued frame, or an empty handle. */
+	DeckLinkFrameRef			Pop();
+
+	/** Releases every queued frame. */
+	void						Clear();
+
+	/** Makes a waiting or future Push under the Block policy give up, so the producer can be joined. */
+	void						Interrupt();
+	void						Resume();
+
+	uint32_t					GetDepth() const { return mDepth; }
+	DeckLinkQueuePolicy			GetPolicy() const { return mPolicy; }
+	uint32_t					Num() const;
+
+	uint64_t					GetPushedCount() const { return mPushedCount; }
+	uint64_t					GetPoppedCount() const { return mPoppedCount; }
+	uint64_t					GetOverwrittenCount() const { return mOverwrittenCount; }
+	uint64_t					GetDroppedOldestCount() const { return mDroppedOldestCount; }
+	uint64_t					GetDroppedNewestCount() const { return mDroppedNewestCount; }
+	uint64_t					GetBlockedCount() const { return mBlockedCount; }
+	uint64_t					GetBlockedMicroseconds() const { return mBlockedMicroseconds; }
+
+private:
+	bool						PushLatest( const DeckLinkFrameRef& frame );
+	DeckLinkFrameRef			PopLatest();
+
+	uint32_t					mDepth;
+	DeckLinkQueuePolicy			mPolicy;
+
+	// LatestOnly: the slot owns one reference to the frame it points at
+	std::atomic<DeckLinkVideoFrame*>	mLatest;
+
+	// everything else: ring of mDepth references
+	mutable std::mutex					mMutex;
+	std::condition_variable				mSpaceAvailable;
+	std::unique_ptr<DeckLinkFrameRef[]>	mFrames;
+	uint32_t							mHead;
+	uint32_t							mCount;
+	bool								mInterrupted;
+
+	std::atomic<uint64_t>				mPushedCount;
+	std::atomic<uint64_t>				mPoppedCount;
+	std::atomic<uint64_t>				mOverwrittenCount;
+	std::atomic<uint64_t>				mDroppedOldestCount;
+	std::atomic<uint64_t>				mDroppedNewestCount;
+	std::atomic<uint64_t>				mBlockedCount;
+	std::atomic<uint64_t>				mBlockedMicroseconds;
+};
@@ -0,0 +1,149 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkLatency.h"
+
+#include <cstdio>
+
+DeckLinkLatencyHistogram::DeckLinkLatencyHistogram()
+{
+	Reset();
+}
+
+uint32_t DeckLinkLatencyHistogram::GetBucket( int64_t microseconds )
+{
+	if( microseconds < 2 * SubBuckets )
+		return ( microseconds < 0 ) ? 0 : static_cast<uint32_t>( microseconds );
+
+	const uint32_t octave = FMath::FloorLog2_64( static_cast<uint64>( microseconds ) );
+	if( octave > MaxOctave )
+		return BucketCount - 1;
+
+	const uint32_t subBucket = static_cast<uint32_t>( microseconds >> ( octave - SubBucketBits ) ) & ( SubBuckets - 1 );
+	return 2 * SubBuckets + ( octave - SubBucketBits - 1 ) * SubBuckets + subBucket;
+}
+
+int64_t DeckLinkLatencyHistogram::GetBucketLowerBound( uint32_t bucket )
+{
+	if( bucket < 2 * SubBuckets )
+		return bucket;
+
+	const uint32_t octave = ( bucket - 2 * SubBuckets ) / SubBuckets + SubBucketBits + 1;
+	const uint32_t subBucket = ( bucket - 2 * SubBuckets ) % SubBuckets;
+	return static_cast<int64_t>( SubBuckets + subBucket ) << ( octave - SubBucketBits );
+}
+
+int64_t DeckLinkLatencyHistogram::GetBucketUpperBound( uint32_t bucket )
+{
+	if( bucket < 2 * SubBuckets )
+		return bucket + 1;
+
+	const uint32_t octave = ( bucket - 2 * SubBuckets ) / SubBuckets + SubBucketBits + 1;
+	return GetBucketLowerBound( bucket ) + ( int64_t( 1 ) << ( octave - SubBucketBits ) );
+}
+
+void DeckLinkLatencyHistogram::Record( int64_t microseconds )
+{
+	mBuckets[GetBucket( microseconds )].fetch_add( 1, std::memory_order_relaxed );
+	mCount.fetch_add( 1, std::memory_order_relaxed );
+	mSum.fetch_add( microseconds, std::memory_order_relaxed );
+
+	int64_t max = mMax.load( std::memory_order_relaxed );
+	while( microseconds > max && ! mMax.compare_exchange_weak( max, microseconds, std::memory_order_relaxed ) ) { }
+}
+
+void DeckLinkLatencyHistogram::Reset()
+{
+	for( auto& bucket : mBuckets )
+		bucket.store( 0, std::memory_order_relaxed );
+	mCount = 0;
+	mSum = 0;
+	mMax = 0;
+}
+
+int64_t DeckLinkLatencyHistogram::GetMean() const
+{
+	const uint64_t count = GetCount();
+	return ( count > 0 ) ? mSum.load( std::memory_order_relaxed ) / static_cast<int64_t>( count ) : 0;
+}
+
+int64_t DeckLinkLatencyHistogram::GetPercentile( double fraction ) const
+{
+	// total from the buckets themselves, so a concurrent Record cannot push the target past the end
+	uint64_t total = 0;
+	for( const auto& bucket : mBuckets )
+		total += bucket.load( std::memory_order_relaxed );
+	if( total == 0 )
+		return 0;
+
+	const uint64_t target = FMath::Max<uint64_t>( 1, static_cast<uint64_t>( FMath::CeilToDouble( FMath::Clamp( fraction, 0.0, 1.0 ) * total ) ) );
+	uint64_t seen = 0;
+	for( uint32_t bucket = 0; bucket < BucketCount; ++bucket ) {
+		seen += GetBucketCount( bucket );
+		if( seen >= target )
+			return GetBucketUpperBound( bucket );
+	}
+	return GetBucketUpperBound( BucketCount - 1 );
+}
+
+const char* DeckLinkLatency::GetStageName( DeckLinkLatencyStage stage )
+{
+	switch( stage ) {
+	case DeckLinkLatencyStage::Arrival:		return "Arrival";
+	case DeckLinkLatencyStage::Dispatch:	return "Dispatch";
+	case DeckLinkLatencyStage::Conversion:	return "Conversion";
+	case DeckLinkLatencyStage::QueueWait:	return "QueueWait";
+	case DeckLinkLatencyStage::Upload:		return "Upload";
+	case DeckLinkLatencyStage::Total:		return "Total";
+	default:								return "Unknown";
+	}
+}
+
+void DeckLinkLatency::Reset()
+{
+	for( auto& stage : mStages )
+		stage.Reset();
+}
+
+std::string DeckLinkLatency::Format() const
+{
+	static const int StageCount = static_cast<int>( DeckLinkLatencyStage::Count );
+
+	std::string result;
+	char line[256];
+
+	snprintf( line, sizeof( line ), "%-12s %10s %8s %8s %8s %8s %8s %8s\n", "Stage (us)", "Count", "Mean", "p50", "p90", "p99", "p99.9", "Max" );
+	result += line;
+	for( int stage = 0; stage < StageCount; ++stage ) {
+		const DeckLinkLatencyHistogram& histogram = mStages[stage];
+		snprintf( line, sizeof( line ), "%-12s %10llu %8lld %8lld %8lld %8lld %8lld %8lld\n",
+			GetStageName( static_cast<DeckLinkLatencyStage>( stage ) ),
+			static_cast<unsigned long long>( histogram.GetCount() ),
+			static_cast<long long>( histogram.GetMean() ),
+			static_cast<long long>( histogram.GetPercentile( 0.5 ) ),
+			static_cast<long long>( histogram.GetPercentile( 0.9 ) ),
+			static_cast<long long>( histogram.GetPercentile( 0.99 ) ),
+			static_cast<long long>( histogram.GetPercentile( 0.999 ) ),
+			static_cast<long long>( histogram.GetMax() ) );
+		result += line;
+	}
+
+	for( int stage = 0; stage < StageCount; ++stage ) {
+		const DeckLinkLatencyHistogram& histogram = mStages[stage];
+		if( histogram.GetCount() == 0 )
+			continue;
+
+		snprintf( line, sizeof( line ), "\n%s buckets (us)\n", GetStageName( static_cast<DeckLinkLatencyStage>( stage ) ) );
+		result += line;
+		for( uint32_t bucket = 0; bucket < DeckLinkLatencyHistogram::BucketCount; ++bucket ) {
+			const uint64_t count = histogram.GetBucketCount( bucket );
+			if( count == 0 )
+				continue;
+
+			snprintf( line, sizeof( line ), "%10lld - %-10lld %10llu\n",
+				static_cast<long long>( DeckLinkLatencyHistogram::GetBucketLowerBound( bucket ) ),
+				static_cast<long long>( DeckLinkLatencyHistogram::GetBucketUpperBound( bucket ) ),
+				static_cast<unsigned long long>( count ) );
+			result += line;
+		}
+	}
+	return result;
+}
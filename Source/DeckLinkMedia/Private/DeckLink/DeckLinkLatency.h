@@ -0,0 +1,137 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/** Stages a frame passes between the card and the texture sink. */
+enum class DeckLinkLatencyStage {
+	/** Start of the frame on the card's hardware clock to the driver callback. */
+	Arrival,
+	/** Driver callback to the processing thread starting its conversion. */
+	Dispatch,
+	/** Pixel conversion. */
+	Conversion,
+	/** Converted frame waiting in the capture queue until TickVideo picks it up. */
+	QueueWait,
+	/** UpdateTextureSinkBuffer. */
+	Upload,
+	/** Driver callback to the frame having been handed to the texture sink. */
+	Total,
+
+	Count
+};
+
+/** When a frame reached each stage, in DeckLinkLatency::Now microseconds, 0 if it has not yet. */
+struct DeckLinkStageTimes {
+	DeckLinkStageTimes() : arrival{ 0 }, conversionStart{ 0 }, conversionEnd{ 0 }, queued{ 0 } { }
+
+	int64_t arrival;
+	int64_t conversionStart;
+	int64_t conversionEnd;
+	int64_t queued;
+};
+
+/**
+ * Log-bucketed histogram of durations in microseconds.
+ *
+ * Values below 16us get a bucket each, above that every power of two is
+ * split into 8 buckets, so any value is off by at most 1/8th while the
+ * whole range up to minutes fits in a few hundred counters. Recording is a
+ * relaxed increment and can happen on any number of threads at once.
+ */
+class DeckLinkLatencyHistogram {
+public:
+	static const uint32_t SubBucketBits = 3;
+	static const uint32_t SubBuckets = 1 << SubBucketBits;
+	static const uint32_t MaxOctave = 30;
+	static const uint32_t BucketCount = 2 * SubBuckets + ( MaxOctave - SubBucketBits ) * SubBuckets;
+
+	DeckLinkLatencyHistogram();
+
+	DeckLinkLatencyHistogram( const DeckLinkLatencyHistogram& ) = delete;
+	DeckLinkLatencyHistogram& operator=( const DeckLinkLatencyHistogram& ) = delete;
+
+	void						Record( int64_t microseconds );
+
+	/** Not synchronized with Record, samples recorded meanwhile may or may not survive. */
+	void						Reset();
+
+	uint64_t					GetCount() const { return mCount.load( std::memory_order_relaxed ); }
+	int64_t						GetMax() const { return mMax.load( std::memory_order_relaxed ); }
+	int64_t						GetMean() const;
+
+	/** Upper bound of the bucket holding the given fraction (0..1) of the samples, 0 if there are none. */
+	int64_t						GetPercentile( double fraction ) const;
+
+	uint64_t					GetBucketCount( uint32_t bucket ) const { return mBuckets[bucket].load( std::memory_order_relaxed ); }
+	static uint32_t				GetBucket( int64_t microseconds );
+	static int64_t				GetBucketLowerBound( uint32_t bucket );
+	static int64_t				GetBucketUpperBound( uint32_t bucket );
+
+private:
+	std::atomic<uint64_t>		mBuckets[BucketCount];
+	std::atomic<uint64_t>		mCount;
+	std::atomic<int64_t>		mSum;
+	std::atomic<int64_t>		mMax;
+};
+
+/** One histogram per DeckLinkLatencyStage, kept per device. */
+class DeckLinkLatency {
+public:
+	/** The clock every DeckLinkStageTimes is taken on. */
+	static int64_t				Now() { return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count(); }
+
+	static const char*			GetStageName( DeckLinkLatencyStage stage );
+
+	void						Record( DeckLinkLatencyStage stage, int64_t microseconds ) { mStages[static_cast<int>( stage )].Record( microseconds ); }
+
+	/** Records end - start unless either time was never taken. */
+	void						Record( DeckLinkLatencyStage stage, int64_t start, int64_t end )
+	{
+		if( start != 0 && end != 0 )
+			Record( stage, end - start );
+	}
+
+	void						Reset();
+
+	const DeckLinkLatencyHistogram&	Get( DeckLinkLatencyStage stage ) const { return mStages[static_cast<int>( stage )]; }
+
+	/** Percentile table of every stage followed by the non-empty buckets, for dumping to a file. */
+	std::string					Format() const;
+
+private:
+	DeckLinkLatencyHistogram	mStages[static_cast<int>( DeckLinkLatencyStage::Count )];
+};
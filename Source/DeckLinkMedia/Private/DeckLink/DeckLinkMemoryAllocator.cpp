@@ -0,0 +1,184 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkMemoryAllocator.h"
+#include "DeckLinkMediaStats.h"
+
+namespace {
+	// each buffer is preceded by one alignment unit that remembers its size
+	struct BufferHeader {
+		size_t size;
+	};
+
+	static_assert( sizeof( BufferHeader ) <= DeckLinkMemoryAllocator::Alignment, "buffer header must fit in the alignment padding" );
+
+	BufferHeader* HeaderOf( void* buffer )
+	{
+		return reinterpret_cast<BufferHeader*>( static_cast<uint8_t*>( buffer ) - DeckLinkMemoryAllocator::Alignment );
+	}
+}
+
+DeckLinkMemoryAllocator::DeckLinkMemoryAllocator()
+	: mBufferSize{ 0 }
+	, mBufferCount{ 0 }
+	, mBuffersInUse{ 0 }
+	, mAllocatedBytes{ 0 }
+	, mMissCount{ 0 }
+	, mRefCount{ 1 }
+{
+	mFreeBuffers.reserve( MaxFreeBuffers );
+}
+
+DeckLinkMemoryAllocator::~DeckLinkMemoryAllocator()
+{
+	check( mBuffersInUse == 0 );
+	Decommit();
+}
+
+void DeckLinkMemoryAllocator::Reserve( uint32_t count, size_t bufferSize )
+{
+	if( bufferSize == 0 )
+		return;
+
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	if( bufferSize != mBufferSize ) {
+		mBufferSize = bufferSize;
+		TrimFreeBuffers();
+	}
+
+	count = FMath::Min( count, MaxFreeBuffers );
+	while( mFreeBuffers.size() < count ) {
+		mFreeBuffers.push_back( CreateBuffer( bufferSize ) );
+	}
+}
+
+void* DeckLinkMemoryAllocator::CreateBuffer( size_t bufferSize )
+{
+	uint8_t* block = static_cast<uint8_t*>( FMemory::Malloc( bufferSize + Alignment, Alignment ) );
+
+	// touch every page now so the first DMA into it does not fault
+	FMemory::Memzero( block, bufferSize + Alignment );
+
+	void* buffer = block + Alignment;
+	HeaderOf( buffer )->size = bufferSize;
+
+	++mBufferCount;
+	mAllocatedBytes += bufferSize;
+	INC_MEMORY_STAT_BY( STAT_DeckLinkMedia_CaptureBufferMemory, bufferSize );
+	return buffer;
+}
+
+void DeckLinkMemoryAllocator::DestroyBuffer( void* buffer )
+{
+	--mBufferCount;
+	mAllocatedBytes -= HeaderOf( buffer )->size;
+	DEC_MEMORY_STAT_BY( STAT_DeckLinkMedia_CaptureBufferMemory, HeaderOf( buffer )->size );
+	FMemory::Free( HeaderOf( buffer ) );
+}
+
+void DeckLinkMemoryAllocator::TrimFreeBuffers()
+{
+	// drop free buffers that no longer fit the current size
+	size_t kept = 0;
+	for( void* buffer : mFreeBuffers ) {
+		if( HeaderOf( buffer )->size == mBufferSize )
+			mFreeBuffers[kept++] = buffer;
+		else
+			DestroyBuffer( buffer );
+	}
+	mFreeBuffers.resize( kept );
+}
+
+HRESULT DeckLinkMemoryAllocator::AllocateBuffer( unsigned int bufferSize, void** allocatedBuffer )
+{
+	if( allocatedBuffer == NULL )
+		return E_INVALIDARG;
+
+	void* buffer = NULL;
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+
+		if( bufferSize != mBufferSize ) {
+			// the signal changed, buffers of the old size are of no use anymore
+			mBufferSize = bufferSize;
+			TrimFreeBuffers();
+		}
+
+		if( ! mFreeBuffers.empty() ) {
+			buffer = mFreeBuffers.back();
+			mFreeBuffers.pop_back();
+		}
+	}
+
+	if( buffer == NULL ) {
+		++mMissCount;
+		buffer = CreateBuffer( bufferSize );
+	}
+
+	++mBuffersInUse;
+	*allocatedBuffer = buffer;
+	return S_OK;
+}
+
+HRESULT DeckLinkMemoryAllocator::ReleaseBuffer( void* buffer )
+{
+	if( buffer == NULL )
+		return E_INVALIDARG;
+
+	--mBuffersInUse;
+
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		if( HeaderOf( buffer )->size == mBufferSize && mFreeBuffers.size() < MaxFreeBuffers ) {
+			mFreeBuffers.push_back( buffer );
+			return S_OK;
+		}
+	}
+
+	DestroyBuffer( buffer );
+	return S_OK;
+}
+
+HRESULT DeckLinkMemoryAllocator::Commit()
+{
+	// buffers are created up front by Reserve and on demand by AllocateBuffer
+	return S_OK;
+}
+
+HRESULT DeckLinkMemoryAllocator::Decommit()
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	for( void* buffer : mFreeBuffers ) {
+		DestroyBuffer( buffer );
+	}
+	mFreeBuffers.clear();
+	return S_OK;
+}
+
+HRESULT DeckLinkMemoryAllocator::QueryInterface( REFIID iid, LPVOID *ppv )
+{
+	if( ppv == NULL )
+		return E_INVALIDARG;
+
+	*ppv = NULL;
+	if( iid == IID_IUnknown || iid == IID_IDeckLinkMemoryAllocator ) {
+		*ppv = static_cast<IDeckLinkMemoryAllocator*>( this );
+		AddRef();
+		return S_OK;
+	}
+
+	return E_NOINTERFACE;
+}
+
+ULONG DeckLinkMemoryAllocator::AddRef()
+{
+	return ++mRefCount;
+}
+
+ULONG DeckLinkMemoryAllocator::Release()
+{
+	const ULONG refCount = --mRefCount;
+	if( refCount == 0 )
+		delete this;
+
+	return refCount;
+}
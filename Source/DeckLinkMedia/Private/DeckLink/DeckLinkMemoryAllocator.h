@@ -0,0 +1,97 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include "DeckLinkPlatform.h"
+#include "CoreMinimal.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/**
+ * Capture buffer allocator installed on the device input.
+ *
+ * The driver DMAs every captured frame into a buffer it gets from here.
+ * Buffers are 64-byte aligned for the SIMD converters, prefaulted when they
+ * are created, and kept on a free list when the driver hands them back, so
+ * steady state capture never reaches the system allocator.
+ */
+class DeckLinkMemoryAllocator : public IDeckLinkMemoryAllocator {
+public:
+	static const size_t Alignment = 64;
+	static const uint32_t MaxFreeBuffers = 32;
+
+	DeckLinkMemoryAllocator();
+
+	DeckLinkMemoryAllocator( const DeckLinkMemoryAllocator& ) = delete;
+	DeckLinkMemoryAllocator& operator=( const DeckLinkMemoryAllocator& ) = delete;
+
+	/** Makes sure at least count free buffers of bufferSize bytes exist before capture starts. */
+	void						Reserve( uint32_t count, size_t bufferSize );
+
+	uint32_t					GetBufferCount() const { return mBufferCount; }
+	uint32_t					GetBuffersInUse() const { return mBuffersInUse; }
+	size_t						GetAllocatedBytes() const { return mAllocatedBytes; }
+
+	/** Buffers that had to be created while capturing because the free list was empty or the size changed. */
+	uint64_t					GetMissCount() const { return mMissCount; }
+
+	// IDeckLinkMemoryAllocator interface
+	virtual HRESULT STDMETHODCALLTYPE	AllocateBuffer( unsigned int bufferSize, void** allocatedBuffer ) override;
+	virtual HRESULT STDMETHODCALLTYPE	ReleaseBuffer( void* buffer ) override;
+	virtual HRESULT STDMETHODCALLTYPE	Commit() override;
+	virtual HRESULT STDMETHODCALLTYPE	Decommit() override;
+
+	// IUnknown interface
+	virtual HRESULT STDMETHODCALLTYPE	QueryInterface( REFIID iid, LPVOID *ppv ) override;
+	virtual ULONG STDMETHODCALLTYPE		AddRef() override;
+	virtual ULONG STDMETHODCALLTYPE		Release() override;
+
+private:
+	// reference counted, only Release may delete
+	virtual ~DeckLinkMemoryAllocator();
+
+	void*						CreateBuffer( size_t bufferSize );
+	void						DestroyBuffer( void* buffer );
+	void						TrimFreeBuffers();
+
+	std::mutex					mMutex;
+	std::vector<void*>			mFreeBuffers;
+	size_t						mBufferSize;
+
+	std::atomic<uint32_t>		mBufferCount;
+	std::atomic<uint32_t>		mBuffersInUse;
+	std::atomic<size_t>			mAllocatedBytes;
+	std::atomic<uint64_t>		mMissCount;
+	std::atomic<ULONG>			mRefCount;
+};
@@ -0,0 +1,472 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkPixelConversion.h"
+
+#include <algorithm>
+
+#if defined( _M_X64 ) || defined( __x86_64__ )
+	#define DECKLINK_PIXEL_X86 1
+	#include <immintrin.h>
+	#if defined( _MSC_VER )
+		#include <intrin.h>
+		#define DECKLINK_TARGET_SSE41
+		#define DECKLINK_TARGET_AVX2
+	#else
+		#define DECKLINK_TARGET_SSE41 __attribute__(( target( "sse4.1" ) ))
+		#define DECKLINK_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+	#endif
+#else
+	#define DECKLINK_PIXEL_X86 0
+#endif
+
+namespace DeckLinkPixelConversion
+{
+	namespace
+	{
+		// Limited range Y'CbCr to full range R'G'B', coefficients scaled by 64.
+		// The 16-bit SIMD paths saturate only where the final result clamps to
+		// 255 anyway, so they match the 32-bit scalar path exactly.
+		struct YuvMatrix {
+			int16_t y;
+			int16_t rv;
+			int16_t gu;
+			int16_t gv;
+			int16_t bu;
+		};
+
+		const YuvMatrix Rec601Matrix = { 75, 102, 25, 52, 129 };
+		const YuvMatrix Rec709Matrix = { 75, 115, 14, 34, 135 };
+
+		const YuvMatrix& GetMatrix( Colorimetry colorimetry )
+		{
+			return ( colorimetry == Colorimetry::Rec709 ) ? Rec709Matrix : Rec601Matrix;
+		}
+
+		// 10-bit limited range Y'CbCr straight to 16-bit full range R'G'B', coefficients
+		// scaled by 4096. 8 and 10-bit outputs are truncated from the 16-bit result.
+		struct V210Matrix {
+			int32_t y;
+			int32_t rv;
+			int32_t gu;
+			int32_t gv;
+			int32_t bu;
+		};
+
+		const V210Matrix Rec601V210Matrix = { 306428, 420023, 103099, 213947, 530871 };
+		const V210Matrix Rec709V210Matrix = { 306428, 471792, 56120, 140245, 555917 };
+
+		const V210Matrix& GetV210Matrix( Colorimetry colorimetry )
+		{
+			return ( colorimetry == Colorimetry::Rec709 ) ? Rec709V210Matrix : Rec601V210Matrix;
+		}
+
+		inline uint8_t Clamp8( int32_t value )
+		{
+			return static_cast<uint8_t>( value < 0 ? 0 : ( value > 255 ? 255 : value ) );
+		}
+
+		inline void StoreBGRA( uint8_t* dst, const YuvMatrix& m, int32_t y, int32_t u, int32_t v )
+		{
+			const int32_t yy = ( y - 16 ) * m.y + 32;
+			u -= 128;
+			v -= 128;
+			dst[0] = Clamp8( ( yy + m.bu * u ) >> 6 );
+			dst[1] = Clamp8( ( yy - m.gu * u - m.gv * v ) >> 6 );
+			dst[2] = Clamp8( ( yy + m.rv * v ) >> 6 );
+			dst[3] = 0xff;
+		}
+
+		void UYVYRowScalar( const uint8_t* src, uint8_t* dst, long begin, long width, const YuvMatrix& m )
+		{
+			for( long x = begin; x + 1 < width; x += 2 ) {
+				const uint8_t* p = src + x * 2;
+				StoreBGRA( dst + x * 4, m, p[1], p[0], p[2] );
+				StoreBGRA( dst + x * 4 + 4, m, p[3], p[0], p[2] );
+			}
+		}
+
+		inline int32_t Clamp16( int32_t value )
+		{
+			return value < 0 ? 0 : ( value > 65535 ? 65535 : value );
+		}
+
+		inline void StoreV210Pixel( uint8_t* dst, OutputFormat format, const V210Matrix& m, int32_t y, int32_t cb, int32_t cr )
+		{
+			const int32_t yy = ( y - 64 ) * m.y + 2048;
+			cb -= 512;
+			cr -= 512;
+			const int32_t r = Clamp16( ( yy + m.rv * cr ) >> 12 );
+			const int32_t g = Clamp16( ( yy - m.gu * cb - m.gv * cr ) >> 12 );
+			const int32_t b = Clamp16( ( yy + m.bu * cb ) >> 12 );
+
+			switch( format ) {
+			case OutputFormat::BGRA8:
+				dst[0] = static_cast<uint8_t>( b >> 8 );
+				dst[1] = static_cast<uint8_t>( g >> 8 );
+				dst[2] = static_cast<uint8_t>( r >> 8 );
+				dst[3] = 0xff;
+				break;
+
+			case OutputFormat::A2B10G10R10:
+				*(uint32_t*)dst = static_cast<uint32_t>( r >> 6 ) | ( static_cast<uint32_t>( g >> 6 ) << 10 ) | ( static_cast<uint32_t>( b >> 6 ) << 20 ) | 0xc0000000u;
+				break;
+
+			case OutputFormat::RGBA16:
+				( (uint16_t*)dst )[0] = static_cast<uint16_t>( r );
+				( (uint16_t*)dst )[1] = static_cast<uint16_t>( g );
+				( (uint16_t*)dst )[2] = static_cast<uint16_t>( b );
+				( (uint16_t*)dst )[3] = 0xffff;
+				break;
+			}
+		}
+
+		void V210RowScalar( const uint8_t* src, uint8_t* dst, long begin, long width, OutputFormat format, const V210Matrix& m )
+		{
+			const long bpp = GetBytesPerPixel( format );
+
+			// begin is always a multiple of six, i.e. the start of a 16-byte block
+			for( long x = begin; x < width; x += 6 ) {
+				const uint32_t* w = (const uint32_t*)( src + ( x / 6 ) * 16 );
+				const int32_t cb0 = w[0] & 0x3ff, y0 = ( w[0] >> 10 ) & 0x3ff, cr0 = ( w[0] >> 20 ) & 0x3ff;
+				const int32_t y1 = w[1] & 0x3ff, cb2 = ( w[1] >> 10 ) & 0x3ff, y2 = ( w[1] >> 20 ) & 0x3ff;
+				const int32_t cr2 = w[2] & 0x3ff, y3 = ( w[2] >> 10 ) & 0x3ff, cb4 = ( w[2] >> 20 ) & 0x3ff;
+				const int32_t y4 = w[3] & 0x3ff, cr4 = ( w[3] >> 10 ) & 0x3ff, y5 = ( w[3] >> 20 ) & 0x3ff;
+
+				const int32_t ys[6] = { y0, y1, y2, y3, y4, y5 };
+				const int32_t cbs[3] = { cb0, cb2, cb4 };
+				const int32_t crs[3] = { cr0, cr2, cr4 };
+
+				const long count = std::min<long>( 6, width - x );
+				for( long i = 0; i < count; ++i ) {
+					StoreV210Pixel( dst + ( x + i ) * bpp, format, m, ys[i], cbs[i / 2], crs[i / 2] );
+				}
+			}
+		}
+
+#if DECKLINK_PIXEL_X86
+
+		// Converts 8 UYVY pixels in the low and high halves of src into 16-bit R, G and B.
+		DECKLINK_TARGET_SSE41 inline void UYVYToRGB16SSE( __m128i src, const YuvMatrix& m, __m128i& r, __m128i& g, __m128i& b )
+		{
+			const __m128i shuffleU = _mm_setr_epi8( 0, -1, 0, -1, 4, -1, 4, -1, 8, -1, 8, -1, 12, -1, 12, -1 );
+			const __m128i shuffleV = _mm_setr_epi8( 2, -1, 2, -1, 6, -1, 6, -1, 10, -1, 10, -1, 14, -1, 14, -1 );
+
+			const __m128i y = _mm_sub_epi16( _mm_srli_epi16( src, 8 ), _mm_set1_epi16( 16 ) );
+			const __m128i u = _mm_sub_epi16( _mm_shuffle_epi8( src, shuffleU ), _mm_set1_epi16( 128 ) );
+			const __m128i v = _mm_sub_epi16( _mm_shuffle_epi8( src, shuffleV ), _mm_set1_epi16( 128 ) );
+
+			const __m128i yy = _mm_add_epi16( _mm_mullo_epi16( y, _mm_set1_epi16( m.y ) ), _mm_set1_epi16( 32 ) );
+			r = _mm_srai_epi16( _mm_adds_epi16( yy, _mm_mullo_epi16( v, _mm_set1_epi16( m.rv ) ) ), 6 );
+			g = _mm_srai_epi16( _mm_subs_epi16( _mm_subs_epi16( yy, _mm_mullo_epi16( u, _mm_set1_epi16( m.gu ) ) ), _mm_mullo_epi16( v, _mm_set1_epi16( m.gv ) ) ), 6 );
+			b = _mm_srai_epi16( _mm_adds_epi16( yy, _mm_mullo_epi16( u, _mm_set1_epi16( m.bu ) ) ), 6 );
+		}
+
+		DECKLINK_TARGET_SSE41 long UYVYRowSSE41( const uint8_t* src, uint8_t* dst, long width, const YuvMatrix& m )
+		{
+			const __m128i alpha = _mm_set1_epi8( -1 );
+			long x = 0;
+			for( ; x + 16 <= width; x += 16 ) {
+				__m128i r0, g0, b0, r1, g1, b1;
+				UYVYToRGB16SSE( _mm_loadu_si128( (const __m128i*)( src + x * 2 ) ), m, r0, g0, b0 );
+				UYVYToRGB16SSE( _mm_loadu_si128( (const __m128i*)( src + x * 2 + 16 ) ), m, r1, g1, b1 );
+
+				const __m128i r = _mm_packus_epi16( r0, r1 );
+				const __m128i g = _mm_packus_epi16( g0, g1 );
+				const __m128i b = _mm_packus_epi16( b0, b1 );
+
+				const __m128i bgLo = _mm_unpacklo_epi8( b, g );
+				const __m128i bgHi = _mm_unpackhi_epi8( b, g );
+				const __m128i raLo = _mm_unpacklo_epi8( r, alpha );
+				const __m128i raHi = _mm_unpackhi_epi8( r, alpha );
+
+				__m128i* out = (__m128i*)( dst + x * 4 );
+				_mm_storeu_si128( out + 0, _mm_unpacklo_epi16( bgLo, raLo ) );
+				_mm_storeu_si128( out + 1, _mm_unpackhi_epi16( bgLo, raLo ) );
+				_mm_storeu_si128( out + 2, _mm_unpacklo_epi16( bgHi, raHi ) );
+				_mm_storeu_si128( out + 3, _mm_unpackhi_epi16( bgHi, raHi ) );
+			}
+			return x;
+		}
+
+		DECKLINK_TARGET_AVX2 inline void UYVYToRGB16AVX( __m256i src, const YuvMatrix& m, __m256i& r, __m256i& g, __m256i& b )
+		{
+			const __m256i shuffleU = _mm256_setr_epi8(
+				0, -1, 0, -1, 4, -1, 4, -1, 8, -1, 8, -1, 12, -1, 12, -1,
+				0, -1, 0, -1, 4, -1, 4, -1, 8, -1, 8, -1, 12, -1, 12, -1 );
+			const __m256i shuffleV = _mm256_setr_epi8(
+				2, -1, 2, -1, 6, -1, 6, -1, 10, -1, 10, -1, 14, -1, 14, -1,
+				2, -1, 2, -1, 6, -1, 6, -1, 10, -1, 10, -1, 14, -1, 14, -1 );
+
+			const __m256i y = _mm256_sub_epi16( _mm256_srli_epi16( src, 8 ), _mm256_set1_epi16( 16 ) );
+			const __m256i u = _mm256_sub_epi16( _mm256_shuffle_epi8( src, shuffleU ), _mm256_set1_epi16( 128 ) );
+			const __m256i v = _mm256_sub_epi16( _mm256_shuffle_epi8( src, shuffleV ), _mm256_set1_epi16( 128 ) );
+
+			const __m256i yy = _mm256_add_epi16( _mm256_mullo_epi16( y, _mm256_set1_epi16( m.y ) ), _mm256_set1_epi16( 32 ) );
+			r = _mm256_srai_epi16( _mm256_adds_epi16( yy, _mm256_mullo_epi16( v, _mm256_set1_epi16( m.rv ) ) ), 6 );
+			g = _mm256_srai_epi16( _mm256_subs_epi16( _mm256_subs_epi16( yy, _mm256_mullo_epi16( u, _mm256_set1_epi16( m.gu ) ) ), _mm256_mullo_epi16( v, _mm256_set1_epi16( m.gv ) ) ), 6 );
+			b = _mm256_srai_epi16( _mm256_adds_epi16( yy, _mm256_mullo_epi16( u, _mm256_set1_epi16( m.bu ) ) ), 6 );
+		}
+
+		DECKLINK_TARGET_AVX2 long UYVYRowAVX2( const uint8_t* src, uint8_t* dst, long width, const YuvMatrix& m )
+		{
+			const __m256i alpha = _mm256_set1_epi8( -1 );
+			long x = 0;
+			for( ; x + 32 <= width; x += 32 ) {
+				__m256i r0, g0, b0, r1, g1, b1;
+				UYVYToRGB16AVX( _mm256_loadu_si256( (const __m256i*)( src + x * 2 ) ), m, r0, g0, b0 );
+				UYVYToRGB16AVX( _mm256_loadu_si256( (const __m256i*)( src + x * 2 + 32 ) ), m, r1, g1, b1 );
+
+				// packus and unpack work per 128-bit lane, so the lanes hold pixels
+				// 0-7 | 8-15 (lo) and 16-23 | 24-31 (hi) until the final permute
+				const __m256i r = _mm256_packus_epi16( r0, r1 );
+				const __m256i g = _mm256_packus_epi16( g0, g1 );
+				const __m256i b = _mm256_packus_epi16( b0, b1 );
+
+				const __m256i bgLo = _mm256_unpacklo_epi8( b, g );
+				const __m256i bgHi = _mm256_unpackhi_epi8( b, g );
+				const __m256i raLo = _mm256_unpacklo_epi8( r, alpha );
+				const __m256i raHi = _mm256_unpackhi_epi8( r, alpha );
+
+				const __m256i p0 = _mm256_unpacklo_epi16( bgLo, raLo );
+				const __m256i p1 = _mm256_unpackhi_epi16( bgLo, raLo );
+				const __m256i p2 = _mm256_unpacklo_epi16( bgHi, raHi );
+				const __m256i p3 = _mm256_unpackhi_epi16( bgHi, raHi );
+
+				__m256i* out = (__m256i*)( dst + x * 4 );
+				_mm256_storeu_si256( out + 0, _mm256_permute2x128_si256( p0, p1, 0x20 ) );
+				_mm256_storeu_si256( out + 1, _mm256_permute2x128_si256( p0, p1, 0x31 ) );
+				_mm256_storeu_si256( out + 2, _mm256_permute2x128_si256( p2, p3, 0x20 ) );
+				_mm256_storeu_si256( out + 3, _mm256_permute2x128_si256( p2, p3, 0x31 ) );
+			}
+			return x;
+		}
+
+		// Two v210 blocks hold 12 pixels. Per block the three 10-bit fields of the
+		// four words are a = bits 0-9, b = 10-19 and c = 20-29:
+		//   a = Cb0 Y1 Cr2 Y4    b = Y0 Cb2 Y3 Cr4    c = Cr0 Y2 Cb4 Y5
+		// These helpers regroup the fields of blocks A and B into three sets of
+		// four pixels. Everything works per 128-bit lane, so the AVX2 variant
+		// runs the same shuffles on two block pairs at once.
+#define DECKLINK_V210_REGROUP( SUFFIX, TYPE, SHUFFLE, BLEND ) \
+		DECKLINK_TARGET_##SUFFIX inline void V210Regroup##SUFFIX( TYPE a0, TYPE b0, TYPE c0, TYPE a1, TYPE b1, TYPE c1, TYPE y[3], TYPE cb[3], TYPE cr[3] ) \
+		{ \
+			/* pixels 0-3: Y = b0[0] a0[1] c0[1] b0[2], Cb = a0[0] a0[0] b0[1] b0[1], Cr = c0[0] c0[0] a0[2] a0[2] */ \
+			y[0] = BLEND( BLEND( SHUFFLE( b0, _MM_SHUFFLE( 2, 0, 0, 0 ) ), a0, 0x0c ), SHUFFLE( c0, _MM_SHUFFLE( 0, 1, 0, 0 ) ), 0x30 ); \
+			cb[0] = BLEND( SHUFFLE( a0, _MM_SHUFFLE( 0, 0, 0, 0 ) ), SHUFFLE( b0, _MM_SHUFFLE( 1, 1, 0, 0 ) ), 0xf0 ); \
+			cr[0] = BLEND( SHUFFLE( c0, _MM_SHUFFLE( 0, 0, 0, 0 ) ), SHUFFLE( a0, _MM_SHUFFLE( 2, 2, 0, 0 ) ), 0xf0 ); \
+			/* pixels 4-7: Y = a0[3] c0[3] b1[0] a1[1], Cb = c0[2] c0[2] a1[0] a1[0], Cr = b0[3] b0[3] c1[0] c1[0] */ \
+			y[1] = BLEND( BLEND( BLEND( SHUFFLE( a0, _MM_SHUFFLE( 0, 0, 0, 3 ) ), SHUFFLE( c0, _MM_SHUFFLE( 0, 0, 3, 0 ) ), 0x0c ), SHUFFLE( b1, _MM_SHUFFLE( 0, 0, 0, 0 ) ), 0x30 ), SHUFFLE( a1, _MM_SHUFFLE( 1, 0, 0, 0 ) ), 0xc0 ); \
+			cb[1] = BLEND( SHUFFLE( c0, _MM_SHUFFLE( 2, 2, 2, 2 ) ), SHUFFLE( a1, _MM_SHUFFLE( 0, 0, 0, 0 ) ), 0xf0 ); \
+			cr[1] = BLEND( SHUFFLE( b0, _MM_SHUFFLE( 3, 3, 3, 3 ) ), SHUFFLE( c1, _MM_SHUFFLE( 0, 0, 0, 0 ) ), 0xf0 ); \
+			/* pixels 8-11: Y = c1[1] b1[2] a1[3] c1[3], Cb = b1[1] b1[1] c1[2] c1[2], Cr = a1[2] a1[2] b1[3] b1[3] */ \
+			y[2] = BLEND( BLEND( SHUFFLE( c1, _MM_SHUFFLE( 3, 0, 0, 1 ) ), SHUFFLE( b1, _MM_SHUFFLE( 0, 0, 2, 0 ) ), 0x0c ), SHUFFLE( a1, _MM_SHUFFLE( 0, 3, 0, 0 ) ), 0x30 ); \
+			cb[2] = BLEND( SHUFFLE( b1, _MM_SHUFFLE( 1, 1, 1, 1 ) ), SHUFFLE( c1, _MM_SHUFFLE( 2, 2, 2, 2 ) ), 0xf0 ); \
+			cr[2] = BLEND( SHUFFLE( a1, _MM_SHUFFLE( 2, 2, 2, 2 ) ), SHUFFLE( b1, _MM_SHUFFLE( 3, 3, 3, 3 ) ), 0xf0 ); \
+		}
+
+		DECKLINK_V210_REGROUP( SSE41, __m128i, _mm_shuffle_epi32, _mm_blend_epi16 )
+		DECKLINK_V210_REGROUP( AVX2, __m256i, _mm256_shuffle_epi32, _mm256_blend_epi16 )
+
+#undef DECKLINK_V210_REGROUP
+
+		DECKLINK_TARGET_SSE41 inline void V210StoreSSE( uint8_t* dst, OutputFormat format, __m128i r, __m128i g, __m128i b )
+		{
+			switch( format ) {
+			case OutputFormat::BGRA8:
+				_mm_storeu_si128( (__m128i*)dst, _mm_or_si128(
+					_mm_or_si128( _mm_srli_epi32( b, 8 ), _mm_slli_epi32( _mm_srli_epi32( g, 8 ), 8 ) ),
+					_mm_or_si128( _mm_slli_epi32( _mm_srli_epi32( r, 8 ), 16 ), _mm_set1_epi32( (int)0xff000000 ) ) ) );
+				break;
+
+			case OutputFormat::A2B10G10R10:
+				_mm_storeu_si128( (__m128i*)dst, _mm_or_si128(
+					_mm_or_si128( _mm_srli_epi32( r, 6 ), _mm_slli_epi32( _mm_srli_epi32( g, 6 ), 10 ) ),
+					_mm_or_si128( _mm_slli_epi32( _mm_srli_epi32( b, 6 ), 20 ), _mm_set1_epi32( (int)0xc0000000 ) ) ) );
+				break;
+
+			case OutputFormat::RGBA16:
+			{
+				const __m128i rg = _mm_or_si128( r, _mm_slli_epi32( g, 16 ) );
+				const __m128i ba = _mm_or_si128( b, _mm_set1_epi32( (int)0xffff0000 ) );
+				_mm_storeu_si128( (__m128i*)dst, _mm_unpacklo_epi32( rg, ba ) );
+				_mm_storeu_si128( (__m128i*)dst + 1, _mm_unpackhi_epi32( rg, ba ) );
+				break;
+			}
+			}
+		}
+
+		DECKLINK_TARGET_SSE41 long V210RowSSE41( const uint8_t* src, uint8_t* dst, long width, OutputFormat format, const V210Matrix& m )
+		{
+			const __m128i mask = _mm_set1_epi32( 0x3ff );
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i max16 = _mm_set1_epi32( 65535 );
+			const long bpp = GetBytesPerPixel( format );
+
+			long x = 0;
+			for( ; x + 12 <= width; x += 12 ) {
+				const __m128i w0 = _mm_loadu_si128( (const __m128i*)( src + ( x / 6 ) * 16 ) );
+				const __m128i w1 = _mm_loadu_si128( (const __m128i*)( src + ( x / 6 ) * 16 + 16 ) );
+
+				__m128i y[3], cb[3], cr[3];
+				V210RegroupSSE41(
+					_mm_and_si128( w0, mask ), _mm_and_si128( _mm_srli_epi32( w0, 10 ), mask ), _mm_and_si128( _mm_srli_epi32( w0, 20 ), mask ),
+					_mm_and_si128( w1, mask ), _mm_and_si128( _mm_srli_epi32( w1, 10 ), mask ), _mm_and_si128( _mm_srli_epi32( w1, 20 ), mask ),
+					y, cb, cr );
+
+				for( int group = 0; group < 3; ++group ) {
+					const __m128i yy = _mm_add_epi32( _mm_mullo_epi32( _mm_sub_epi32( y[group], _mm_set1_epi32( 64 ) ), _mm_set1_epi32( m.y ) ), _mm_set1_epi32( 2048 ) );
+					const __m128i u = _mm_sub_epi32( cb[group], _mm_set1_epi32( 512 ) );
+					const __m128i v = _mm_sub_epi32( cr[group], _mm_set1_epi32( 512 ) );
+
+					const __m128i r = _mm_add_epi32( yy, _mm_mullo_epi32( v, _mm_set1_epi32( m.rv ) ) );
+					const __m128i g = _mm_sub_epi32( _mm_sub_epi32( yy, _mm_mullo_epi32( u, _mm_set1_epi32( m.gu ) ) ), _mm_mullo_epi32( v, _mm_set1_epi32( m.gv ) ) );
+					const __m128i b = _mm_add_epi32( yy, _mm_mullo_epi32( u, _mm_set1_epi32( m.bu ) ) );
+
+					V210StoreSSE( dst + ( x + group * 4 ) * bpp, format,
+						_mm_min_epi32( _mm_max_epi32( _mm_srai_epi32( r, 12 ), zero ), max16 ),
+						_mm_min_epi32( _mm_max_epi32( _mm_srai_epi32( g, 12 ), zero ), max16 ),
+						_mm_min_epi32( _mm_max_epi32( _mm_srai_epi32( b, 12 ), zero ), max16 ) );
+				}
+			}
+			return x;
+		}
+
+		DECKLINK_TARGET_AVX2 long V210RowAVX2( const uint8_t* src, uint8_t* dst, long width, OutputFormat format, const V210Matrix& m )
+		{
+			const __m256i mask = _mm256_set1_epi32( 0x3ff );
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i max16 = _mm256_set1_epi32( 65535 );
+			const long bpp = GetBytesPerPixel( format );
+
+			long x = 0;
+			for( ; x + 24 <= width; x += 24 ) {
+				// lane 0 holds blocks 0/1 (pixels 0-11), lane 1 blocks 2/3 (pixels 12-23)
+				const uint8_t* blocks = src + ( x / 6 ) * 16;
+				const __m256i w0 = _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_loadu_si128( (const __m128i*)blocks ) ), _mm_loadu_si128( (const __m128i*)( blocks + 32 ) ), 1 );
+				const __m256i w1 = _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_loadu_si128( (const __m128i*)( blocks + 16 ) ) ), _mm_loadu_si128( (const __m128i*)( blocks + 48 ) ), 1 );
+
+				__m256i y[3], cb[3], cr[3];
+				V210RegroupAVX2(
+					_mm256_and_si256( w0, mask ), _mm256_and_si256( _mm256_srli_epi32( w0, 10 ), mask ), _mm256_and_si256( _mm256_srli_epi32( w0, 20 ), mask ),
+					_mm256_and_si256( w1, mask ), _mm256_and_si256( _mm256_srli_epi32( w1, 10 ), mask ), _mm256_and_si256( _mm256_srli_epi32( w1, 20 ), mask ),
+					y, cb, cr );
+
+				for( int group = 0; group < 3; ++group ) {
+					const __m256i yy = _mm256_add_epi32( _mm256_mullo_epi32( _mm256_sub_epi32( y[group], _mm256_set1_epi32( 64 ) ), _mm256_set1_epi32( m.y ) ), _mm256_set1_epi32( 2048 ) );
+					const __m256i u = _mm256_sub_epi32( cb[group], _mm256_set1_epi32( 512 ) );
+					const __m256i v = _mm256_sub_epi32( cr[group], _mm256_set1_epi32( 512 ) );
+
+					const __m256i r = _mm256_min_epi32( _mm256_max_epi32( _mm256_srai_epi32( _mm256_add_epi32( yy, _mm256_mullo_epi32( v, _mm256_set1_epi32( m.rv ) ) ), 12 ), zero ), max16 );
+					const __m256i g = _mm256_min_epi32( _mm256_max_epi32( _mm256_srai_epi32( _mm256_sub_epi32( _mm256_sub_epi32( yy, _mm256_mullo_epi32( u, _mm256_set1_epi32( m.gu ) ) ), _mm256_mullo_epi32( v, _mm256_set1_epi32( m.gv ) ) ), 12 ), zero ), max16 );
+					const __m256i b = _mm256_min_epi32( _mm256_max_epi32( _mm256_srai_epi32( _mm256_add_epi32( yy, _mm256_mullo_epi32( u, _mm256_set1_epi32( m.bu ) ) ), 12 ), zero ), max16 );
+
+					V210StoreSSE( dst + ( x + group * 4 ) * bpp, format, _mm256_castsi256_si128( r ), _mm256_castsi256_si128( g ), _mm256_castsi256_si128( b ) );
+					V210StoreSSE( dst + ( x + 12 + group * 4 ) * bpp, format, _mm256_extracti128_si256( r, 1 ), _mm256_extracti128_si256( g, 1 ), _mm256_extracti128_si256( b, 1 ) );
+				}
+			}
+			return x;
+		}
+
+		void QueryCpuId( int leaf, int subleaf, int regs[4] )
+		{
+#if defined( _MSC_VER )
+			__cpuidex( regs, leaf, subleaf );
+#else
+			__asm__ __volatile__ ( "cpuid" : "=a"( regs[0] ), "=b"( regs[1] ), "=c"( regs[2] ), "=d"( regs[3] ) : "a"( leaf ), "c"( subleaf ) );
+#endif
+		}
+
+		uint64_t QueryXCR0()
+		{
+#if defined( _MSC_VER )
+			return _xgetbv( 0 );
+#else
+			uint32_t eax, edx;
+			__asm__ __volatile__ ( "xgetbv" : "=a"( eax ), "=d"( edx ) : "c"( 0 ) );
+			return ( static_cast<uint64_t>( edx ) << 32 ) | eax;
+#endif
+		}
+
+#endif // DECKLINK_PIXEL_X86
+	}
+
+	InstructionSet DetectInstructionSet()
+	{
+#if DECKLINK_PIXEL_X86
+		static const InstructionSet detected = []() {
+			int regs[4];
+			QueryCpuId( 0, 0, regs );
+			const int maxLeaf = regs[0];
+
+			QueryCpuId( 1, 0, regs );
+			const bool sse41 = ( regs[2] & ( 1 << 19 ) ) != 0;
+			const bool osxsave = ( regs[2] & ( 1 << 27 ) ) != 0;
+			const bool avx = ( regs[2] & ( 1 << 28 ) ) != 0;
+
+			bool avx2 = false;
+			if( maxLeaf >= 7 && osxsave && avx && ( QueryXCR0() & 0x6 ) == 0x6 ) {
+				QueryCpuId( 7, 0, regs );
+				avx2 = ( regs[1] & ( 1 << 5 ) ) != 0;
+			}
+
+			return avx2 ? InstructionSet::AVX2 : ( sse41 ? InstructionSet::SSE41 : InstructionSet::Scalar );
+		}();
+		return detected;
+#else
+		return InstructionSet::Scalar;
+#endif
+	}
+
+	InstructionSet ResolveInstructionSet( InstructionSet requested )
+	{
+		return std::min( requested, DetectInstructionSet() );
+	}
+
+	const char* GetInstructionSetName( InstructionSet isa )
+	{
+		switch( isa ) {
+		case InstructionSet::AVX2:		return "AVX2";
+		case InstructionSet::SSE41:		return "SSE4.1";
+		default:						return "Scalar";
+		}
+	}
+
+	void ConvertUYVYToBGRA( const uint8_t* src, long srcRowBytes, uint8_t* dst, long dstRowBytes, long width, long rowBegin, long rowEnd, Colorimetry colorimetry, InstructionSet isa )
+	{
+		const YuvMatrix& m = GetMatrix( colorimetry );
+
+		for( long row = rowBegin; row < rowEnd; ++row ) {
+			const uint8_t* srcRow = src + row * srcRowBytes;
+			uint8_t* dstRow = dst + row * dstRowBytes;
+			long x = 0;
+
+#if DECKLINK_PIXEL_X86
+			if( isa == InstructionSet::AVX2 )
+				x = UYVYRowAVX2( srcRow, dstRow, width, m );
+			else if( isa == InstructionSet::SSE41 )
+				x = UYVYRowSSE41( srcRow, dstRow, width, m );
+#endif
+
+			UYVYRowScalar( srcRow, dstRow, x, width, m );
+		}
+	}
+
+	void ConvertV210( const uint8_t* src, long srcRowBytes, uint8_t* dst, long dstRowBytes, long width, long rowBegin, long rowEnd, OutputFormat format, Colorimetry colorimetry, InstructionSet isa )
+	{
+		const V210Matrix& m = GetV210Matrix( colorimetry );
+
+		for( long row = rowBegin; row < rowEnd; ++row ) {
+			const uint8_t* srcRow = src + row * srcRowBytes;
+			uint8_t* dstRow = dst + row * dstRowBytes;
+			long x = 0;
+
+#if DECKLINK_PIXEL_X86
+			if( isa == InstructionSet::AVX2 )
+				x = V210RowAVX2( srcRow, dstRow, width, format, m );
+			else if( isa == InstructionSet::SSE41 )
+				x = V210RowSSE41( srcRow, dstRow, width, format, m );
+#endif
+
+			V210RowScalar( srcRow, dstRow, x, width, format, m );
+		}
+	}
+}
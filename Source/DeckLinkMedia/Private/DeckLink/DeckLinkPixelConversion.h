@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Pixel format conversion kernels used by the native frame converter.
+ *
+ * Every kernel converts the rows [rowBegin, rowEnd) of a frame so that a frame
+ * can be split across threads. All instruction set variants produce bit
+ * identical results; the scalar path is the reference.
+ */
+namespace DeckLinkPixelConversion
+{
+	enum class InstructionSet {
+		Scalar,
+		SSE41,
+		AVX2,
+	};
+
+	enum class Colorimetry {
+		Rec601,
+		Rec709,
+	};
+
+	/** Layouts the converters can write into a pool frame. */
+	enum class OutputFormat {
+		/** 8 bits per channel, B G R A byte order. */
+		BGRA8,
+
+		/** 32-bit little endian words, R in bits 0-9, G 10-19, B 20-29, A 30-31. */
+		A2B10G10R10,
+
+		/** 16 bits per channel, R G B A order. */
+		RGBA16,
+	};
+
+	inline long					GetBytesPerPixel( OutputFormat format ) { return ( format == OutputFormat::RGBA16 ) ? 8 : 4; }
+
+	/** Row pitch of a v210 (bmdFormat10BitYUV) frame: groups of 48 pixels in 128 bytes. */
+	inline long					GetV210RowBytes( long width ) { return ( ( width + 47 ) / 48 ) * 128; }
+
+	/** Returns the widest instruction set supported by the CPU and OS. */
+	InstructionSet				DetectInstructionSet();
+
+	/** Clamps the requested instruction set to what the CPU supports. */
+	InstructionSet				ResolveInstructionSet( InstructionSet requested );
+
+	const char*					GetInstructionSetName( InstructionSet isa );
+
+	/** Picks the matrix that belongs to a frame height (SD is Rec.601, HD and up Rec.709). */
+	inline Colorimetry			GetColorimetryForHeight( long height ) { return ( height >= 720 ) ? Colorimetry::Rec709 : Colorimetry::Rec601; }
+
+	/** 8-bit 4:2:2 UYVY (bmdFormat8BitYUV), limited range, to 8-bit full range BGRA. */
+	void						ConvertUYVYToBGRA( const uint8_t* src, long srcRowBytes, uint8_t* dst, long dstRowBytes, long width, long rowBegin, long rowEnd, Colorimetry colorimetry, InstructionSet isa );
+
+	/** 10-bit 4:2:2 v210 (bmdFormat10BitYUV), limited range, to any full range OutputFormat. */
+	void						ConvertV210( const uint8_t* src, long srcRowBytes, uint8_t* dst, long dstRowBytes, long width, long rowBegin, long rowEnd, OutputFormat format, Colorimetry colorimetry, InstructionSet isa );
+}
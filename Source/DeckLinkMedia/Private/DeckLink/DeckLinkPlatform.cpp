@@ -0,0 +1,73 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkPlatform.h"
+
+#include <cstdlib>
+
+#if PLATFORM_WINDOWS
+
+#include "Runtime/Core/Public/Windows/AllowWindowsPlatformTypes.h"
+
+IDeckLinkDiscovery* DeckLinkPlatform::CreateDiscovery()
+{
+	IDeckLinkDiscovery* discovery = NULL;
+	if( CoCreateInstance( CLSID_CDeckLinkDiscovery, NULL, CLSCTX_ALL, IID_IDeckLinkDiscovery, (void**)&discovery ) != S_OK )
+		return NULL;
+	return discovery;
+}
+
+IDeckLinkVideoConversion* DeckLinkPlatform::CreateVideoConversion()
+{
+	IDeckLinkVideoConversion* converter = NULL;
+	if( CoCreateInstance( CLSID_CDeckLinkVideoConversion, NULL, CLSCTX_ALL, IID_IDeckLinkVideoConversion, (void**)&converter ) != S_OK )
+		return NULL;
+	return converter;
+}
+
+std::string DeckLinkPlatform::TakeString( DeckLinkString string )
+{
+	if( string == NULL )
+		return "";
+
+	const std::string text = TCHAR_TO_UTF8( string );
+	SysFreeString( string );
+	return text;
+}
+
+DeckLinkString DeckLinkPlatform::MakeString( const std::string& text )
+{
+	return SysAllocString( UTF8_TO_TCHAR( text.c_str() ) );
+}
+
+#include "Runtime/Core/Public/Windows/HideWindowsPlatformTypes.h"
+
+#else
+
+// the SDK's loader, it opens libDeckLinkAPI.so from the driver on first use
+#include "DeckLinkAPIDispatch.cpp"
+
+IDeckLinkDiscovery* DeckLinkPlatform::CreateDiscovery()
+{
+	return CreateDeckLinkDiscoveryInstance();
+}
+
+IDeckLinkVideoConversion* DeckLinkPlatform::CreateVideoConversion()
+{
+	return CreateVideoConversionInstance();
+}
+
+std::string DeckLinkPlatform::TakeString( DeckLinkString string )
+{
+	if( string == NULL )
+		return "";
+
+	const std::string text = string;
+	free( const_cast<char*>( string ) );
+	return text;
+}
+
+DeckLinkString DeckLinkPlatform::MakeString( const std::string& text )
+{
+	return strdup( text.c_str() );
+}
+
+#endif
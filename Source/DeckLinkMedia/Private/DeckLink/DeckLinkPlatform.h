@@ -0,0 +1,80 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#pragma once
+
+#include "HAL/Platform.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if PLATFORM_WINDOWS
+	#include "DeckLinkAPI_h.h"
+#else
+	// from the DeckLink SDK for Linux, see DeckLinkMedia.Build.cs
+	#include "DeckLinkAPI.h"
+#endif
+
+/*
+ * The SDK interfaces are the same on every platform, except that the Windows
+ * headers are generated from IDL and take BSTR, BOOL and LONGLONG where the
+ * Linux ones take const char*, bool and int64_t. Code that implements or
+ * calls those methods uses these names, and gets SDK objects and strings
+ * through DeckLinkPlatform.
+ */
+#if PLATFORM_WINDOWS
+typedef BSTR				DeckLinkString;
+typedef BOOL				DeckLinkBool;
+typedef LONGLONG			DeckLinkInt64;
+#else
+typedef const char*			DeckLinkString;
+typedef bool				DeckLinkBool;
+typedef int64_t				DeckLinkInt64;
+
+/** The Linux REFIID is a plain struct, GUIDs on Windows compare with ==. */
+inline bool operator==( const REFIID& a, const REFIID& b ) { return memcmp( &a, &b, sizeof( REFIID ) ) == 0; }
+#endif
+
+namespace DeckLinkPlatform {
+	/** Creates the driver's device discovery, NULL if the driver is not installed. The caller releases it. */
+	IDeckLinkDiscovery*			CreateDiscovery();
+
+	/** Creates the SDK's frame converter, NULL if the driver is not installed. The caller releases it. */
+	IDeckLinkVideoConversion*	CreateVideoConversion();
+
+	/** Converts a string an SDK method returned to UTF-8 and frees it. */
+	std::string					TakeString( DeckLinkString string );
+
+	/** Allocates a string for an SDK method to return, which its caller frees. */
+	DeckLinkString				MakeString( const std::string& text );
+}
@@ -0,0 +1,101 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+/**
+ * Bounded single-producer single-consumer ring buffer.
+ *
+ * Push and Pop never block or allocate. Capacity is rounded up to a power of
+ * two and fixed at construction.
+ */
+template<typename ElementType>
+class DeckLinkSpscQueue {
+public:
+	explicit DeckLinkSpscQueue( uint32_t capacity )
+		: mCapacity{ RoundUpToPowerOfTwo( capacity ) }
+		, mMask{ mCapacity - 1 }
+		, mElements{ new ElementType[mCapacity] }
+		, mHead{ 0 }
+		, mTail{ 0 }
+	{ }
+
+	DeckLinkSpscQueue( const DeckLinkSpscQueue& ) = delete;
+	DeckLinkSpscQueue& operator=( const DeckLinkSpscQueue& ) = delete;
+
+	/** Producer side. Returns false if the queue is full. */
+	bool Push( const ElementType& element )
+	{
+		const uint32_t tail = mTail.load( std::memory_order_relaxed );
+		if( tail - mHead.load( std::memory_order_acquire ) >= mCapacity )
+			return false;
+
+		mElements[tail & mMask] = element;
+		mTail.store( tail + 1, std::memory_order_release );
+		return true;
+	}
+
+	/** Consumer side. Returns false if the queue is empty. */
+	bool Pop( ElementType& element )
+	{
+		const uint32_t head = mHead.load( std::memory_order_relaxed );
+		if( head == mTail.load( std::memory_order_acquire ) )
+			return false;
+
+		element = mElements[head & mMask];
+		mHead.store( head + 1, std::memory_order_release );
+		return true;
+	}
+
+	uint32_t Num() const { return mTail.load( std::memory_order_acquire ) - mHead.load( std::memory_order_acquire ); }
+	uint32_t Capacity() const { return mCapacity; }
+	bool IsEmpty() const { return Num() == 0; }
+
+private:
+	static uint32_t RoundUpToPowerOfTwo( uint32_t value )
+	{
+		uint32_t result = 1;
+		while( result < value )
+			result <<= 1;
+		return result;
+	}
+
+	const uint32_t						mCapacity;
+	const uint32_t						mMask;
+	std::unique_ptr<ElementType[]>		mElements;
+
+	// producer and consumer indices live on separate cache lines
+	alignas( 64 ) std::atomic<uint32_t>	mHead;
+	alignas( 64 ) std::atomic<uint32_t>	mTail;
+};
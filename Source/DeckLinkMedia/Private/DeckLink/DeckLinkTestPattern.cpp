@@ -0,0 +1,498 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkTestPattern.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined( _M_X64 ) || defined( __x86_64__ )
+	#define DECKLINK_PATTERN_X86 1
+	#include <immintrin.h>
+	#if defined( _MSC_VER )
+		#define DECKLINK_PATTERN_TARGET_AVX2
+	#else
+		#define DECKLINK_PATTERN_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+	#endif
+#else
+	#define DECKLINK_PATTERN_X86 0
+#endif
+
+using DeckLinkPixelConversion::InstructionSet;
+
+namespace
+{
+	// 5x7 digits, one byte per row from the top, bit 4 is the leftmost column
+	const uint8_t DigitFont[10][7] = {
+		{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },
+		{ 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },
+		{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },
+		{ 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },
+		{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },
+		{ 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },
+		{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },
+		{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },
+		{ 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },
+	};
+
+	const int CounterDigits = 8;
+
+	// horizontal motion in whole fills of every format, so all formats show the same picture
+	const long MotionStep = 24;
+
+#if DECKLINK_PATTERN_X86
+	DECKLINK_PATTERN_TARGET_AVX2 size_t FillBytesAVX2( uint8_t* dst, size_t bytes, const uint8_t* pattern )
+	{
+		const __m256i value = _mm256_broadcastsi128_si256( _mm_loadu_si128( reinterpret_cast<const __m128i*>( pattern ) ) );
+		size_t offset = 0;
+		for( ; offset + 128 <= bytes; offset += 128 ) {
+			_mm256_storeu_si256( reinterpret_cast<__m256i*>( dst + offset ), value );
+			_mm256_storeu_si256( reinterpret_cast<__m256i*>( dst + offset + 32 ), value );
+			_mm256_storeu_si256( reinterpret_cast<__m256i*>( dst + offset + 64 ), value );
+			_mm256_storeu_si256( reinterpret_cast<__m256i*>( dst + offset + 96 ), value );
+		}
+		for( ; offset + 32 <= bytes; offset += 32 )
+			_mm256_storeu_si256( reinterpret_cast<__m256i*>( dst + offset ), value );
+		return offset;
+	}
+
+	size_t FillBytesSSE( uint8_t* dst, size_t bytes, const uint8_t* pattern )
+	{
+		const __m128i value = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pattern ) );
+		size_t offset = 0;
+		for( ; offset + 64 <= bytes; offset += 64 ) {
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( dst + offset ), value );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( dst + offset + 16 ), value );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( dst + offset + 32 ), value );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( dst + offset + 48 ), value );
+		}
+		for( ; offset + 16 <= bytes; offset += 16 )
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( dst + offset ), value );
+		return offset;
+	}
+#endif
+
+	/** Repeats a 16 byte pattern over bytes, the last repetition may be partial. */
+	void FillBytes( uint8_t* dst, size_t bytes, const uint8_t* pattern, InstructionSet isa )
+	{
+		size_t offset = 0;
+
+#if DECKLINK_PATTERN_X86
+		if( isa == InstructionSet::AVX2 )
+			offset = FillBytesAVX2( dst, bytes, pattern );
+		else if( isa == InstructionSet::SSE41 )
+			offset = FillBytesSSE( dst, bytes, pattern );
+#endif
+
+		for( ; offset + 16 <= bytes; offset += 16 )
+			memcpy( dst + offset, pattern, 16 );
+		memcpy( dst + offset, pattern, bytes - offset );
+	}
+
+	inline uint16_t Round10( float value, uint16_t low, uint16_t high )
+	{
+		const long rounded = std::lround( value );
+		return static_cast<uint16_t>( std::min<long>( std::max<long>( rounded, low ), high ) );
+	}
+
+	inline uint8_t Round8( float value )
+	{
+		return static_cast<uint8_t>( std::min<long>( std::max<long>( std::lround( value * 255.0f ), 0 ), 255 ) );
+	}
+
+	/** 10-bit limited range to 8-bit limited range. */
+	inline uint8_t To8Bit( uint16_t value )
+	{
+		return static_cast<uint8_t>( std::min( ( value + 2 ) >> 2, 255 ) );
+	}
+
+	/** 10-bit limited range luma to 8-bit full range grey. */
+	inline uint8_t ToFullRange( uint16_t luma )
+	{
+		if( luma <= 64 )
+			return 0;
+		return static_cast<uint8_t>( std::min( ( ( luma - 64 ) * 255 + 438 ) / 876, 255 ) );
+	}
+
+	inline uint32_t PackV210( uint32_t a, uint32_t b, uint32_t c )
+	{
+		return a | ( b << 10 ) | ( c << 20 );
+	}
+
+	/** Position of a point bouncing between 0 and range. */
+	inline long Bounce( uint64_t distance, long range )
+	{
+		if( range <= 0 )
+			return 0;
+		const long phase = static_cast<long>( distance % ( 2 * static_cast<uint64_t>( range ) ) );
+		return ( phase <= range ) ? phase : 2 * range - phase;
+	}
+}
+
+DeckLinkTestPattern::DeckLinkTestPattern( long width, long height, Format format, Pattern pattern, uint32_t overlays, InstructionSet isa )
+	: mWidth{ std::max( width, 2L ) }
+	, mHeight{ std::max( height, 1L ) }
+	, mFormat{ format }
+	, mPattern{ pattern }
+	, mOverlays{ overlays }
+	, mIsa{ DeckLinkPixelConversion::ResolveInstructionSet( isa ) }
+	, mGranularity{ ( format == Format::UYVY ) ? 8 : ( ( format == Format::V210 ) ? 6 : 4 ) }
+	, mRampPeriod{ 0 }
+	, mZoneScale{ 0 }
+	, mBlock{ 0 }
+	, mCounterRect{ 0, 0, 0, 0 }
+	, mBoxSize{ 0 }
+{
+	mSpanWidth = ( mFormat == Format::V210 ) ? ( mWidth + 5 ) / 6 * 6 : mWidth;
+	mPackedRowBytes = GetByteOffset( mSpanWidth );
+
+	mWhite = MakeFill( 1.0f, 1.0f, 1.0f );
+	mBlack = MakeFill( 0.0f, 0.0f, 0.0f );
+
+	switch( mPattern ) {
+	case Pattern::Bars:			InitBars(); break;
+	case Pattern::Ramp:			InitRamp(); break;
+	case Pattern::ZonePlate:	InitZonePlate(); break;
+	}
+
+	// overlays are sized from the height so they look the same in every mode
+	const long cell = std::max( mHeight / 108, 1L );
+	mBlock = ( cell + mGranularity - 1 ) / mGranularity * mGranularity;
+	mCounterRect.left = 2 * mBlock;
+	mCounterRect.top = 2 * mBlock;
+	mCounterRect.right = std::min( mCounterRect.left + ( CounterDigits * 6 + 1 ) * mBlock, mSpanWidth );
+	mCounterRect.bottom = std::min( mCounterRect.top + 9 * mBlock, mHeight );
+
+	mBoxSize = std::min( ( mHeight / 6 + MotionStep - 1 ) / MotionStep * MotionStep, mWidth / MotionStep * MotionStep );
+}
+
+long DeckLinkTestPattern::GetRowBytes( long width, Format format )
+{
+	switch( format ) {
+	case Format::UYVY:	return width * 2;
+	case Format::V210:	return DeckLinkPixelConversion::GetV210RowBytes( width );
+	default:			return width * 4;
+	}
+}
+
+const char* DeckLinkTestPattern::GetFormatName( Format format )
+{
+	switch( format ) {
+	case Format::UYVY:	return "UYVY";
+	case Format::V210:	return "v210";
+	default:			return "BGRA";
+	}
+}
+
+const char* DeckLinkTestPattern::GetPatternName( Pattern pattern )
+{
+	switch( pattern ) {
+	case Pattern::Ramp:			return "Ramp";
+	case Pattern::ZonePlate:	return "Zone plate";
+	default:					return "Bars";
+	}
+}
+
+DeckLinkTestPattern::Fill DeckLinkTestPattern::MakeFill( float r, float g, float b ) const
+{
+	const bool rec709 = DeckLinkPixelConversion::GetColorimetryForHeight( mHeight ) == DeckLinkPixelConversion::Colorimetry::Rec709;
+	const float kr = rec709 ? 0.2126f : 0.299f;
+	const float kb = rec709 ? 0.0722f : 0.114f;
+
+	// values below black and above white are allowed, PLUGE needs them
+	const float luma = kr * r + ( 1.0f - kr - kb ) * g + kb * b;
+	const uint16_t y = Round10( 64.0f + 876.0f * luma, 4, 1019 );
+	const uint16_t cb = Round10( 512.0f + 896.0f * ( b - luma ) / ( 2.0f * ( 1.0f - kb ) ), 4, 1019 );
+	const uint16_t cr = Round10( 512.0f + 896.0f * ( r - luma ) / ( 2.0f * ( 1.0f - kr ) ), 4, 1019 );
+
+	Fill fill;
+	switch( mFormat ) {
+	case Format::UYVY:
+		for( int pair = 0; pair < 4; ++pair ) {
+			fill.bytes[pair * 4 + 0] = To8Bit( cb );
+			fill.bytes[pair * 4 + 1] = To8Bit( y );
+			fill.bytes[pair * 4 + 2] = To8Bit( cr );
+			fill.bytes[pair * 4 + 3] = To8Bit( y );
+		}
+		break;
+
+	case Format::V210: {
+		const uint32_t words[4] = { PackV210( cb, y, cr ), PackV210( y, cb, y ), PackV210( cr, y, cb ), PackV210( y, cr, y ) };
+		memcpy( fill.bytes, words, sizeof( words ) );
+		break;
+	}
+
+	case Format::BGRA:
+		for( int pixel = 0; pixel < 4; ++pixel ) {
+			fill.bytes[pixel * 4 + 0] = Round8( b );
+			fill.bytes[pixel * 4 + 1] = Round8( g );
+			fill.bytes[pixel * 4 + 2] = Round8( r );
+			fill.bytes[pixel * 4 + 3] = 0xff;
+		}
+		break;
+	}
+	return fill;
+}
+
+long DeckLinkTestPattern::Snap( long x ) const
+{
+	if( x >= mWidth )
+		return mSpanWidth;
+	if( x <= 0 )
+		return 0;
+	return std::min( ( x + mGranularity / 2 ) / mGranularity * mGranularity, mSpanWidth );
+}
+
+long DeckLinkTestPattern::GetByteOffset( long x ) const
+{
+	switch( mFormat ) {
+	case Format::UYVY:	return x * 2;
+	case Format::V210:	return ( x + 5 ) / 6 * 16;
+	default:			return x * 4;
+	}
+}
+
+void DeckLinkTestPattern::FillSpan( uint8_t* row, long left, long right, const Fill& fill ) const
+{
+	if( right <= left )
+		return;
+
+	const long begin = GetByteOffset( left );
+	FillBytes( row + begin, static_cast<size_t>( GetByteOffset( right ) - begin ), fill.bytes, mIsa );
+}
+
+void DeckLinkTestPattern::StoreLuma( uint8_t* row, const uint16_t* luma, long count ) const
+{
+	switch( mFormat ) {
+	case Format::UYVY:
+		for( long x = 0; x + 1 < count; x += 2 ) {
+			row[x * 2 + 0] = 0x80;
+			row[x * 2 + 1] = To8Bit( luma[x] );
+			row[x * 2 + 2] = 0x80;
+			row[x * 2 + 3] = To8Bit( luma[x + 1] );
+		}
+		break;
+
+	case Format::V210:
+		for( long x = 0; x + 5 < count; x += 6 ) {
+			const uint32_t words[4] = {
+				PackV210( 512, luma[x + 0], 512 ),
+				PackV210( luma[x + 1], 512, luma[x + 2] ),
+				PackV210( 512, luma[x + 3], 512 ),
+				PackV210( luma[x + 4], 512, luma[x + 5] ),
+			};
+			memcpy( row + x / 6 * 16, words, sizeof( words ) );
+		}
+		break;
+
+	case Format::BGRA:
+		for( long x = 0; x < count; ++x ) {
+			const uint8_t grey = ToFullRange( luma[x] );
+			row[x * 4 + 0] = grey;
+			row[x * 4 + 1] = grey;
+			row[x * 4 + 2] = grey;
+			row[x * 4 + 3] = 0xff;
+		}
+		break;
+	}
+}
+
+void DeckLinkTestPattern::InitBars()
+{
+	mBarBands[0] = mHeight * 2 / 3;
+	mBarBands[1] = mHeight * 3 / 4;
+	mBarRows.assign( 3 * mPackedRowBytes, 0 );
+
+	const Fill grey = MakeFill( 0.75f, 0.75f, 0.75f );
+	const Fill yellow = MakeFill( 0.75f, 0.75f, 0.0f );
+	const Fill cyan = MakeFill( 0.0f, 0.75f, 0.75f );
+	const Fill green = MakeFill( 0.0f, 0.75f, 0.0f );
+	const Fill magenta = MakeFill( 0.75f, 0.0f, 0.75f );
+	const Fill red = MakeFill( 0.75f, 0.0f, 0.0f );
+	const Fill blue = MakeFill( 0.0f, 0.0f, 0.75f );
+
+	// -I and +Q approximated in R'G'B', PLUGE at -4%, 0% and +4%
+	const Fill minusI = MakeFill( 0.0f, 0.129f, 0.298f );
+	const Fill plusQ = MakeFill( 0.196f, 0.0f, 0.416f );
+	const Fill belowBlack = MakeFill( -0.04f, -0.04f, -0.04f );
+	const Fill aboveBlack = MakeFill( 0.04f, 0.04f, 0.04f );
+
+	auto edge = [this]( long numerator, long denominator ) { return Snap( mWidth * numerator / denominator ); };
+
+	const Fill* top[7] = { &grey, &yellow, &cyan, &green, &magenta, &red, &blue };
+	const Fill* middle[7] = { &blue, &mBlack, &magenta, &mBlack, &cyan, &mBlack, &grey };
+	uint8_t* topRow = &mBarRows[0];
+	uint8_t* middleRow = &mBarRows[mPackedRowBytes];
+	for( long bar = 0; bar < 7; ++bar ) {
+		FillSpan( topRow, edge( bar, 7 ), edge( bar + 1, 7 ), *top[bar] );
+		FillSpan( middleRow, edge( bar, 7 ), edge( bar + 1, 7 ), *middle[bar] );
+	}
+
+	uint8_t* bottomRow = &mBarRows[2 * mPackedRowBytes];
+	FillSpan( bottomRow, 0, edge( 5, 28 ), minusI );
+	FillSpan( bottomRow, edge( 5, 28 ), edge( 10, 28 ), mWhite );
+	FillSpan( bottomRow, edge( 10, 28 ), edge( 15, 28 ), plusQ );
+	FillSpan( bottomRow, edge( 15, 28 ), edge( 15, 21 ), mBlack );
+	FillSpan( bottomRow, edge( 15, 21 ), edge( 16, 21 ), belowBlack );
+	FillSpan( bottomRow, edge( 16, 21 ), edge( 17, 21 ), mBlack );
+	FillSpan( bottomRow, edge( 17, 21 ), edge( 18, 21 ), aboveBlack );
+	FillSpan( bottomRow, edge( 18, 21 ), mSpanWidth, mBlack );
+}
+
+void DeckLinkTestPattern::InitRamp()
+{
+	mRampPeriod = std::max( mWidth / MotionStep * MotionStep, MotionStep );
+
+	// enough pixels that a full row can start anywhere in the first period
+	const long pixels = ( mRampPeriod + mSpanWidth + mGranularity - 1 ) / mGranularity * mGranularity;
+	std::vector<uint16_t> luma( pixels );
+	for( long x = 0; x < pixels; ++x )
+		luma[x] = static_cast<uint16_t>( 64 + 876 * ( x % mRampPeriod ) / std::max( mRampPeriod - 1, 1L ) );
+
+	mRampRow.assign( GetByteOffset( pixels ), 0 );
+	StoreLuma( mRampRow.data(), luma.data(), pixels );
+}
+
+void DeckLinkTestPattern::InitZonePlate()
+{
+	// the phase is pi * r^2 / width, 512 table entries per pi
+	mZoneScale = ( 512ull << 16 ) / static_cast<uint64_t>( mWidth );
+
+	mZoneX.resize( mSpanWidth );
+	for( long x = 0; x < mSpanWidth; ++x ) {
+		const int64_t dx = x - mWidth / 2;
+		mZoneX[x] = static_cast<uint32_t>( static_cast<uint64_t>( dx * dx ) * mZoneScale );
+	}
+
+	// one cosine period, stored as what the format writes per pixel
+	const double pi = 3.14159265358979323846;
+	mZonePixels.resize( 1024 );
+	for( int index = 0; index < 1024; ++index ) {
+		const uint16_t luma = static_cast<uint16_t>( std::lround( 64.0 + 876.0 * ( 0.5 + 0.5 * std::cos( 2.0 * pi * index / 1024.0 ) ) ) );
+		switch( mFormat ) {
+		case Format::UYVY:	mZonePixels[index] = To8Bit( luma ); break;
+		case Format::V210:	mZonePixels[index] = luma; break;
+		case Format::BGRA:	mZonePixels[index] = 0xff000000u | ( ToFullRange( luma ) * 0x010101u ); break;
+		}
+	}
+}
+
+void DeckLinkTestPattern::RenderBackground( uint8_t* row, long y, uint64_t frameNumber, uint16_t* luma ) const
+{
+	switch( mPattern ) {
+	case Pattern::Bars: {
+		const long band = ( y < mBarBands[0] ) ? 0 : ( ( y < mBarBands[1] ) ? 1 : 2 );
+		memcpy( row, &mBarRows[band * mPackedRowBytes], mPackedRowBytes );
+		break;
+	}
+
+	case Pattern::Ramp: {
+		const long speed = std::max( mWidth / 256 / MotionStep * MotionStep, MotionStep );
+		long shift = static_cast<long>( ( frameNumber * speed ) % static_cast<uint64_t>( mRampPeriod ) );
+		shift -= shift % MotionStep;
+		memcpy( row, &mRampRow[GetByteOffset( shift )], mPackedRowBytes );
+		break;
+	}
+
+	case Pattern::ZonePlate: {
+		const int64_t dy = y - mHeight / 2;
+		const uint32_t rowTerm = static_cast<uint32_t>( static_cast<uint64_t>( dy * dy ) * mZoneScale );
+
+		// rings move outwards by 16 table entries per frame, only the low 26 bits of the sum matter
+		const uint32_t phase = static_cast<uint32_t>( frameNumber * 16 );
+		const uint32_t* zoneX = mZoneX.data();
+		auto index = [zoneX, rowTerm, phase]( long x ) { return ( ( ( zoneX[x] + rowTerm ) >> 16 ) - phase ) & 1023; };
+
+		switch( mFormat ) {
+		case Format::UYVY:
+			for( long x = 0; x + 1 < mSpanWidth; x += 2 ) {
+				row[x * 2 + 0] = 0x80;
+				row[x * 2 + 1] = static_cast<uint8_t>( mZonePixels[index( x )] );
+				row[x * 2 + 2] = 0x80;
+				row[x * 2 + 3] = static_cast<uint8_t>( mZonePixels[index( x + 1 )] );
+			}
+			break;
+
+		case Format::V210:
+			for( long x = 0; x < mSpanWidth; ++x )
+				luma[x] = static_cast<uint16_t>( mZonePixels[index( x )] );
+			StoreLuma( row, luma, mSpanWidth );
+			break;
+
+		case Format::BGRA: {
+			uint32_t* pixels = reinterpret_cast<uint32_t*>( row );
+			for( long x = 0; x < mSpanWidth; ++x )
+				pixels[x] = mZonePixels[index( x )];
+			break;
+		}
+		}
+		break;
+	}
+	}
+}
+
+DeckLinkTestPattern::Rect DeckLinkTestPattern::GetBoxRect( uint64_t frameNumber ) const
+{
+	const long speedX = std::max( mWidth / 192 / MotionStep * MotionStep, MotionStep );
+	const long speedY = std::max( mHeight / 192, 1L );
+
+	Rect box;
+	box.left = Bounce( frameNumber * speedX, ( mWidth - mBoxSize ) / MotionStep * MotionStep );
+	box.top = Bounce( frameNumber * speedY, mHeight - mBoxSize );
+	box.right = std::min( box.left + mBoxSize, mSpanWidth );
+	box.bottom = std::min( box.top + mBoxSize, mHeight );
+	return box;
+}
+
+void DeckLinkTestPattern::RenderCounterRow( uint8_t* row, long y, uint64_t frameNumber ) const
+{
+	if( ! mCounterRect.ContainsRow( y ) )
+		return;
+
+	FillSpan( row, mCounterRect.left, mCounterRect.right, mBlack );
+
+	const long glyphRow = ( y - mCounterRect.top ) / mBlock - 1;
+	if( glyphRow < 0 || glyphRow >= 7 )
+		return;
+
+	uint64_t divisor = 1;
+	for( int digit = 1; digit < CounterDigits; ++digit )
+		divisor *= 10;
+
+	for( int digit = 0; digit < CounterDigits; ++digit, divisor /= 10 ) {
+		const uint8_t bits = DigitFont[( frameNumber / divisor ) % 10][glyphRow];
+		for( long column = 0; column < 5; ++column ) {
+			if( ( bits & ( 0x10 >> column ) ) == 0 )
+				continue;
+
+			const long left = mCounterRect.left + mBlock * ( 1 + digit * 6 + column );
+			if( left + mBlock > mCounterRect.right )
+				return;
+			FillSpan( row, left, left + mBlock, mWhite );
+		}
+	}
+}
+
+void DeckLinkTestPattern::Render( uint8_t* dst, long rowBytes, uint64_t frameNumber, long rowBegin, long rowEnd ) const
+{
+	rowBegin = std::max( rowBegin, 0L );
+	rowEnd = std::min( rowEnd, mHeight );
+
+	const bool box = ( mOverlays & OverlayMovingBox ) != 0 && mBoxSize > 0;
+	const Rect boxRect = box ? GetBoxRect( frameNumber ) : Rect{ 0, 0, 0, 0 };
+
+	std::vector<uint16_t> luma;
+	if( mPattern == Pattern::ZonePlate )
+		luma.resize( mSpanWidth );
+
+	for( long y = rowBegin; y < rowEnd; ++y ) {
+		uint8_t* row = dst + y * rowBytes;
+		RenderBackground( row, y, frameNumber, luma.data() );
+
+		if( box && boxRect.ContainsRow( y ) )
+			FillSpan( row, boxRect.left, boxRect.right, mWhite );
+
+		if( mOverlays & OverlayFrameCounter )
+			RenderCounterRow( row, y, frameNumber );
+	}
+}
@@ -0,0 +1,168 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include "DeckLinkPixelConversion.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Synthetic frames with moving content, for exercising capture, conversion
+ * and upload without a card.
+ *
+ * Renders SMPTE colour bars, a scrolling luma ramp or an animated zone plate
+ * in UYVY (bmdFormat8BitYUV), v210 (bmdFormat10BitYUV) or BGRA
+ * (bmdFormat8BitBGRA), with an optional bouncing box and burned-in frame
+ * counter on top. Static backgrounds are packed once and copied per row and
+ * flat areas are written with SIMD pattern fills, so rendering a 4K frame
+ * takes a fraction of a 60 fps frame time.
+ *
+ * Like the pixel conversion kernels, Render writes the rows [rowBegin, rowEnd)
+ * only, so a frame can be split across threads. Rendering never changes the
+ * pattern, concurrent calls are safe.
+ */
+class DeckLinkTestPattern {
+public:
+	enum class Format {
+		UYVY,
+		V210,
+		BGRA,
+	};
+
+	enum class Pattern {
+		/** 75% bars, castellations and -I / white / +Q / PLUGE, as in SMPTE EG 1. */
+		Bars,
+
+		/** Full range luma ramp scrolling to the left. */
+		Ramp,
+
+		/** Circular zone plate reaching Nyquist at the left and right edges, rings moving outwards. */
+		ZonePlate,
+	};
+
+	enum Overlay : uint32_t {
+		OverlayNone				= 0,
+
+		/** White box bouncing off the edges of the frame. */
+		OverlayMovingBox		= 1 << 0,
+
+		/** Frame number as eight digits in the top left corner. */
+		OverlayFrameCounter		= 1 << 1,
+
+		OverlayAll				= OverlayMovingBox | OverlayFrameCounter,
+	};
+
+	DeckLinkTestPattern( long width, long height, Format format, Pattern pattern = Pattern::Bars, uint32_t overlays = OverlayAll,
+		DeckLinkPixelConversion::InstructionSet isa = DeckLinkPixelConversion::DetectInstructionSet() );
+
+	DeckLinkTestPattern( const DeckLinkTestPattern& ) = delete;
+	DeckLinkTestPattern& operator=( const DeckLinkTestPattern& ) = delete;
+
+	long						GetWidth() const { return mWidth; }
+	long						GetHeight() const { return mHeight; }
+	Format						GetFormat() const { return mFormat; }
+	Pattern						GetPattern() const { return mPattern; }
+
+	/** Smallest row pitch of a frame in the given format, as the card would deliver it. */
+	static long					GetRowBytes( long width, Format format );
+	long						GetRowBytes() const { return GetRowBytes( mWidth, mFormat ); }
+
+	static const char*			GetFormatName( Format format );
+	static const char*			GetPatternName( Pattern pattern );
+
+	/** Renders frame frameNumber into dst, rowBytes must be at least GetRowBytes(). */
+	void						Render( uint8_t* dst, long rowBytes, uint64_t frameNumber ) const { Render( dst, rowBytes, frameNumber, 0, mHeight ); }
+	void						Render( uint8_t* dst, long rowBytes, uint64_t frameNumber, long rowBegin, long rowEnd ) const;
+
+private:
+	/** 16 bytes of a flat colour in the frame's format, which every format repeats exactly. */
+	struct Fill {
+		alignas( 16 ) uint8_t	bytes[16];
+	};
+
+	struct Rect {
+		long					left;
+		long					top;
+		long					right;
+		long					bottom;
+
+		bool					ContainsRow( long row ) const { return row >= top && row < bottom; }
+	};
+
+	Fill						MakeFill( float r, float g, float b ) const;
+	long						Snap( long x ) const;
+	long						GetByteOffset( long x ) const;
+	void						FillSpan( uint8_t* row, long left, long right, const Fill& fill ) const;
+	void						StoreLuma( uint8_t* row, const uint16_t* luma, long count ) const;
+
+	void						InitBars();
+	void						InitRamp();
+	void						InitZonePlate();
+
+	void						RenderBackground( uint8_t* row, long y, uint64_t frameNumber, uint16_t* luma ) const;
+	Rect						GetBoxRect( uint64_t frameNumber ) const;
+	void						RenderCounterRow( uint8_t* row, long y, uint64_t frameNumber ) const;
+
+	long						mWidth;
+	long						mHeight;
+	Format						mFormat;
+	Pattern						mPattern;
+	uint32_t					mOverlays;
+	DeckLinkPixelConversion::InstructionSet	mIsa;
+
+	/** Pixels per 16 byte fill, spans start and end on multiples of this. */
+	long						mGranularity;
+
+	/** Pixels a full row of fills covers, mWidth rounded up to whole v210 groups. */
+	long						mSpanWidth;
+	long						mPackedRowBytes;
+
+	Fill						mWhite;
+	Fill						mBlack;
+
+	// bars: three bands of packed rows
+	std::vector<uint8_t>		mBarRows;
+	long						mBarBands[2];
+
+	// ramp: one and a bit periods packed, copied from a moving offset
+	std::vector<uint8_t>		mRampRow;
+	long						mRampPeriod;
+
+	// zone plate: squared distances in lookup table units with 16 fractional bits, modulo 2^32
+	std::vector<uint32_t>		mZoneX;
+	uint64_t					mZoneScale;
+	std::vector<uint32_t>		mZonePixels;
+
+	long						mBlock;
+	Rect						mCounterRect;
+	long						mBoxSize;
+};
@@ -0,0 +1,83 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkTimecode.h"
+
+#include <cstdio>
+
+uint32_t DeckLinkTimecode::GetFrameCount( uint32_t framesPerSecond ) const
+{
+	const uint32_t totalMinutes = GetHours() * 60 + GetMinutes();
+	uint32_t frameCount = ( totalMinutes * 60 + GetSeconds() ) * framesPerSecond + GetFrames();
+
+	if( IsDropFrame() ) {
+		// frame numbers 0 and 1 (per 30 nominal fps) are skipped every minute except every tenth
+		const uint32_t dropPerMinute = 2 * ( ( framesPerSecond + 29 ) / 30 );
+		frameCount -= dropPerMinute * ( totalMinutes - totalMinutes / 10 );
+	}
+	return frameCount;
+}
+
+void DeckLinkTimecode::Format( char ( &buffer )[12] ) const
+{
+	if( ! valid ) {
+		buffer[0] = '\0';
+		return;
+	}
+
+	const uint32_t fields[4] = { GetHours(), GetMinutes(), GetSeconds(), GetFrames() };
+	char* out = buffer;
+	for( int index = 0; index < 4; ++index ) {
+		if( index > 0 )
+			*out++ = ( index == 3 && IsDropFrame() ) ? ';' : ':';
+		*out++ = static_cast<char>( '0' + ( fields[index] / 10 ) % 10 );
+		*out++ = static_cast<char>( '0' + fields[index] % 10 );
+	}
+	*out = '\0';
+}
+
+std::string DeckLinkTimecode::ToString() const
+{
+	char buffer[12];
+	Format( buffer );
+	return buffer;
+}
+
+std::string DeckLinkTimecode::UserBitsToString() const
+{
+	if( ! valid )
+		return std::string();
+
+	char buffer[11];
+	snprintf( buffer, sizeof( buffer ), "0x%08x", userBits );
+	return buffer;
+}
+
+DeckLinkTimecode DeckLinkTimecode::Read( IDeckLinkVideoInputFrame* frame, BMDTimecodeFormat format )
+{
+	DeckLinkTimecode result;
+
+	IDeckLinkTimecode* timecode = NULL;
+	if( frame->GetTimecode( format, &timecode ) != S_OK || timecode == NULL )
+		return result;
+
+	BMDTimecodeUserBits userBits = 0;
+	timecode->GetTimecodeUserBits( &userBits );
+
+	result.bcd = timecode->GetBCD();
+	result.flags = timecode->GetFlags();
+	result.userBits = userBits;
+	result.valid = true;
+
+	timecode->Release();
+	return result;
+}
+
+DeckLinkTimecodes DeckLinkTimecodes::Read( IDeckLinkVideoInputFrame* frame )
+{
+	DeckLinkTimecodes result;
+	result.vitcF1 = DeckLinkTimecode::Read( frame, bmdTimecodeVITC );
+	result.vitcF2 = DeckLinkTimecode::Read( frame, bmdTimecodeVITCField2 );
+	result.rp188vitc1 = DeckLinkTimecode::Read( frame, bmdTimecodeRP188VITC1 );
+	result.rp188vitc2 = DeckLinkTimecode::Read( frame, bmdTimecodeRP188VITC2 );
+	result.rp188ltc = DeckLinkTimecode::Read( frame, bmdTimecodeRP188LTC );
+	return result;
+}
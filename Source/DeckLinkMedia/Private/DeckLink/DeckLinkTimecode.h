@@ -0,0 +1,86 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include "DeckLinkPlatform.h"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * One timecode as delivered by the card, kept in its packed form.
+ *
+ * Reading it from a frame costs a few interface calls and no allocation;
+ * text is only produced when somebody asks for it.
+ */
+struct DeckLinkTimecode {
+	DeckLinkTimecode() : bcd{ 0 }, userBits{ 0 }, flags{ 0 }, valid{ false } { }
+
+	/** Packed BCD, 0xHHMMSSFF. */
+	uint32_t	bcd;
+	uint32_t	userBits;
+	/** BMDTimecodeFlags */
+	uint32_t	flags;
+	bool		valid;
+
+	uint32_t	GetHours() const { return FromBCD( bcd >> 24 ); }
+	uint32_t	GetMinutes() const { return FromBCD( bcd >> 16 ); }
+	uint32_t	GetSeconds() const { return FromBCD( bcd >> 8 ); }
+	uint32_t	GetFrames() const { return FromBCD( bcd ); }
+	bool		IsDropFrame() const { return ( flags & bmdTimecodeIsDropFrame ) != 0; }
+
+	/** Total frame count since midnight at the given nominal rate, accounting for drop frame. */
+	uint32_t	GetFrameCount( uint32_t framesPerSecond ) const;
+
+	/** Writes "HH:MM:SS:FF" (";" before the frames for drop frame) into buffer, or an empty string if not valid. */
+	void		Format( char ( &buffer )[12] ) const;
+
+	std::string	ToString() const;
+	std::string	UserBitsToString() const;
+
+	/** Reads one timecode format from a captured frame; leaves the record invalid if the frame has none. */
+	static DeckLinkTimecode	Read( IDeckLinkVideoInputFrame* frame, BMDTimecodeFormat format );
+
+private:
+	static uint32_t FromBCD( uint32_t value ) { return ( ( value >> 4 ) & 0xf ) * 10 + ( value & 0xf ); }
+};
+
+/** VITC timecodes for field 1 & 2 and RP188 timecodes (VITC1, VITC2 and LTC) of one frame. */
+struct DeckLinkTimecodes {
+	DeckLinkTimecode vitcF1;
+	DeckLinkTimecode vitcF2;
+	DeckLinkTimecode rp188vitc1;
+	DeckLinkTimecode rp188vitc2;
+	DeckLinkTimecode rp188ltc;
+
+	static DeckLinkTimecodes Read( IDeckLinkVideoInputFrame* frame );
+};
@@ -0,0 +1,118 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkTrace.h"
+#include "DeckLinkLatency.h"
+
+#include "HAL/PlatformTLS.h"
+
+#include <cstdio>
+#include <set>
+
+std::atomic_bool DeckLinkTrace::sEnabled{ false };
+std::atomic<uint64_t> DeckLinkTrace::sNext{ 0 };
+std::unique_ptr<DeckLinkTrace::Entry[]> DeckLinkTrace::sEntries;
+
+namespace {
+	struct EventFormat {
+		const char* name;
+		char phase;
+	};
+
+	EventFormat GetFormat( DeckLinkTraceEvent event )
+	{
+		switch( event ) {
+		case DeckLinkTraceEvent::Arrive:		return { "Arrive", 'i' };
+		case DeckLinkTraceEvent::ConvertBegin:	return { "Convert", 'B' };
+		case DeckLinkTraceEvent::ConvertEnd:	return { "Convert", 'E' };
+		case DeckLinkTraceEvent::Enqueue:		return { "Enqueue", 'i' };
+		case DeckLinkTraceEvent::Dequeue:		return { "Dequeue", 'i' };
+		case DeckLinkTraceEvent::UploadBegin:	return { "Upload", 'B' };
+		case DeckLinkTraceEvent::UploadEnd:		return { "Upload", 'E' };
+		case DeckLinkTraceEvent::Display:		return { "Display", 'i' };
+		default:								return { "Unknown", 'i' };
+		}
+	}
+}
+
+void DeckLinkTrace::Start()
+{
+	if( ! sEntries )
+		sEntries.reset( new Entry[Capacity] );
+
+	// events of an earlier session no longer match their stamps and are left out of the next trace
+	for( uint32_t index = 0; index < Capacity; ++index )
+		sEntries[index].stamp.store( 0, std::memory_order_relaxed );
+	sEnabled.store( true );
+}
+
+void DeckLinkTrace::Stop()
+{
+	sEnabled.store( false );
+}
+
+void DeckLinkTrace::Write( DeckLinkTraceEvent event, uint32_t device, uint64_t sequence )
+{
+	const uint64_t index = sNext.fetch_add( 1, std::memory_order_relaxed );
+	Entry& entry = sEntries[index % Capacity];
+
+	// the fence keeps the new fields from showing before the slot reads as being written
+	entry.stamp.store( 0, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+	entry.time.store( DeckLinkLatency::Now(), std::memory_order_relaxed );
+	entry.sequence.store( sequence, std::memory_order_relaxed );
+	entry.threadId.store( FPlatformTLS::GetCurrentThreadId(), std::memory_order_relaxed );
+	entry.device.store( static_cast<uint16_t>( device ), std::memory_order_relaxed );
+	entry.event.store( event, std::memory_order_relaxed );
+	entry.stamp.store( index + 1, std::memory_order_release );
+}
+
+std::string DeckLinkTrace::FormatJson()
+{
+	std::string result = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	if( ! sEntries )
+		return result + "]}";
+
+	const uint64_t end = sNext.load( std::memory_order_acquire );
+	const uint64_t begin = ( end > Capacity ) ? end - Capacity : 0;
+
+	std::set<uint32_t> devices;
+	char line[256];
+	bool first = true;
+	for( uint64_t index = begin; index < end; ++index ) {
+		const Entry& entry = sEntries[index % Capacity];
+		if( entry.stamp.load( std::memory_order_acquire ) != index + 1 )
+			continue;
+
+		// copy the event, then drop it if a writer took the slot meanwhile
+		const int64_t time = entry.time.load( std::memory_order_relaxed );
+		const uint64_t sequence = entry.sequence.load( std::memory_order_relaxed );
+		const uint32_t threadId = entry.threadId.load( std::memory_order_relaxed );
+		const uint16_t device = entry.device.load( std::memory_order_relaxed );
+		const DeckLinkTraceEvent event = entry.event.load( std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_acquire );
+		if( entry.stamp.load( std::memory_order_relaxed ) != index + 1 )
+			continue;
+
+		const EventFormat format = GetFormat( event );
+		snprintf( line, sizeof( line ), "%s\n{\"name\":\"%s\",\"ph\":\"%c\",%s\"ts\":%lld,\"pid\":%u,\"tid\":%u,\"args\":{\"frame\":%llu}}",
+			first ? "" : ",",
+			format.name,
+			format.phase,
+			( format.phase == 'i' ) ? "\"s\":\"t\"," : "",
+			static_cast<long long>( time ),
+			static_cast<unsigned>( device ),
+			static_cast<unsigned>( threadId ),
+			static_cast<unsigned long long>( sequence ) );
+		result += line;
+		devices.insert( device );
+		first = false;
+	}
+
+	for( uint32_t device : devices ) {
+		snprintf( line, sizeof( line ), "%s\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"DeckLink device %u\"}}",
+			first ? "" : ",", device, device );
+		result += line;
+		first = false;
+	}
+
+	return result + "\n]}";
+}
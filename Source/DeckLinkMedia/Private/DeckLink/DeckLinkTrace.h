@@ -0,0 +1,100 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/** What happened to a frame. Convert and Upload come as a begin/end pair, everything else is an instant. */
+enum class DeckLinkTraceEvent : uint8_t {
+	Arrive,
+	ConvertBegin,
+	ConvertEnd,
+	Enqueue,
+	Dequeue,
+	UploadBegin,
+	UploadEnd,
+	Display,
+};
+
+/**
+ * Opt-in recorder of per-frame pipeline events for chrome://tracing.
+ *
+ * Events go into one preallocated ring shared by every device; recording
+ * claims a slot with a single atomic increment and never allocates or
+ * locks, and when tracing is off it is one relaxed load. Once the ring is
+ * full the oldest events are overwritten, so the trace always covers the
+ * most recent window.
+ */
+class DeckLinkTrace {
+public:
+	static const uint32_t Capacity = 1 << 16;
+
+	/** Allocates the ring on first use and starts recording. */
+	static void					Start();
+	static void					Stop();
+	static bool					IsEnabled() { return sEnabled.load( std::memory_order_relaxed ); }
+
+	static void					Record( DeckLinkTraceEvent event, uint32_t device, uint64_t sequence )
+	{
+		if( IsEnabled() )
+			Write( event, device, sequence );
+	}
+
+	/**
+	 * Formats the recorded events as Chrome trace JSON, one process per
+	 * device. Events still being written, or overwritten while they were
+	 * copied, are skipped rather than reported torn.
+	 */
+	static std::string			FormatJson();
+
+private:
+	/** One slot of the ring, a seqlock: the fields are only valid if stamp reads the same before and after copying them. */
+	struct Entry {
+		/** Index of the event + 1 once it is complete, 0 while it is being written. */
+		std::atomic<uint64_t>			stamp;
+		std::atomic<int64_t>			time;
+		std::atomic<uint64_t>			sequence;
+		std::atomic<uint32_t>			threadId;
+		std::atomic<uint16_t>			device;
+		std::atomic<DeckLinkTraceEvent>	event;
+	};
+
+	static void					Write( DeckLinkTraceEvent event, uint32_t device, uint64_t sequence );
+
+	static std::atomic_bool		sEnabled;
+	static std::atomic<uint64_t>	sNext;
+	// allocated once and kept for the life of the process, writers may still be in flight after Stop
+	static std::unique_ptr<Entry[]>	sEntries;
+};
@@ -0,0 +1,683 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkVirtualDevice.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#if PLATFORM_WINDOWS
+#include "Runtime/Core/Public/Windows/AllowWindowsPlatformTypes.h"
+#endif
+
+namespace {
+	const DeckLinkVirtualModeInfo Modes[] = {
+		{ bmdModeNTSC,			"NTSC",			720,	486,	1001,	30000,	bmdLowerFieldFirst },
+		{ bmdModeNTSC2398,		"NTSC 23.98",	720,	486,	1001,	24000,	bmdLowerFieldFirst },
+		{ bmdModePAL,			"PAL",			720,	576,	1000,	25000,	bmdUpperFieldFirst },
+		{ bmdModeNTSCp,			"NTSC p",		720,	486,	1001,	60000,	bmdProgressiveFrame },
+		{ bmdModePALp,			"PAL p",		720,	576,	1000,	50000,	bmdProgressiveFrame },
+		{ bmdModeHD1080p2398,	"1080p23.98",	1920,	1080,	1001,	24000,	bmdProgressiveFrame },
+		{ bmdModeHD1080p24,		"1080p24",		1920,	1080,	1000,	24000,	bmdProgressiveFrame },
+		{ bmdModeHD1080p25,		"1080p25",		1920,	1080,	1000,	25000,	bmdProgressiveFrame },
+		{ bmdModeHD1080p2997,	"1080p29.97",	1920,	1080,	1001,	30000,	bmdProgressiveFrame },
+		{ bmdModeHD1080p30,		"1080p30",		1920,	1080,	1000,	30000,	bmdProgressiveFrame },
+		{ bmdModeHD1080i50,		"1080i50",		1920,	1080,	1000,	25000,	bmdUpperFieldFirst },
+		{ bmdModeHD1080i5994,	"1080i59.94",	1920,	1080,	1001,	30000,	bmdUpperFieldFirst },
+		{ bmdModeHD1080i6000,	"1080i60",		1920,	1080,	1000,	30000,	bmdUpperFieldFirst },
+		{ bmdModeHD1080p50,		"1080p50",		1920,	1080,	1000,	50000,	bmdProgressiveFrame },
+		{ bmdModeHD1080p5994,	"1080p59.94",	1920,	1080,	1001,	60000,	bmdProgressiveFrame },
+		{ bmdModeHD1080p6000,	"1080p60",		1920,	1080,	1000,	60000,	bmdProgressiveFrame },
+		{ bmdModeHD720p50,		"720p50",		1280,	720,	1000,	50000,	bmdProgressiveFrame },
+		{ bmdModeHD720p5994,	"720p59.94",	1280,	720,	1001,	60000,	bmdProgressiveFrame },
+		{ bmdModeHD720p60,		"720p60",		1280,	720,	1000,	60000,	bmdProgressiveFrame },
+		{ bmdMode2k2398,		"2K 23.98",		2048,	1556,	1001,	24000,	bmdProgressiveFrame },
+		{ bmdMode2k24,			"2K 24",		2048,	1556,	1000,	24000,	bmdProgressiveFrame },
+		{ bmdMode2k25,			"2K 25",		2048,	1556,	1000,	25000,	bmdProgressiveFrame },
+		{ bmdMode2kDCI2398,		"2K DCI 23.98",	2048,	1080,	1001,	24000,	bmdProgressiveFrame },
+		{ bmdMode2kDCI24,		"2K DCI 24",	2048,	1080,	1000,	24000,	bmdProgressiveFrame },
+		{ bmdMode2kDCI25,		"2K DCI 25",	2048,	1080,	1000,	25000,	bmdProgressiveFrame },
+		{ bmdMode4K2160p2398,	"2160p23.98",	3840,	2160,	1001,	24000,	bmdProgressiveFrame },
+		{ bmdMode4K2160p24,		"2160p24",		3840,	2160,	1000,	24000,	bmdProgressiveFrame },
+		{ bmdMode4K2160p25,		"2160p25",		3840,	2160,	1000,	25000,	bmdProgressiveFrame },
+		{ bmdMode4K2160p2997,	"2160p29.97",	3840,	2160,	1001,	30000,	bmdProgressiveFrame },
+		{ bmdMode4K2160p30,		"2160p30",		3840,	2160,	1000,	30000,	bmdProgressiveFrame },
+		{ bmdMode4K2160p50,		"2160p50",		3840,	2160,	1000,	50000,	bmdProgressiveFrame },
+		{ bmdMode4K2160p5994,	"2160p59.94",	3840,	2160,	1001,	60000,	bmdProgressiveFrame },
+		{ bmdMode4K2160p60,		"2160p60",		3840,	2160,	1000,	60000,	bmdProgressiveFrame },
+		{ bmdMode4kDCI2398,		"4K DCI 23.98",	4096,	2160,	1001,	24000,	bmdProgressiveFrame },
+		{ bmdMode4kDCI24,		"4K DCI 24",	4096,	2160,	1000,	24000,	bmdProgressiveFrame },
+		{ bmdMode4kDCI25,		"4K DCI 25",	4096,	2160,	1000,	25000,	bmdProgressiveFrame },
+	};
+
+	const size_t ModeCount = sizeof( Modes ) / sizeof( Modes[0] );
+
+	/** Static description of one mode, never deleted. */
+	class VirtualDisplayMode : public IDeckLinkDisplayMode {
+	public:
+		VirtualDisplayMode() : mInfo{ nullptr } { }
+		void Set( const DeckLinkVirtualModeInfo& info ) { mInfo = &info; }
+
+		virtual HRESULT				STDMETHODCALLTYPE GetName( DeckLinkString* name ) override { *name = DeckLinkPlatform::MakeString( mInfo->name ); return S_OK; }
+		virtual BMDDisplayMode		STDMETHODCALLTYPE GetDisplayMode() override { return mInfo->mode; }
+		virtual long				STDMETHODCALLTYPE GetWidth() override { return mInfo->width; }
+		virtual long				STDMETHODCALLTYPE GetHeight() override { return mInfo->height; }
+		virtual HRESULT				STDMETHODCALLTYPE GetFrameRate( BMDTimeValue* frameDuration, BMDTimeScale* timeScale ) override
+		{
+			*frameDuration = mInfo->frameDuration;
+			*timeScale = mInfo->timeScale;
+			return S_OK;
+		}
+		virtual BMDFieldDominance	STDMETHODCALLTYPE GetFieldDominance() override { return mInfo->fieldDominance; }
+		virtual BMDDisplayModeFlags	STDMETHODCALLTYPE GetFlags() override { return ( mInfo->height > 576 ) ? bmdDisplayModeColorspaceRec709 : bmdDisplayModeColorspaceRec601; }
+
+		virtual HRESULT				STDMETHODCALLTYPE QueryInterface( REFIID iid, LPVOID* ppv ) override { return E_NOINTERFACE; }
+		virtual ULONG				STDMETHODCALLTYPE AddRef() override { return 1; }
+		virtual ULONG				STDMETHODCALLTYPE Release() override { return 1; }
+
+	private:
+		const DeckLinkVirtualModeInfo* mInfo;
+	};
+
+	VirtualDisplayMode* GetDisplayModes()
+	{
+		static VirtualDisplayMode displayModes[ModeCount];
+		static bool initialized = false;
+		if( ! initialized ) {
+			for( size_t index = 0; index < ModeCount; ++index )
+				displayModes[index].Set( Modes[index] );
+			initialized = true;
+		}
+		return displayModes;
+	}
+
+	class VirtualDisplayModeIterator : public IDeckLinkDisplayModeIterator {
+	public:
+		VirtualDisplayModeIterator() : mNext{ 0 }, mRefCount{ 1 } { }
+
+		virtual HRESULT				STDMETHODCALLTYPE Next( IDeckLinkDisplayMode** displayMode ) override
+		{
+			if( mNext >= ModeCount ) {
+				*displayMode = NULL;
+				return S_FALSE;
+			}
+			*displayMode = &GetDisplayModes()[mNext++];
+			return S_OK;
+		}
+
+		virtual HRESULT				STDMETHODCALLTYPE QueryInterface( REFIID iid, LPVOID* ppv ) override { return E_NOINTERFACE; }
+		virtual ULONG				STDMETHODCALLTYPE AddRef() override { return ++mRefCount; }
+		virtual ULONG				STDMETHODCALLTYPE Release() override
+		{
+			const ULONG refCount = --mRefCount;
+			if( refCount == 0 )
+				delete this;
+			return refCount;
+		}
+
+	private:
+		size_t				mNext;
+		std::atomic<ULONG>	mRefCount;
+	};
+
+	uint32_t ToBCD( uint32_t value )
+	{
+		return ( ( value / 10 ) << 4 ) | ( value % 10 );
+	}
+}
+
+const DeckLinkVirtualModeInfo* DeckLinkVirtualModeInfo::Find( BMDDisplayMode mode )
+{
+	for( const DeckLinkVirtualModeInfo& info : Modes ) {
+		if( info.mode == mode )
+			return &info;
+	}
+	return NULL;
+}
+
+const DeckLinkVirtualModeInfo* DeckLinkVirtualModeInfo::GetAll( size_t& count )
+{
+	count = ModeCount;
+	return Modes;
+}
+
+
+DeckLinkVirtualVideoFrame::DeckLinkVirtualVideoFrame()
+	: mWidth{ 0 }
+	, mHeight{ 0 }
+	, mRowBytes{ 0 }
+	, mPixelFormat{ bmdFormat8BitYUV }
+	, mBuffer{ NULL }
+	, mBufferAllocator{ NULL }
+	, mStreamTime{ 0 }
+	, mStreamDuration{ 0 }
+	, mTimeScale{ 1 }
+	, mHardwareTime{ 0 }
+	, mTimecode( *this )
+	, mRefCount{ 0 }
+{ }
+
+HRESULT DeckLinkVirtualVideoFrame::GetBytes( void** buffer )
+{
+	*buffer = mBuffer;
+	return ( mBuffer != NULL ) ? S_OK : E_FAIL;
+}
+
+HRESULT DeckLinkVirtualVideoFrame::GetTimecode( BMDTimecodeFormat format, IDeckLinkTimecode** timecode )
+{
+	if( format != bmdTimecodeRP188VITC1 && format != bmdTimecodeRP188Any ) {
+		*timecode = NULL;
+		return S_FALSE;
+	}
+
+	mTimecode.AddRef();
+	*timecode = &mTimecode;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualVideoFrame::GetStreamTime( BMDTimeValue* frameTime, BMDTimeValue* frameDuration, BMDTimeScale timeScale )
+{
+	*frameTime = mStreamTime * timeScale / mTimeScale;
+	*frameDuration = mStreamDuration * timeScale / mTimeScale;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualVideoFrame::GetHardwareReferenceTimestamp( BMDTimeScale timeScale, BMDTimeValue* frameTime, BMDTimeValue* frameDuration )
+{
+	*frameTime = mHardwareTime * timeScale / mTimeScale;
+	*frameDuration = mStreamDuration * timeScale / mTimeScale;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualVideoFrame::QueryInterface( REFIID iid, LPVOID* ppv )
+{
+	if( ppv == NULL )
+		return E_INVALIDARG;
+
+	*ppv = NULL;
+	if( iid == IID_IUnknown || iid == IID_IDeckLinkVideoFrame || iid == IID_IDeckLinkVideoInputFrame ) {
+		*ppv = static_cast<IDeckLinkVideoInputFrame*>( this );
+		AddRef();
+		return S_OK;
+	}
+	return E_NOINTERFACE;
+}
+
+ULONG DeckLinkVirtualVideoFrame::Release()
+{
+	// The generator refills the slot as soon as the count reads 0, so the
+	// last reference gives the buffer back while it is still 1. Only holders
+	// change the count, so at 1 nobody else can.
+	ULONG refCount = mRefCount;
+	while( refCount > 1 ) {
+		if( mRefCount.compare_exchange_weak( refCount, refCount - 1 ) )
+			return refCount - 1;
+	}
+
+	if( mBufferAllocator != NULL ) {
+		mBufferAllocator->ReleaseBuffer( mBuffer );
+		mBufferAllocator->Release();
+		mBufferAllocator = NULL;
+		mBuffer = NULL;
+	}
+	return --mRefCount;
+}
+
+void DeckLinkVirtualVideoFrame::Timecode::Set( uint64_t frameNumber, uint32_t framesPerSecond )
+{
+	const uint64_t totalSeconds = frameNumber / framesPerSecond;
+	mBCD = ( ToBCD( ( totalSeconds / 3600 ) % 24 ) << 24 )
+		| ( ToBCD( ( totalSeconds / 60 ) % 60 ) << 16 )
+		| ( ToBCD( totalSeconds % 60 ) << 8 )
+		| ToBCD( frameNumber % framesPerSecond );
+}
+
+HRESULT DeckLinkVirtualVideoFrame::Timecode::GetComponents( unsigned char* hours, unsigned char* minutes, unsigned char* seconds, unsigned char* frames )
+{
+	auto fromBCD = []( uint32_t value ) { return static_cast<unsigned char>( ( ( value >> 4 ) & 0xf ) * 10 + ( value & 0xf ) ); };
+	*hours = fromBCD( mBCD >> 24 );
+	*minutes = fromBCD( mBCD >> 16 );
+	*seconds = fromBCD( mBCD >> 8 );
+	*frames = fromBCD( mBCD );
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualVideoFrame::Timecode::GetTimecodeUserBits( BMDTimecodeUserBits* userBits )
+{
+	*userBits = 0;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualVideoFrame::Timecode::QueryInterface( REFIID iid, LPVOID* ppv )
+{
+	if( ppv == NULL )
+		return E_INVALIDARG;
+
+	*ppv = NULL;
+	if( iid == IID_IUnknown || iid == IID_IDeckLinkTimecode ) {
+		*ppv = static_cast<IDeckLinkTimecode*>( this );
+		AddRef();
+		return S_OK;
+	}
+	return E_NOINTERFACE;
+}
+
+
+HRESULT DeckLinkVirtualDevice::AudioPacket::GetBytes( void** buffer )
+{
+	*buffer = mSamples.data();
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::AudioPacket::GetPacketTime( BMDTimeValue* packetTime, BMDTimeScale timeScale )
+{
+	*packetTime = mPacketTime * timeScale / AudioSampleRate;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::AudioPacket::QueryInterface( REFIID iid, LPVOID* ppv )
+{
+	if( ppv == NULL )
+		return E_INVALIDARG;
+
+	*ppv = NULL;
+	if( iid == IID_IUnknown || iid == IID_IDeckLinkAudioInputPacket ) {
+		*ppv = static_cast<IDeckLinkAudioInputPacket*>( this );
+		AddRef();
+		return S_OK;
+	}
+	return E_NOINTERFACE;
+}
+
+
+DeckLinkVirtualDevice::DeckLinkVirtualDevice( int64_t subDeviceIndex, DeckLinkTestPattern::Pattern pattern )
+	: mSubDeviceIndex{ subDeviceIndex }
+	, mPattern{ pattern }
+	, mCallback{ NULL }
+	, mAllocator{ NULL }
+	, mMode{ NULL }
+	, mPixelFormat{ bmdFormat8BitYUV }
+	, mVideoEnabled{ false }
+	, mAudioEnabled{ false }
+	, mAudioChannels{ 0 }
+	, mAudioSampleBytes{ 2 }
+	, mGeneratorStop{ false }
+	, mSkippedFrames{ 0 }
+	, mDeliveredFrames{ 0 }
+	, mRenderMicroseconds{ 0 }
+	, mRefCount{ 1 }
+{ }
+
+DeckLinkVirtualDevice::~DeckLinkVirtualDevice()
+{
+	StopStreams();
+	SetCallback( NULL );
+	SetVideoInputFrameMemoryAllocator( NULL );
+	DisableVideoInput();
+}
+
+HRESULT DeckLinkVirtualDevice::GetModelName( DeckLinkString* modelName )
+{
+	*modelName = DeckLinkPlatform::MakeString( "DeckLink Virtual Input" );
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::GetDisplayName( DeckLinkString* displayName )
+{
+	*displayName = DeckLinkPlatform::MakeString( "DeckLink Virtual Input " + std::to_string( mSubDeviceIndex + 1 ) );
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::DoesSupportVideoMode( BMDDisplayMode displayMode, BMDPixelFormat pixelFormat, BMDVideoInputFlags flags, BMDDisplayModeSupport* result, IDeckLinkDisplayMode** resultDisplayMode )
+{
+	const DeckLinkVirtualModeInfo* info = DeckLinkVirtualModeInfo::Find( displayMode );
+	const bool supported = ( info != NULL ) && ( pixelFormat == bmdFormat8BitYUV || pixelFormat == bmdFormat10BitYUV || pixelFormat == bmdFormat8BitBGRA );
+
+	if( result != NULL )
+		*result = supported ? bmdDisplayModeSupported : bmdDisplayModeNotSupported;
+	if( resultDisplayMode != NULL )
+		*resultDisplayMode = supported ? &GetDisplayModes()[info - Modes] : NULL;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::GetDisplayModeIterator( IDeckLinkDisplayModeIterator** iterator )
+{
+	*iterator = new VirtualDisplayModeIterator();
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::EnableVideoInput( BMDDisplayMode displayMode, BMDPixelFormat pixelFormat, BMDVideoInputFlags flags )
+{
+	BMDDisplayModeSupport support = bmdDisplayModeNotSupported;
+	DoesSupportVideoMode( displayMode, pixelFormat, flags, &support, NULL );
+	if( support != bmdDisplayModeSupported )
+		return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock( mMutex );
+	if( mGenerator.joinable() )
+		return E_ACCESSDENIED;
+
+	mMode = DeckLinkVirtualModeInfo::Find( displayMode );
+	mPixelFormat = pixelFormat;
+	mVideoEnabled = true;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::DisableVideoInput()
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	if( mGenerator.joinable() )
+		return E_ACCESSDENIED;
+
+	mVideoEnabled = false;
+	for( DeckLinkVirtualVideoFrame& frame : mFrames ) {
+		// a buffer still lent by an allocator belongs to a frame that is held, its last release returns it
+		if( frame.mBufferAllocator == NULL ) {
+			FMemory::Free( frame.mBuffer );
+			frame.mBuffer = NULL;
+		}
+	}
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::GetAvailableVideoFrameCount( unsigned int* availableFrameCount )
+{
+	// frames are delivered as they are generated, nothing is ever buffered
+	*availableFrameCount = 0;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::SetVideoInputFrameMemoryAllocator( IDeckLinkMemoryAllocator* theAllocator )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	if( mGenerator.joinable() )
+		return E_ACCESSDENIED;
+
+	if( theAllocator )
+		theAllocator->AddRef();
+	if( mAllocator )
+		mAllocator->Release();
+	mAllocator = theAllocator;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::EnableAudioInput( BMDAudioSampleRate sampleRate, BMDAudioSampleType sampleType, unsigned int channelCount )
+{
+	if( sampleRate != bmdAudioSampleRate48kHz || ( channelCount != 2 && channelCount != 8 && channelCount != 16 ) )
+		return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock( mMutex );
+	if( mGenerator.joinable() )
+		return E_ACCESSDENIED;
+
+	mAudioChannels = channelCount;
+	mAudioSampleBytes = ( sampleType == bmdAudioSampleType16bitInteger ) ? 2 : 4;
+	mAudioEnabled = true;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::DisableAudioInput()
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	mAudioEnabled = false;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::GetAvailableAudioSampleFrameCount( unsigned int* availableSampleFrameCount )
+{
+	*availableSampleFrameCount = 0;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::StartStreams()
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	if( ! mVideoEnabled || mMode == NULL )
+		return E_FAIL;
+	if( mGenerator.joinable() )
+		return E_ACCESSDENIED;
+
+	if( mAllocator )
+		mAllocator->Commit();
+
+	const DeckLinkTestPattern::Format format = ( mPixelFormat == bmdFormat10BitYUV ) ? DeckLinkTestPattern::Format::V210
+		: ( ( mPixelFormat == bmdFormat8BitBGRA ) ? DeckLinkTestPattern::Format::BGRA : DeckLinkTestPattern::Format::UYVY );
+	if( ! mRenderer || mRenderer->GetWidth() != mMode->width || mRenderer->GetHeight() != mMode->height || mRenderer->GetFormat() != format )
+		mRenderer.reset( new DeckLinkTestPattern( mMode->width, mMode->height, format, mPattern ) );
+
+	// the longest frame at 23.98 carries 2002 samples, leave room for rounding
+	if( mAudioEnabled ) {
+		const size_t packetBytes = ( AudioSampleRate * mMode->frameDuration / mMode->timeScale + 2 ) * mAudioChannels * mAudioSampleBytes;
+		for( AudioPacket& packet : mAudioPackets )
+			packet.mSamples.assign( packetBytes, 0 );
+	}
+
+	mGeneratorStop = false;
+	mGenerator = std::thread( &DeckLinkVirtualDevice::GeneratorLoop, this );
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::StopStreams()
+{
+	{
+		std::lock_guard<std::mutex> lock( mGeneratorMutex );
+		mGeneratorStop = true;
+	}
+	mGeneratorCondition.notify_one();
+
+	// a callback stopping its own streams cannot wait for itself
+	if( mGenerator.joinable() && mGenerator.get_id() != std::this_thread::get_id() )
+		mGenerator.join();
+	else if( mGenerator.joinable() )
+		mGenerator.detach();
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::SetCallback( IDeckLinkInputCallback* theCallback )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	if( theCallback )
+		theCallback->AddRef();
+	if( mCallback )
+		mCallback->Release();
+	mCallback = theCallback;
+	return S_OK;
+}
+
+int64_t DeckLinkVirtualDevice::GetClockTicks( BMDTimeScale timeScale ) const
+{
+	const auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return static_cast<int64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( now ).count() * ( timeScale / 1000.0 ) / 1000000.0 );
+}
+
+HRESULT DeckLinkVirtualDevice::GetHardwareReferenceClock( BMDTimeScale desiredTimeScale, BMDTimeValue* hardwareTime, BMDTimeValue* timeInFrame, BMDTimeValue* ticksPerFrame )
+{
+	const DeckLinkVirtualModeInfo* mode = mMode;
+	*hardwareTime = GetClockTicks( desiredTimeScale );
+	*ticksPerFrame = ( mode != NULL ) ? mode->frameDuration * desiredTimeScale / mode->timeScale : 0;
+	*timeInFrame = ( *ticksPerFrame > 0 ) ? *hardwareTime % *ticksPerFrame : 0;
+	return S_OK;
+}
+
+HRESULT DeckLinkVirtualDevice::GetFlag( BMDDeckLinkAttributeID cfgID, DeckLinkBool* value )
+{
+	switch( cfgID ) {
+	case BMDDeckLinkSupportsInputFormatDetection:
+	case BMDDeckLinkSupportsFullDuplex:
+		*value = false;
+		return S_OK;
+
+	default:
+		return E_INVALIDARG;
+	}
+}
+
+HRESULT DeckLinkVirtualDevice::GetInt( BMDDeckLinkAttributeID cfgID, DeckLinkInt64* value )
+{
+	switch( cfgID ) {
+	case BMDDeckLinkSubDeviceIndex:
+		*value = mSubDeviceIndex;
+		return S_OK;
+
+	case BMDDeckLinkNumberOfSubDevices:
+		*value = 1;
+		return S_OK;
+
+	case BMDDeckLinkMaximumAudioChannels:
+		*value = 16;
+		return S_OK;
+
+	case BMDDeckLinkVideoIOSupport:
+		*value = bmdDeviceSupportsCapture;
+		return S_OK;
+
+	default:
+		return E_INVALIDARG;
+	}
+}
+
+HRESULT DeckLinkVirtualDevice::GetFloat( BMDDeckLinkAttributeID cfgID, double* value )
+{
+	return E_INVALIDARG;
+}
+
+HRESULT DeckLinkVirtualDevice::GetString( BMDDeckLinkAttributeID cfgID, DeckLinkString* value )
+{
+	return E_INVALIDARG;
+}
+
+HRESULT DeckLinkVirtualDevice::QueryInterface( REFIID iid, LPVOID* ppv )
+{
+	if( ppv == NULL )
+		return E_INVALIDARG;
+
+	*ppv = NULL;
+	if( iid == IID_IUnknown || iid == IID_IDeckLink )
+		*ppv = static_cast<IDeckLink*>( this );
+	else if( iid == IID_IDeckLinkInput )
+		*ppv = static_cast<IDeckLinkInput*>( this );
+	else if( iid == IID_IDeckLinkAttributes )
+		*ppv = static_cast<IDeckLinkAttributes*>( this );
+	else
+		return E_NOINTERFACE;
+
+	AddRef();
+	return S_OK;
+}
+
+ULONG DeckLinkVirtualDevice::Release()
+{
+	const ULONG refCount = --mRefCount;
+	if( refCount == 0 )
+		delete this;
+	return refCount;
+}
+
+void DeckLinkVirtualDevice::GeneratorLoop()
+{
+	const DeckLinkVirtualModeInfo& mode = *mMode;
+	const auto frameInterval = std::chrono::nanoseconds( mode.frameDuration * 1000000000ll / mode.timeScale );
+	auto nextFrame = std::chrono::steady_clock::now();
+
+	for( uint64_t frameNumber = 0; ; ++frameNumber ) {
+		{
+			std::unique_lock<std::mutex> lock( mGeneratorMutex );
+			if( mGeneratorCondition.wait_until( lock, nextFrame, [this]() { return mGeneratorStop; } ) )
+				return;
+		}
+
+		if( DeliverFrame( frameNumber ) )
+			++mDeliveredFrames;
+		else
+			++mSkippedFrames;
+
+		// keep the cadence of the mode, a late frame does not shift the ones after it
+		nextFrame += frameInterval;
+	}
+}
+
+bool DeckLinkVirtualDevice::DeliverFrame( uint64_t frameNumber )
+{
+	const DeckLinkVirtualModeInfo& mode = *mMode;
+	const uint32_t slot = static_cast<uint32_t>( frameNumber % FrameSlots );
+	DeckLinkVirtualVideoFrame& frame = mFrames[slot];
+	AudioPacket& audio = mAudioPackets[slot];
+	if( frame.mRefCount != 0 || audio.mRefCount != 0 )
+		return false;
+
+	const long rowBytes = mRenderer->GetRowBytes();
+	const unsigned int bufferSize = static_cast<unsigned int>( rowBytes * mode.height );
+
+	// own buffers are kept between frames unless an allocator took over or the mode changed;
+	// a free slot never holds an allocator's buffer, the last release gave it back
+	check( frame.mBufferAllocator == NULL );
+	if( frame.mBuffer != NULL && ( mAllocator != NULL || frame.mRowBytes * frame.mHeight != static_cast<long>( bufferSize ) ) ) {
+		FMemory::Free( frame.mBuffer );
+		frame.mBuffer = NULL;
+	}
+
+	// like the driver, every frame gets its buffer from the allocator and gives it back on release
+	if( mAllocator != NULL ) {
+		if( mAllocator->AllocateBuffer( bufferSize, &frame.mBuffer ) != S_OK || frame.mBuffer == NULL ) {
+			frame.mBuffer = NULL;
+			return false;
+		}
+		mAllocator->AddRef();
+		frame.mBufferAllocator = mAllocator;
+	}
+	else if( frame.mBuffer == NULL ) {
+		frame.mBuffer = FMemory::Malloc( bufferSize, 64 );
+	}
+
+	frame.mWidth = mode.width;
+	frame.mHeight = mode.height;
+	frame.mRowBytes = rowBytes;
+	frame.mPixelFormat = mPixelFormat;
+	frame.mTimeScale = mode.timeScale;
+	frame.mStreamDuration = mode.frameDuration;
+	frame.mStreamTime = static_cast<BMDTimeValue>( frameNumber ) * mode.frameDuration;
+	frame.mHardwareTime = GetClockTicks( mode.timeScale );
+	frame.mTimecode.Set( frameNumber, static_cast<uint32_t>( ( mode.timeScale + mode.frameDuration - 1 ) / mode.frameDuration ) );
+	FillFrame( frame, frameNumber );
+
+	IDeckLinkAudioInputPacket* audioPacket = NULL;
+	if( mAudioEnabled ) {
+		// whole samples up to the end of this frame, so the packets add up exactly
+		const BMDTimeValue start = static_cast<BMDTimeValue>( frameNumber ) * mode.frameDuration * AudioSampleRate / mode.timeScale;
+		const BMDTimeValue end = static_cast<BMDTimeValue>( frameNumber + 1 ) * mode.frameDuration * AudioSampleRate / mode.timeScale;
+		audio.mPacketTime = start;
+		audio.mSampleFrames = static_cast<long>( end - start );
+		audioPacket = &audio;
+	}
+
+	frame.AddRef();
+	if( audioPacket )
+		audioPacket->AddRef();
+
+	IDeckLinkInputCallback* callback = NULL;
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		callback = mCallback;
+		if( callback )
+			callback->AddRef();
+	}
+	if( callback ) {
+		callback->VideoInputFrameArrived( &frame, audioPacket );
+		callback->Release();
+	}
+
+	if( audioPacket )
+		audioPacket->Release();
+	frame.Release();
+	return true;
+}
+
+void DeckLinkVirtualDevice::FillFrame( DeckLinkVirtualVideoFrame& frame, uint64_t frameNumber )
+{
+	const auto start = std::chrono::steady_clock::now();
+	mRenderer->Render( static_cast<uint8_t*>( frame.mBuffer ), frame.mRowBytes, frameNumber );
+	mRenderMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start ).count();
+}
+
+#if PLATFORM_WINDOWS
+#include "Runtime/Core/Public/Windows/HideWindowsPlatformTypes.h"
+#endif
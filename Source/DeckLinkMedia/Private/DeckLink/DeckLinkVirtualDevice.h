@@ -0,0 +1,251 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include "DeckLinkPlatform.h"
+#include "DeckLinkTestPattern.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class DeckLinkVirtualDevice;
+
+/** Geometry and timing of a display mode the virtual device can generate. */
+struct DeckLinkVirtualModeInfo {
+	BMDDisplayMode		mode;
+	const char*			name;
+	long				width;
+	long				height;
+	BMDTimeValue		frameDuration;
+	BMDTimeScale		timeScale;
+	BMDFieldDominance	fieldDominance;
+
+	/** Every mode DeckLinkDevice::GetDisplayModeString knows, or NULL if mode is not one of them. */
+	static const DeckLinkVirtualModeInfo*	Find( BMDDisplayMode mode );
+	static const DeckLinkVirtualModeInfo*	GetAll( size_t& count );
+};
+
+/**
+ * Video frame handed to the input callback by the virtual device.
+ *
+ * The device owns a fixed set of these and recycles a frame once the
+ * capture side drops its last reference, giving the pixel buffer back to
+ * the memory allocator it came from, like the driver does.
+ */
+class DeckLinkVirtualVideoFrame : public IDeckLinkVideoInputFrame {
+public:
+	DeckLinkVirtualVideoFrame();
+
+	virtual long				STDMETHODCALLTYPE GetWidth() override { return mWidth; }
+	virtual long				STDMETHODCALLTYPE GetHeight() override { return mHeight; }
+	virtual long				STDMETHODCALLTYPE GetRowBytes() override { return mRowBytes; }
+	virtual BMDPixelFormat		STDMETHODCALLTYPE GetPixelFormat() override { return mPixelFormat; }
+	virtual BMDFrameFlags		STDMETHODCALLTYPE GetFlags() override { return bmdFrameFlagDefault; }
+	virtual HRESULT				STDMETHODCALLTYPE GetBytes( void** buffer ) override;
+	virtual HRESULT				STDMETHODCALLTYPE GetTimecode( BMDTimecodeFormat format, IDeckLinkTimecode** timecode ) override;
+	virtual HRESULT				STDMETHODCALLTYPE GetAncillaryData( IDeckLinkVideoFrameAncillary** ancillary ) override { return E_NOINTERFACE; }
+	virtual HRESULT				STDMETHODCALLTYPE GetStreamTime( BMDTimeValue* frameTime, BMDTimeValue* frameDuration, BMDTimeScale timeScale ) override;
+	virtual HRESULT				STDMETHODCALLTYPE GetHardwareReferenceTimestamp( BMDTimeScale timeScale, BMDTimeValue* frameTime, BMDTimeValue* frameDuration ) override;
+
+	virtual HRESULT				STDMETHODCALLTYPE QueryInterface( REFIID iid, LPVOID* ppv ) override;
+	virtual ULONG				STDMETHODCALLTYPE AddRef() override { return ++mRefCount; }
+	virtual ULONG				STDMETHODCALLTYPE Release() override;
+
+private:
+	/** RP188 timecode counted from the frame number, lives as long as its frame. */
+	class Timecode : public IDeckLinkTimecode {
+	public:
+		explicit Timecode( DeckLinkVirtualVideoFrame& frame ) : mFrame( frame ), mBCD{ 0 } { }
+
+		virtual BMDTimecodeBCD		STDMETHODCALLTYPE GetBCD() override { return mBCD; }
+		virtual HRESULT				STDMETHODCALLTYPE GetComponents( unsigned char* hours, unsigned char* minutes, unsigned char* seconds, unsigned char* frames ) override;
+		virtual HRESULT				STDMETHODCALLTYPE GetString( DeckLinkString* timecode ) override { return E_NOTIMPL; }
+		virtual BMDTimecodeFlags	STDMETHODCALLTYPE GetFlags() override { return bmdTimecodeFlagDefault; }
+		virtual HRESULT				STDMETHODCALLTYPE GetTimecodeUserBits( BMDTimecodeUserBits* userBits ) override;
+		virtual HRESULT				STDMETHODCALLTYPE QueryInterface( REFIID iid, LPVOID* ppv ) override;
+		virtual ULONG				STDMETHODCALLTYPE AddRef() override { return mFrame.AddRef(); }
+		virtual ULONG				STDMETHODCALLTYPE Release() override { return mFrame.Release(); }
+
+		/** Counts frames at the mode's nominal integer rate. */
+		void						Set( uint64_t frameNumber, uint32_t framesPerSecond );
+
+	private:
+		DeckLinkVirtualVideoFrame&	mFrame;
+		BMDTimecodeBCD				mBCD;
+	};
+
+	long						mWidth;
+	long						mHeight;
+	long						mRowBytes;
+	BMDPixelFormat				mPixelFormat;
+	void*						mBuffer;
+	/** Allocator that lent mBuffer, held until the buffer goes back; NULL while the device owns it. */
+	IDeckLinkMemoryAllocator*	mBufferAllocator;
+	BMDTimeValue				mStreamTime;
+	BMDTimeValue				mStreamDuration;
+	BMDTimeScale				mTimeScale;
+	BMDTimeValue				mHardwareTime;
+	Timecode					mTimecode;
+	std::atomic<ULONG>			mRefCount;
+
+	friend class DeckLinkVirtualDevice;
+};
+
+/**
+ * Software stand-in for a DeckLink input card.
+ *
+ * Implements IDeckLink, IDeckLinkInput and IDeckLinkAttributes, so a
+ * DeckLinkDevice runs on it unchanged. Once streams are started a timer
+ * thread delivers DeckLinkTestPattern frames at the enabled display mode's
+ * rate in the enabled pixel format (8 or 10-bit YUV or BGRA), into buffers
+ * from the installed memory allocator, with stream and hardware times, an
+ * RP188 timecode and silent embedded audio if enabled. A frame whose slot is still held by the
+ * capture side is skipped, like a card dropping frames.
+ *
+ * Registered with DeckLinkDeviceDiscovery::AddVirtualDevice, so the whole
+ * capture pipeline can be exercised without a card.
+ */
+class DeckLinkVirtualDevice : public IDeckLink, public IDeckLinkInput, public IDeckLinkAttributes {
+public:
+	explicit DeckLinkVirtualDevice( int64_t subDeviceIndex, DeckLinkTestPattern::Pattern pattern = DeckLinkTestPattern::Pattern::Bars );
+
+	DeckLinkVirtualDevice( const DeckLinkVirtualDevice& ) = delete;
+	DeckLinkVirtualDevice& operator=( const DeckLinkVirtualDevice& ) = delete;
+
+	/** Frames skipped because the capture side still held every frame slot. */
+	uint64_t					GetSkippedFrames() const { return mSkippedFrames; }
+	/** Frames handed to the input callback. */
+	uint64_t					GetDeliveredFrames() const { return mDeliveredFrames; }
+	/** Time the generator thread spent drawing test patterns, which a card does not cost the host, in microseconds. */
+	uint64_t					GetRenderMicroseconds() const { return mRenderMicroseconds; }
+
+	// IDeckLink
+	virtual HRESULT				STDMETHODCALLTYPE GetModelName( DeckLinkString* modelName ) override;
+	virtual HRESULT				STDMETHODCALLTYPE GetDisplayName( DeckLinkString* displayName ) override;
+
+	// IDeckLinkInput
+	virtual HRESULT				STDMETHODCALLTYPE DoesSupportVideoMode( BMDDisplayMode displayMode, BMDPixelFormat pixelFormat, BMDVideoInputFlags flags, BMDDisplayModeSupport* result, IDeckLinkDisplayMode** resultDisplayMode ) override;
+	virtual HRESULT				STDMETHODCALLTYPE GetDisplayModeIterator( IDeckLinkDisplayModeIterator** iterator ) override;
+	virtual HRESULT				STDMETHODCALLTYPE SetScreenPreviewCallback( IDeckLinkScreenPreviewCallback* previewCallback ) override { return E_NOTIMPL; }
+	virtual HRESULT				STDMETHODCALLTYPE EnableVideoInput( BMDDisplayMode displayMode, BMDPixelFormat pixelFormat, BMDVideoInputFlags flags ) override;
+	virtual HRESULT				STDMETHODCALLTYPE DisableVideoInput() override;
+	virtual HRESULT				STDMETHODCALLTYPE GetAvailableVideoFrameCount( unsigned int* availableFrameCount ) override;
+	virtual HRESULT				STDMETHODCALLTYPE SetVideoInputFrameMemoryAllocator( IDeckLinkMemoryAllocator* theAllocator ) override;
+	virtual HRESULT				STDMETHODCALLTYPE EnableAudioInput( BMDAudioSampleRate sampleRate, BMDAudioSampleType sampleType, unsigned int channelCount ) override;
+	virtual HRESULT				STDMETHODCALLTYPE DisableAudioInput() override;
+	virtual HRESULT				STDMETHODCALLTYPE GetAvailableAudioSampleFrameCount( unsigned int* availableSampleFrameCount ) override;
+	virtual HRESULT				STDMETHODCALLTYPE StartStreams() override;
+	virtual HRESULT				STDMETHODCALLTYPE StopStreams() override;
+	virtual HRESULT				STDMETHODCALLTYPE PauseStreams() override { return E_NOTIMPL; }
+	virtual HRESULT				STDMETHODCALLTYPE FlushStreams() override { return S_OK; }
+	virtual HRESULT				STDMETHODCALLTYPE SetCallback( IDeckLinkInputCallback* theCallback ) override;
+	virtual HRESULT				STDMETHODCALLTYPE GetHardwareReferenceClock( BMDTimeScale desiredTimeScale, BMDTimeValue* hardwareTime, BMDTimeValue* timeInFrame, BMDTimeValue* ticksPerFrame ) override;
+
+	// IDeckLinkAttributes
+	virtual HRESULT				STDMETHODCALLTYPE GetFlag( BMDDeckLinkAttributeID cfgID, DeckLinkBool* value ) override;
+	virtual HRESULT				STDMETHODCALLTYPE GetInt( BMDDeckLinkAttributeID cfgID, DeckLinkInt64* value ) override;
+	virtual HRESULT				STDMETHODCALLTYPE GetFloat( BMDDeckLinkAttributeID cfgID, double* value ) override;
+	virtual HRESULT				STDMETHODCALLTYPE GetString( BMDDeckLinkAttributeID cfgID, DeckLinkString* value ) override;
+
+	// IUnknown
+	virtual HRESULT				STDMETHODCALLTYPE QueryInterface( REFIID iid, LPVOID* ppv ) override;
+	virtual ULONG				STDMETHODCALLTYPE AddRef() override { return ++mRefCount; }
+	virtual ULONG				STDMETHODCALLTYPE Release() override;
+
+private:
+	/** Silent audio for one frame, recycled like the video frames. */
+	class AudioPacket : public IDeckLinkAudioInputPacket {
+	public:
+		AudioPacket() : mSampleFrames{ 0 }, mPacketTime{ 0 }, mRefCount{ 0 } { }
+
+		virtual long			STDMETHODCALLTYPE GetSampleFrameCount() override { return mSampleFrames; }
+		virtual HRESULT			STDMETHODCALLTYPE GetBytes( void** buffer ) override;
+		virtual HRESULT			STDMETHODCALLTYPE GetPacketTime( BMDTimeValue* packetTime, BMDTimeScale timeScale ) override;
+		virtual HRESULT			STDMETHODCALLTYPE QueryInterface( REFIID iid, LPVOID* ppv ) override;
+		virtual ULONG			STDMETHODCALLTYPE AddRef() override { return ++mRefCount; }
+		virtual ULONG			STDMETHODCALLTYPE Release() override { return --mRefCount; }
+
+		std::vector<uint8_t>	mSamples;
+		long					mSampleFrames;
+		/** In samples at 48kHz. */
+		BMDTimeValue			mPacketTime;
+		std::atomic<ULONG>		mRefCount;
+	};
+
+	// reference counted, only Release may delete
+	virtual ~DeckLinkVirtualDevice();
+
+	static const uint32_t		FrameSlots = 16;
+	static const uint32_t		AudioSampleRate = 48000;
+
+	void						GeneratorLoop();
+	bool						DeliverFrame( uint64_t frameNumber );
+	void						FillFrame( DeckLinkVirtualVideoFrame& frame, uint64_t frameNumber );
+	int64_t						GetClockTicks( BMDTimeScale timeScale ) const;
+
+	int64_t						mSubDeviceIndex;
+	DeckLinkTestPattern::Pattern	mPattern;
+	std::unique_ptr<DeckLinkTestPattern>	mRenderer;
+
+	std::mutex					mMutex;
+	IDeckLinkInputCallback*		mCallback;
+	IDeckLinkMemoryAllocator*	mAllocator;
+
+	const DeckLinkVirtualModeInfo*	mMode;
+	BMDPixelFormat				mPixelFormat;
+	bool						mVideoEnabled;
+
+	bool						mAudioEnabled;
+	uint32_t					mAudioChannels;
+	uint32_t					mAudioSampleBytes;
+
+	DeckLinkVirtualVideoFrame	mFrames[FrameSlots];
+	AudioPacket					mAudioPackets[FrameSlots];
+
+	std::thread					mGenerator;
+	std::mutex					mGeneratorMutex;
+	std::condition_variable		mGeneratorCondition;
+	bool						mGeneratorStop;
+
+	std::atomic<uint64_t>		mSkippedFrames;
+	std::atomic<uint64_t>		mDeliveredFrames;
+	std::atomic<uint64_t>		mRenderMicroseconds;
+	std::atomic<ULONG>			mRefCount;
+
+	friend class DeckLinkVirtualVideoFrame;
+};
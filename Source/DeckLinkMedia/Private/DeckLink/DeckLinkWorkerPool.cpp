@@ -0,0 +1,96 @@
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkWorkerPool.h"
+
+DeckLinkWorkerPool::DeckLinkWorkerPool( uint32_t threadCount )
+	: mGeneration{ 0 }
+	, mStopping{ false }
+	, mTask{ nullptr }
+	, mContext{ nullptr }
+	, mCount{ 0 }
+	, mClaim{ 0 }
+	, mPending{ 0 }
+{
+	mThreads.reserve( threadCount );
+	for( uint32_t index = 0; index < threadCount; ++index ) {
+		mThreads.emplace_back( &DeckLinkWorkerPool::WorkerLoop, this );
+	}
+}
+
+DeckLinkWorkerPool::~DeckLinkWorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mStopping = true;
+	}
+	mWakeCondition.notify_all();
+
+	for( auto& thread : mThreads ) {
+		thread.join();
+	}
+}
+
+void DeckLinkWorkerPool::Dispatch( uint32_t count, TaskFunction task, const void* context )
+{
+	if( mThreads.empty() || count <= 1 ) {
+		for( uint32_t index = 0; index < count; ++index ) {
+			task( context, index );
+		}
+		return;
+	}
+
+	uint32_t generation;
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mTask = task;
+		mContext = context;
+		mCount = count;
+		mPending = count;
+		generation = ++mGeneration;
+		mClaim = static_cast<uint64_t>( generation ) << 32;
+	}
+	mWakeCondition.notify_all();
+
+	RunTasks( generation );
+
+	std::unique_lock<std::mutex> lock( mMutex );
+	mDoneCondition.wait( lock, [this]() { return mPending == 0; } );
+}
+
+void DeckLinkWorkerPool::RunTasks( uint32_t generation )
+{
+	uint64_t claim = mClaim.load();
+
+	for( ;; ) {
+		const uint32_t index = static_cast<uint32_t>( claim );
+		if( static_cast<uint32_t>( claim >> 32 ) != generation || index >= mCount )
+			return;
+
+		if( ! mClaim.compare_exchange_weak( claim, claim + 1 ) )
+			continue;
+
+		mTask( mContext, index );
+		claim = mClaim.load();
+
+		if( --mPending == 0 ) {
+			std::lock_guard<std::mutex> lock( mMutex );
+			mDoneCondition.notify_one();
+		}
+	}
+}
+
+void DeckLinkWorkerPool::WorkerLoop()
+{
+	uint32_t generation = 0;
+
+	for( ;; ) {
+		{
+			std::unique_lock<std::mutex> lock( mMutex );
+			mWakeCondition.wait( lock, [&]() { return mStopping || mGeneration != generation; } );
+			if( mStopping )
+				return;
+			generation = mGeneration;
+		}
+
+		RunTasks( generation );
+	}
+}
@@ -0,0 +1,91 @@
+/*
+* Copyright (c) 2017, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/**
+ * Small fixed-size thread pool for splitting one job into independent parts.
+ *
+ * ParallelFor hands out indices to the workers and to the calling thread and
+ * returns once every index has run. Only one ParallelFor may be in flight per
+ * pool; each frame converter owns its own pool.
+ */
+class DeckLinkWorkerPool {
+public:
+	explicit DeckLinkWorkerPool( uint32_t threadCount );
+	~DeckLinkWorkerPool();
+
+	DeckLinkWorkerPool( const DeckLinkWorkerPool& ) = delete;
+	DeckLinkWorkerPool& operator=( const DeckLinkWorkerPool& ) = delete;
+
+	/** Number of worker threads, not counting the thread calling ParallelFor. */
+	uint32_t					GetThreadCount() const { return static_cast<uint32_t>( mThreads.size() ); }
+
+	/** Calls function( index ) for every index in [0, count). Does not allocate. */
+	template<typename FunctionType>
+	void						ParallelFor( uint32_t count, const FunctionType& function )
+	{
+		Dispatch( count, &Invoke<FunctionType>, &function );
+	}
+
+private:
+	typedef void ( *TaskFunction )( const void* context, uint32_t index );
+
+	template<typename FunctionType>
+	static void					Invoke( const void* context, uint32_t index ) { ( *static_cast<const FunctionType*>( context ) )( index ); }
+
+	void						Dispatch( uint32_t count, TaskFunction task, const void* context );
+	void						RunTasks( uint32_t generation );
+	void						WorkerLoop();
+
+	std::vector<std::thread>		mThreads;
+
+	std::mutex						mMutex;
+	std::condition_variable			mWakeCondition;
+	std::condition_variable			mDoneCondition;
+	uint32_t						mGeneration;
+	bool							mStopping;
+
+	// Current job, written under mMutex before the generation is published.
+	// mClaim packs the generation (high 32 bits) with the next index so a
+	// worker that wakes up late cannot claim indices of a newer job.
+	TaskFunction					mTask;
+	const void*						mContext;
+	std::atomic<uint32_t>			mCount;
+	std::atomic<uint64_t>			mClaim;
+	std::atomic<uint32_t>			mPending;
+};
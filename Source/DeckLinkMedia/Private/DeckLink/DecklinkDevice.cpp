@@ -1,37 +1,30 @@
 
 #include "DeckLinkMediaPrivate.h"
 #include "DecklinkDevice.h"
+#include "DeckLinkMediaStats.h"
+#include "DeckLinkVirtualDevice.h"
 
+#include <algorithm>
 #include <string>
-#include <locale>
-#include <codecvt>
 
+#if PLATFORM_WINDOWS
 #include "Runtime/Core/Public/Windows/AllowWindowsPlatformTypes.h"
-#include "Runtime/Core/Public/Windows/AllowWindowsPlatformAtomics.h"
-#include <comdef.h>
 
 #pragma warning( disable: 4800 )
-
-std::string ws2s( const std::wstring& wstr )
-{
-	using convert_typeX = std::codecvt_utf8<wchar_t>;
-	std::wstring_convert<convert_typeX, wchar_t> converterX;
-
-	return converterX.to_bytes( wstr );
-}
+#endif
 
 DeckLinkDeviceDiscovery::DeckLinkDeviceDiscovery( std::function<void( IDeckLink*, size_t )> deviceCallback )
-	: mDeviceArrivedCallback{ deviceCallback }, m_deckLinkDiscovery( NULL ), m_refCount( 1 ), mVideoConverter{ NULL }
+	: m_deckLinkDiscovery( NULL ), m_refCount( 1 ), mVideoConverter{ NULL }, mDeviceArrivedCallback{ deviceCallback }
 {
-	if( CoCreateInstance( CLSID_CDeckLinkDiscovery, NULL, CLSCTX_ALL, IID_IDeckLinkDiscovery, (void**)&m_deckLinkDiscovery ) != S_OK ) {
-		m_deckLinkDiscovery = NULL;
+	m_deckLinkDiscovery = DeckLinkPlatform::CreateDiscovery();
+	if( m_deckLinkDiscovery == NULL ) {
 		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Failed to create decklink discovery instance." ) );
 		return;
 	}
 
-	if( CoCreateInstance( CLSID_CDeckLinkVideoConversion, NULL, CLSCTX_ALL, IID_IDeckLinkVideoConversion, (void**)&mVideoConverter ) != S_OK ) {
+	mVideoConverter = DeckLinkPlatform::CreateVideoConversion();
+	if( mVideoConverter == NULL ) {
 		UE_LOG( LogDeckLinkMedia, Error, TEXT( "Failed to create video converter." ) );
-		mVideoConverter = NULL;
 	}
 
 	m_deckLinkDiscovery->InstallDeviceNotifications( this );
@@ -56,12 +49,11 @@ std::string DeckLinkDeviceDiscovery::GetDeviceName( IDeckLink * device )
 		return "";
 	}
 	
-	BSTR cfStrName;
+	DeckLinkString cfStrName;
 	// Get the name of this device
 	if( device->GetDisplayName( &cfStrName ) == S_OK ) {
 		check( cfStrName != NULL );
-		std::wstring ws( cfStrName, SysStringLen( cfStrName ) );
-		return ws2s( ws );
+		return DeckLinkPlatform::TakeString( cfStrName );
 	}
 
 	UE_LOG( LogDeckLinkMedia, Warning, TEXT( "No device." ) );
@@ -71,7 +63,7 @@ std::string DeckLinkDeviceDiscovery::GetDeviceName( IDeckLink * device )
 HRESULT     DeckLinkDeviceDiscovery::DeckLinkDeviceArrived( IDeckLink* decklink )
 {
 	IDeckLinkAttributes* deckLinkAttributes = NULL;
-	LONGLONG index = 0;
+	DeckLinkInt64 index = 0;
 	if( decklink->QueryInterface( IID_IDeckLinkAttributes, (void**)&deckLinkAttributes ) == S_OK ) {
 		if( deckLinkAttributes->GetInt( BMDDeckLinkSubDeviceIndex, &index ) != S_OK ) {
 			UE_LOG( LogDeckLinkMedia, Error, TEXT( "Cannot read device index." ) );
@@ -83,9 +75,18 @@ HRESULT     DeckLinkDeviceDiscovery::DeckLinkDeviceArrived( IDeckLink* decklink
 	return S_OK;
 }
 
+void DeckLinkDeviceDiscovery::AddVirtualDevice( size_t index, DeckLinkTestPattern::Pattern pattern )
+{
+	DeckLinkVirtualDevice* device = new DeckLinkVirtualDevice( static_cast<int64_t>( index ), pattern );
+	DeckLinkDeviceArrived( device );
+
+	// the DeckLinkDevice made from it holds its own reference
+	device->Release();
+}
+
 HRESULT     DeckLinkDeviceDiscovery::DeckLinkDeviceRemoved(/* in */ IDeckLink* decklink )
 {
-	UE_LOG( LogDeckLinkMedia, Log, TEXT( "DeckLink device %s removed." ), GetDeviceName( decklink ).c_str() );
+	UE_LOG( LogDeckLinkMedia, Log, TEXT( "DeckLink device %s removed." ), UTF8_TO_TCHAR( GetDeviceName( decklink ).c_str() ) );
 	return S_OK;
 }
 
@@ -118,14 +119,12 @@ HRESULT	STDMETHODCALLTYPE DeckLinkDeviceDiscovery::QueryInterface( REFIID iid, L
 
 ULONG STDMETHODCALLTYPE DeckLinkDeviceDiscovery::AddRef( void )
 {
-	return InterlockedIncrement( (LONG*)&m_refCount );
+	return ++m_refCount;
 }
 
 ULONG STDMETHODCALLTYPE DeckLinkDeviceDiscovery::Release( void )
 {
-	ULONG		newRefValue;
-
-	newRefValue = InterlockedDecrement( (LONG*)&m_refCount );
+	const ULONG	newRefValue = --m_refCount;
 	if( newRefValue == 0 )
 	{
 		delete this;
@@ -139,15 +138,28 @@ DeckLinkDevice::DeckLinkDevice( DeckLinkDeviceDiscovery * manager, IDeckLink * d
 : mDeviceDiscovery( manager )
 , mDecklink( device )
 , mDecklinkInput( NULL )
-, mSupportsFormatDetection( 0 )
-, mCurrentlyCapturing( false )
-, mNewFrame{ false }
+, mCaptureAllocator( new DeckLinkMemoryAllocator() )
 , mReadSurface{ false }
-, m_refCount{ 1 }
-, mVideoFrame{}
+, mReadFrameCallback{}
+, mCurrentlyCapturing( false )
+, mSupportsFormatDetection( 0 )
+, mFramePool{}
+, mRequestedPoolDepth{ DeckLinkFramePool::DefaultDepth }
+, mConverter{ DeckLinkFrameConverter::Create( DeckLinkConverterSettings{}, manager->GetConverter() ) }
+, mOutputFormat{ DeckLinkPixelConversion::OutputFormat::BGRA8 }
+, mArrivedFrames{ ArrivedFrameQueueCapacity }
+, mProcessingStop{ false }
+, mArrivalDrops{ 0 }
+, mVideoSequence{ 0 }
+, mTraceId{ 0 }
+, mAudioChannels{ 2 }
+, mAudioSampleType{ DeckLinkAudioSampleType::Int16 }
+, mAudioEnabled{ false }
+, mAncillaryEnabled{ false }
+, mCurrentMode{ bmdModeHD1080p2398 }
 , mCurrentSize{ 1920, 1080 }
 , mCurrentFps{ 23.98f }
-, mReadFrameCallback{}
+, m_refCount{ 1 }
 {
 	mDecklink->AddRef();
 
@@ -164,7 +176,8 @@ DeckLinkDevice::DeckLinkDevice( DeckLinkDeviceDiscovery * manager, IDeckLink * d
 	// Get the IDeckLinkInput for the selected device
 	if( mDecklink->QueryInterface( IID_IDeckLinkInput, (void**)&mDecklinkInput ) != S_OK ) {
 		mDecklinkInput = NULL;
-		throw std::exception{ "This application was unable to obtain IDeckLinkInput for the selected device." };
+		UE_LOG( LogDeckLinkMedia, Error, TEXT( "This application was unable to obtain IDeckLinkInput for the selected device." ) );
+		return;
 	}
 
 	// Retrieve and cache mode list
@@ -180,7 +193,7 @@ DeckLinkDevice::DeckLinkDevice( DeckLinkDeviceDiscovery * manager, IDeckLink * d
 
 	mSupportsFormatDetection = false; // assume unsupported until told otherwise
 	if( device->QueryInterface( IID_IDeckLinkAttributes, (void**)&deckLinkAttributes ) == S_OK ) {
-		BOOL support = 0;
+		DeckLinkBool support = false;
 		if( deckLinkAttributes->GetFlag( BMDDeckLinkSupportsInputFormatDetection, &support ) == S_OK )
 			mSupportsFormatDetection = ( support != 0 );
 		deckLinkAttributes->Release();
@@ -204,23 +217,133 @@ void DeckLinkDevice::Cleanup()
 		mDecklink->Release();
 		mDecklink = NULL;
 	}
+
+	if( mCaptureAllocator != NULL ) {
+		mCaptureAllocator->Release();
+		mCaptureAllocator = NULL;
+	}
 }
 
-void DeckLinkDevice::ReadFrameCallback( std::function<void( VideoFrameBGRA * frame )> callback )
+void DeckLinkDevice::ReadFrameCallback( std::function<void( const DeckLinkFrameRef& frame )> callback )
 {
 	mReadFrameCallback = callback;
 }
 
+void DeckLinkDevice::SetFramePoolDepth( uint32_t depth )
+{
+	if( mCurrentlyCapturing ) {
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Cannot change the frame pool depth while capturing." ) );
+		return;
+	}
+
+	mRequestedPoolDepth = depth;
+	ApplyFramePoolDepth();
+}
+
+void DeckLinkDevice::SetFrameQueue( uint32_t depth, DeckLinkQueuePolicy policy )
+{
+	if( mCurrentlyCapturing ) {
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Cannot change the frame queue while capturing." ) );
+		return;
+	}
+
+	mFrameQueue.Configure( depth, policy );
+	ApplyFramePoolDepth();
+}
+
+void DeckLinkDevice::ApplyFramePoolDepth()
+{
+	// every queued frame holds a slot, plus one for the producer and one for the consumer
+	const uint32_t required = mFrameQueue.GetDepth() + 2;
+	if( mRequestedPoolDepth < required ) {
+		UE_LOG( LogDeckLinkMedia, Log, TEXT( "Raising the frame pool depth from %u to %u to cover the frame queue." ), mRequestedPoolDepth, required );
+	}
+
+	if( ! mFramePool.SetDepth( FMath::Max( mRequestedPoolDepth, required ) ) ) {
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Cannot change the frame pool depth while %u frames are still held, keeping %u slots." ), mFramePool.GetSlotsInUse(), mFramePool.GetDepth() );
+	}
+}
+
+void DeckLinkDevice::SetConverter( const DeckLinkConverterSettings& settings )
+{
+	if( mCurrentlyCapturing ) {
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Cannot change the frame converter while capturing." ) );
+		return;
+	}
+
+	mConverter = DeckLinkFrameConverter::Create( settings, mDeviceDiscovery->GetConverter() );
+}
+
+void DeckLinkDevice::SetOutputFormat( DeckLinkPixelConversion::OutputFormat format )
+{
+	if( mCurrentlyCapturing ) {
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Cannot change the output format while capturing." ) );
+		return;
+	}
+
+	mOutputFormat = format;
+}
+
+void DeckLinkDevice::SetAudioInput( uint32_t channels, DeckLinkAudioSampleType sampleType )
+{
+	if( mCurrentlyCapturing ) {
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Cannot change the audio input while capturing." ) );
+		return;
+	}
+
+	if( channels != 0 && channels != 2 && channels != 8 && channels != 16 ) {
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Unsupported audio channel count %u, capturing 2 channels instead." ), channels );
+		channels = 2;
+	}
+
+	mAudioChannels = channels;
+	mAudioSampleType = sampleType;
+}
+
+void DeckLinkDevice::SetAncillaryCapture( bool enabled, const std::vector<DeckLinkAncillaryFilter>& filters, uint32_t firstLine, uint32_t lastLine )
+{
+	if( mCurrentlyCapturing ) {
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Cannot change the ancillary data capture while capturing." ) );
+		return;
+	}
+
+	mAncillaryEnabled = enabled;
+	mAncillaryReader.SetFilters( filters );
+	mAncillaryReader.SetLines( firstLine, lastLine );
+}
+
+void DeckLinkDevice::SetAudioSync( int64_t offset, int64_t tolerance )
+{
+	if( mCurrentlyCapturing ) {
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Cannot change the audio sync while capturing." ) );
+		return;
+	}
+
+	mAvSync.Configure( offset, tolerance );
+}
+
+uint32_t DeckLinkDevice::ReadAudio( void* samples, uint32_t maxSampleFrames, const DeckLinkFrameTimes* videoTimes, int64_t& time )
+{
+	if( ! mAudioEnabled )
+		return 0;
+
+	if( videoTimes != nullptr )
+		return mAvSync.Read( mAudioRing, samples, maxSampleFrames, videoTimes->streamTime, videoTimes->streamDuration, time );
+
+	const uint32_t sampleFrames = mAudioRing.Read( samples, maxSampleFrames, time );
+	time += mAvSync.GetOffset();
+	return sampleFrames;
+}
+
 std::vector<std::string> DeckLinkDevice::GetDisplayModeNames() {
 	std::vector<std::string> modeNames;
 	int modeIndex;
-	BSTR modeName;
+	DeckLinkString modeName;
 
 	for( modeIndex = 0; modeIndex < mModesList.size(); modeIndex++ ) {
 		if( mModesList[modeIndex]->GetName( &modeName ) == S_OK ) {
 			check( modeName != NULL );
-			std::wstring ws( modeName, SysStringLen( modeName ) );
-			modeNames.push_back( ws2s( ws ) );
+			modeNames.push_back( DeckLinkPlatform::TakeString( modeName ) );
 		}
 		else {
 			modeNames.push_back( "Unknown mode" );
@@ -284,6 +407,24 @@ std::string DeckLinkDevice::GetDisplayModeString( BMDDisplayMode mode )
 	}
 }
 
+bool DeckLinkDevice::FindDisplayMode( const std::string& name, BMDDisplayMode& mode )
+{
+	auto equalsIgnoreCase = []( const std::string& a, const std::string& b ) {
+		return a.size() == b.size() && std::equal( a.begin(), a.end(), b.begin(), []( char x, char y ) { return ::tolower( (unsigned char)x ) == ::tolower( (unsigned char)y ); } );
+	};
+
+	size_t count = 0;
+	const DeckLinkVirtualModeInfo* modes = DeckLinkVirtualModeInfo::GetAll( count );
+	for( size_t index = 0; index < count; ++index ) {
+		const std::string modeName = GetDisplayModeString( modes[index].mode );
+		if( equalsIgnoreCase( modeName, name ) || equalsIgnoreCase( modeName, "Mode " + name ) ) {
+			mode = modes[index].mode;
+			return true;
+		}
+	}
+	return false;
+}
+
 FIntPoint DeckLinkDevice::GetDisplayModeBufferSize( BMDDisplayMode mode )
 {
 	for( const auto& decklinkMode : mModesList ) {
@@ -369,27 +510,75 @@ bool DeckLinkDevice::Start( int videoModeIndex ) {
 
 bool DeckLinkDevice::Start( BMDDisplayMode videoMode )
 {
+	if( ! IsValid() ) {
+		UE_LOG( LogDeckLinkMedia, Error, TEXT( "The selected device cannot capture." ) );
+		return false;
+	}
+
 	BMDVideoInputFlags videoInputFlags = bmdVideoInputFlagDefault;
 	if( mSupportsFormatDetection )
 		videoInputFlags |= bmdVideoInputEnableFormatDetection;
 
+	const BMDPixelFormat pixelFormat = GetCapturePixelFormat();
+
+	// Have the driver capture into our aligned, prefaulted buffers
+	const FIntPoint modeSize = GetDisplayModeBufferSize( videoMode );
+	ReserveCaptureBuffers( modeSize, pixelFormat );
+	if( mDecklinkInput->SetVideoInputFrameMemoryAllocator( mCaptureAllocator ) != S_OK ) {
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Unable to install the capture buffer allocator, the driver will allocate its own buffers." ) );
+	}
+
 	// Set the video input mode
-	if( mDecklinkInput->EnableVideoInput( videoMode, bmdFormat8BitYUV, videoInputFlags ) != S_OK ) {
+	if( mDecklinkInput->EnableVideoInput( videoMode, pixelFormat, videoInputFlags ) != S_OK ) {
 		UE_LOG( LogDeckLinkMedia, Error, TEXT( "This application was unable to select the chosen video mode. Perhaps, the selected device is currently in-use." ) );
+		mDecklinkInput->SetVideoInputFrameMemoryAllocator( NULL );
 		return false;
 	}
 
+	// Embedded audio comes with the same callback as the video
+	mAudioEnabled = false;
+	if( mAudioChannels > 0 ) {
+		const BMDAudioSampleType sampleType = ( mAudioSampleType == DeckLinkAudioSampleType::Int16 ) ? bmdAudioSampleType16bitInteger : bmdAudioSampleType32bitInteger;
+		if( mDecklinkInput->EnableAudioInput( bmdAudioSampleRate48kHz, sampleType, mAudioChannels ) == S_OK ) {
+			mAudioRing.Configure( mAudioChannels, AudioSampleRate, mAudioSampleType, AudioBufferMilliseconds );
+			mAvSync.Reset();
+			mAudioEnabled = true;
+		}
+		else {
+			UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Unable to enable %u channel audio input, capturing video only." ), mAudioChannels );
+		}
+	}
+
 	// Start the capture
 	if( mDecklinkInput->StartStreams() != S_OK ) {
 		UE_LOG( LogDeckLinkMedia, Error, TEXT( "This application was unable to start the capture. Perhaps, the selected device is currently in-use." ) );
+
+		// leave the input as it was so another start, or another application, can have it
+		if( mAudioEnabled )
+			mDecklinkInput->DisableAudioInput();
+		mDecklinkInput->DisableVideoInput();
+		mDecklinkInput->SetVideoInputFrameMemoryAllocator( NULL );
+		mAudioEnabled = false;
 		return false;
 	}
 
+	mCurrentMode = videoMode;
+	mCurrentFps = GetDisplayModeBufferFps( videoMode );
+	mCurrentSize = modeSize;
+	mFramePool.Resize( mCurrentSize.X, mCurrentSize.Y, mOutputFormat );
+	if( mAncillaryEnabled ) {
+		mFramePool.ReserveAncillary( DeckLinkAncillaryBuffer::DefaultCapacity );
+		mAncillaryReader.Prepare( mCurrentSize.X );
+	}
+
 	// Set capture callback
+	mVideoSequence = 0;
+	mCaptureStats.Reset();
+	mLatency.Reset();
+	mFrameQueue.Resume();
+	StartProcessing();
 	mDecklinkInput->SetCallback( this );
 
-	mCurrentFps = GetDisplayModeBufferFps( videoMode );
-	mCurrentSize = GetDisplayModeBufferSize( videoMode );
 	mCurrentlyCapturing = true;
 	return true;
 }
@@ -402,101 +591,288 @@ void DeckLinkDevice::Stop()
 	if( mDecklinkInput != NULL ) {
 		mDecklinkInput->StopStreams();
 		mDecklinkInput->SetCallback( NULL );
+		if( mAudioEnabled )
+			mDecklinkInput->DisableAudioInput();
 	}
 
+	// a producer waiting for queue space must give up before it can be joined
+	mFrameQueue.Interrupt();
+	StopProcessing();
+	mFrameQueue.Clear();
+
+	mAudioEnabled = false;
+	mAudioRing.Reset();
+
 	mCurrentlyCapturing = false;
 }
 
-HRESULT DeckLinkDevice::VideoInputFormatChanged(/* in */ BMDVideoInputFormatChangedEvents notificationEvents, /* in */ IDeckLinkDisplayMode *newMode, /* in */ BMDDetectedVideoInputFormatFlags detectedSignalFlags ) {
+BMDPixelFormat DeckLinkDevice::GetCapturePixelFormat() const
+{
+	// Deeper outputs and ancillary data need the 10-bit signal
+	const bool captureV210 = ( mOutputFormat != DeckLinkPixelConversion::OutputFormat::BGRA8 ) || mAncillaryEnabled;
+	return captureV210 ? bmdFormat10BitYUV : bmdFormat8BitYUV;
+}
 
-	QUICK_SCOPE_CYCLE_COUNTER( STAT_DeckLinkDevice_VideoInputFormatChanged );
+void DeckLinkDevice::ReserveCaptureBuffers( const FIntPoint& size, BMDPixelFormat pixelFormat )
+{
+	const long inputRowBytes = ( pixelFormat == bmdFormat8BitYUV ) ? size.X * 2 : DeckLinkPixelConversion::GetV210RowBytes( size.X );
+	mCaptureAllocator->Reserve( CaptureBufferReserve, inputRowBytes * size.Y );
+}
+
+HRESULT DeckLinkDevice::VideoInputFormatChanged(/* in */ BMDVideoInputFormatChangedEvents notificationEvents, /* in */ IDeckLinkDisplayMode *newMode, /* in */ BMDDetectedVideoInputFormatFlags detectedSignalFlags ) {
 
-	unsigned int	modeIndex = 0;
-	BMDPixelFormat	pixelFormat = bmdFormat10BitYUV;
+	SCOPE_CYCLE_COUNTER( STAT_DeckLinkMedia_FormatChanged );
 
 	// Restart capture with the new video mode if told to
 	if( ! mSupportsFormatDetection )
 		return S_OK;
 
-	if( detectedSignalFlags & bmdDetectedVideoInputRGB444 )
-		pixelFormat = bmdFormat10BitRGB;
+	// the converters only take YUV, so an RGB signal is captured the way Start would capture it
+	const BMDPixelFormat pixelFormat = GetCapturePixelFormat();
+	const FIntPoint modeSize( newMode->GetWidth(), newMode->GetHeight() );
 
 	// Stop the capture
 	mDecklinkInput->StopStreams();
 
-	// Set the video input mode
+	// and the processing thread, so nothing reads the buffers resized below; frames of the old mode still queued are dropped
+	mFrameQueue.Interrupt();
+	StopProcessing();
+	mFrameQueue.Resume();
+
+	// Set the video input mode, with capture buffers of the new size ready
+	ReserveCaptureBuffers( modeSize, pixelFormat );
 	if( mDecklinkInput->EnableVideoInput( newMode->GetDisplayMode(), pixelFormat, bmdVideoInputEnableFormatDetection ) != S_OK )
 	{
 		// Let the UI know we couldnt restart the capture with the detected input mode
 		UE_LOG( LogDeckLinkMedia, Error, TEXT( "This application was unable to select the new video mode." ) );
+
+		// the device still counts as capturing until Stop, which expects the processing thread running
+		StartProcessing();
 		return S_OK;
 	}
 
+	mCurrentMode = newMode->GetDisplayMode();
+	mCurrentFps = GetDisplayModeBufferFps( newMode->GetDisplayMode() );
+	mCurrentSize = modeSize;
+	mFramePool.Resize( mCurrentSize.X, mCurrentSize.Y, mOutputFormat );
+	if( mAncillaryEnabled ) {
+		mFramePool.ReserveAncillary( DeckLinkAncillaryBuffer::DefaultCapacity );
+		mAncillaryReader.Prepare( mCurrentSize.X );
+	}
+	StartProcessing();
+
 	// Start the capture
 	if( mDecklinkInput->StartStreams() != S_OK )
 	{
 		// Let the UI know we couldnt restart the capture with the detected input mode
 		UE_LOG( LogDeckLinkMedia, Error, TEXT( "This application was unable to start the capture on the selected device." ) );
+	}
+	return S_OK;
+}
+
+HRESULT DeckLinkDevice::VideoInputFrameArrived( IDeckLinkVideoInputFrame* frame, IDeckLinkAudioInputPacket* audioPacket )
+{
+	SCOPE_CYCLE_COUNTER( STAT_DeckLinkMedia_FrameArrived );
+
+	const bool hasVideo = ( frame != NULL ) && ( ( frame->GetFlags() & bmdFrameHasNoInputSource ) == 0 );
+	const bool hasAudio = ( audioPacket != NULL ) && mAudioEnabled;
+	if( hasVideo ) {
+		BMDTimeValue streamTime = 0, streamDuration = 0;
+		frame->GetStreamTime( &streamTime, &streamDuration, DeckLinkFrameTimes::TimeScale );
+		mCaptureStats.FrameArrived( streamTime, streamDuration );
+
+		BMDTimeValue frameTime = 0, frameDuration = 0;
+		int64_t hardwareNow = 0;
+		if( frame->GetHardwareReferenceTimestamp( DeckLinkFrameTimes::TimeScale, &frameTime, &frameDuration ) == S_OK && GetHardwareReferenceTime( hardwareNow ) )
+			mLatency.Record( DeckLinkLatencyStage::Arrival, ( hardwareNow - frameTime ) / ( DeckLinkFrameTimes::TimeScale / 1000000 ) );
+	}
+	else if( frame != NULL ) {
+		mCaptureStats.NoSignalFrameArrived();
+	}
+	if( ! hasVideo && ! hasAudio )
+		return ( frame == NULL ) ? S_OK : S_FALSE;
+
+	// numbered before anything can drop it, so the player sees the gap
+	ArrivedFrame arrived( hasVideo ? frame : NULL, hasAudio ? audioPacket : NULL, hasVideo ? mVideoSequence++ : 0 );
+	if( hasVideo )
+		DeckLinkTrace::Record( DeckLinkTraceEvent::Arrive, mTraceId, arrived.sequence );
+	if( arrived.video )
+		arrived.video->AddRef();
+	if( arrived.audio )
+		arrived.audio->AddRef();
+
+	if( ! mArrivedFrames.Push( arrived ) ) {
+		// the processing thread is behind, let the driver have its buffers back
+		ReleaseArrivedFrame( arrived );
+		++mArrivalDrops;
 		return S_OK;
 	}
 
-	mCurrentFps = GetDisplayModeBufferFps( newMode->GetDisplayMode() );
-	mCurrentSize = FIntPoint( newMode->GetWidth(), newMode->GetHeight() );
+	{
+		std::lock_guard<std::mutex> lock( mProcessingMutex );
+	}
+	mProcessingCondition.notify_one();
 	return S_OK;
 }
 
-HRESULT DeckLinkDevice::VideoInputFrameArrived( IDeckLinkVideoInputFrame* frame, IDeckLinkAudioInputPacket* audioPacket )
+void DeckLinkDevice::ReleaseArrivedFrame( ArrivedFrame& arrived )
 {
-	QUICK_SCOPE_CYCLE_COUNTER( STAT_DeckLinkDevice_VideoInputFrameArrived );
+	if( arrived.video ) {
+		arrived.video->Release();
+		arrived.video = NULL;
+	}
+	if( arrived.audio ) {
+		arrived.audio->Release();
+		arrived.audio = NULL;
+	}
+}
 
-	if( frame == NULL )
-		return S_OK;
+void DeckLinkDevice::StartProcessing()
+{
+	if( mProcessingThread.joinable() )
+		return;
 
-	if( ( frame->GetFlags() & bmdFrameHasNoInputSource ) == 0 ) {
+	mProcessingStop = false;
+	mProcessingThread = std::thread( &DeckLinkDevice::ProcessingLoop, this );
+}
 
-		std::lock_guard<std::mutex> lock( mMutex );
+void DeckLinkDevice::StopProcessing()
+{
+	if( ! mProcessingThread.joinable() )
+		return;
 
-		// Get the various timecodes and userbits for this frame
-		//GetAncillaryDataFromFrame( frame, bmdTimecodeVITC, mTimecode.vitcF1Timecode, mTimecode.vitcF1UserBits );
-		//GetAncillaryDataFromFrame( frame, bmdTimecodeVITCField2, mTimecode.vitcF2Timecode, mTimecode.vitcF2UserBits );
-		//GetAncillaryDataFromFrame( frame, bmdTimecodeRP188VITC1, mTimecode.rp188vitc1Timecode, mTimecode.rp188vitc1UserBits );
-		//GetAncillaryDataFromFrame( frame, bmdTimecodeRP188LTC, mTimecode.rp188ltcTimecode, mTimecode.rp188ltcUserBits );
-		//GetAncillaryDataFromFrame( frame, bmdTimecodeRP188VITC2, mTimecode.rp188vitc2Timecode, mTimecode.rp188vitc2UserBits );
-
-		mVideoFrame = VideoFrameBGRA{ frame->GetWidth(), frame->GetHeight() };
-		mDeviceDiscovery->GetConverter()->ConvertFrame( frame, &mVideoFrame );
-		if( mReadFrameCallback ) {
-			mReadFrameCallback( &mVideoFrame );
-		}
-		mNewFrame = true;
-		return S_OK;
+	{
+		std::lock_guard<std::mutex> lock( mProcessingMutex );
+		mProcessingStop = true;
+	}
+	mProcessingCondition.notify_one();
+	mProcessingThread.join();
+
+	// hand back whatever the driver queued after the thread stopped
+	ArrivedFrame arrived;
+	while( mArrivedFrames.Pop( arrived ) ) {
+		ReleaseArrivedFrame( arrived );
 	}
-	return S_FALSE;
 }
 
-void DeckLinkDevice::GetAncillaryDataFromFrame( IDeckLinkVideoInputFrame* videoFrame, BMDTimecodeFormat timecodeFormat, std::string& timecodeString, std::string& userBitsString ) {
-	IDeckLinkTimecode* timecode = NULL;
-	BSTR timecodeCFString;
-	BMDTimecodeUserBits userBits = 0;
+void DeckLinkDevice::ProcessingLoop()
+{
+	for( ;; ) {
+		{
+			std::unique_lock<std::mutex> lock( mProcessingMutex );
+			mProcessingCondition.wait( lock, [this]() { return mProcessingStop || ! mArrivedFrames.IsEmpty(); } );
+			if( mProcessingStop )
+				return;
+		}
 
-	if( (videoFrame != NULL)
-		&& (videoFrame->GetTimecode( timecodeFormat, &timecode ) == S_OK) ) {
-		if( timecode->GetString( &timecodeCFString ) == S_OK ) {
-			check( timecodeCFString != NULL );
-			timecodeString = ws2s( std::wstring( timecodeCFString, SysStringLen( timecodeCFString ) ) );
+		ArrivedFrame arrived;
+		while( mArrivedFrames.Pop( arrived ) ) {
+			// audio first, it is cheap and the player may be waiting for it
+			if( arrived.audio )
+				ProcessAudio( arrived.audio );
+			if( arrived.video )
+				ProcessFrame( arrived.video, arrived.sequence, arrived.arrivalTime );
+			ReleaseArrivedFrame( arrived );
 		}
-		else {
-			timecodeString = "";
+	}
+}
+
+void DeckLinkDevice::ProcessAudio( IDeckLinkAudioInputPacket* packet )
+{
+	SCOPE_CYCLE_COUNTER( STAT_DeckLinkMedia_ProcessAudio );
+
+	void* samples = NULL;
+	const long sampleFrames = packet->GetSampleFrameCount();
+	if( sampleFrames <= 0 || packet->GetBytes( &samples ) != S_OK || samples == NULL )
+		return;
+
+	BMDTimeValue packetTime = 0;
+	packet->GetPacketTime( &packetTime, DeckLinkAudioRing::TimeScale );
+
+	mAudioRing.Write( samples, static_cast<uint32_t>( sampleFrames ), packetTime );
+}
+
+void DeckLinkDevice::ProcessFrame( IDeckLinkVideoInputFrame* frame, uint64_t sequence, int64_t arrivalTime )
+{
+	SCOPE_CYCLE_COUNTER( STAT_DeckLinkMedia_ProcessFrame );
+
+	DeckLinkFrameRef videoFrame = mFramePool.Acquire( frame->GetWidth(), frame->GetHeight() );
+	if( ! videoFrame.IsValid() ) {
+		// every slot is still held, drop this frame rather than allocate
+		mCaptureStats.PoolExhausted();
+		return;
+	}
+
+	DeckLinkStageTimes stageTimes;
+	stageTimes.arrival = arrivalTime;
+	stageTimes.conversionStart = DeckLinkLatency::Now();
+	DeckLinkTrace::Record( DeckLinkTraceEvent::ConvertBegin, mTraceId, sequence );
+	{
+		SCOPE_CYCLE_COUNTER( STAT_DeckLinkMedia_ConvertFrame );
+		const HRESULT converted = mConverter->Convert( frame, videoFrame.GetReference() );
+		DeckLinkTrace::Record( DeckLinkTraceEvent::ConvertEnd, mTraceId, sequence );
+		if( converted != S_OK ) {
+			mCaptureStats.ConversionFailed();
+			return;
 		}
+	}
+	stageTimes.conversionEnd = DeckLinkLatency::Now();
+
+	BMDTimeValue streamTime = 0, streamDuration = 0, hardwareTime = 0, hardwareDuration = 0;
+	frame->GetStreamTime( &streamTime, &streamDuration, DeckLinkFrameTimes::TimeScale );
+	frame->GetHardwareReferenceTimestamp( DeckLinkFrameTimes::TimeScale, &hardwareTime, &hardwareDuration );
 
-		timecode->GetTimecodeUserBits( &userBits );
-		userBitsString = "0x" + userBits ;
-		timecode->Release();
+	DeckLinkFrameTimes times;
+	times.streamTime = streamTime;
+	times.streamDuration = streamDuration;
+	times.hardwareTime = hardwareTime;
+	times.hardwareDuration = hardwareDuration;
+	times.sequence = sequence;
+	videoFrame->SetTimes( times );
+
+	// Get the various timecodes and userbits for this frame, kept packed until someone formats them
+	const DeckLinkTimecodes timecodes = DeckLinkTimecodes::Read( frame );
+	videoFrame->SetTimecodes( timecodes );
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mTimecode = timecodes;
+	}
+
+	if( mAncillaryEnabled ) {
+		SCOPE_CYCLE_COUNTER( STAT_DeckLinkMedia_ReadAncillary );
+		mAncillaryReader.Read( frame, videoFrame->GetAncillaryPackets() );
 	}
 	else {
-		timecodeString = "";
-		userBitsString = "";
+		videoFrame->GetAncillaryPackets().Clear();
 	}
+
+	if( mReadFrameCallback ) {
+		mReadFrameCallback( videoFrame );
+	}
+
+	stageTimes.queued = DeckLinkLatency::Now();
+	videoFrame->SetStageTimes( stageTimes );
+	mCaptureStats.FrameCaptured( stageTimes.conversionEnd - stageTimes.conversionStart, stageTimes.queued - stageTimes.arrival );
+	mLatency.Record( DeckLinkLatencyStage::Dispatch, stageTimes.arrival, stageTimes.conversionStart );
+	mLatency.Record( DeckLinkLatencyStage::Conversion, stageTimes.conversionStart, stageTimes.conversionEnd );
+
+	DeckLinkTrace::Record( DeckLinkTraceEvent::Enqueue, mTraceId, sequence );
+	mFrameQueue.Push( videoFrame );
+}
+
+bool DeckLinkDevice::GetHardwareReferenceTime( int64_t& time ) const
+{
+	if( mDecklinkInput == NULL )
+		return false;
+
+	BMDTimeValue hardwareTime = 0;
+	BMDTimeValue timeInFrame = 0;
+	BMDTimeValue ticksPerFrame = 0;
+	if( mDecklinkInput->GetHardwareReferenceClock( DeckLinkFrameTimes::TimeScale, &hardwareTime, &timeInFrame, &ticksPerFrame ) != S_OK )
+		return false;
+
+	time = hardwareTime;
+	return true;
 }
 
 DeckLinkDevice::Timecodes DeckLinkDevice::GetTimecode() const
@@ -505,20 +881,13 @@ DeckLinkDevice::Timecodes DeckLinkDevice::GetTimecode() const
 	return mTimecode;
 }
 
-bool DeckLinkDevice::GetFrame( VideoFrameBGRA* frame, Timecodes * timecodes )
+DeckLinkFrameRef DeckLinkDevice::GetFrame( Timecodes * timecodes )
 {
-	if( ! mNewFrame )
-		return false;
-
-	mNewFrame = false;
+	DeckLinkFrameRef frame = mFrameQueue.Pop();
+	if( frame.IsValid() && timecodes )
+		*timecodes = frame->GetTimecodes();
 
-	std::lock_guard<std::mutex> lock( mMutex );
-	*frame = mVideoFrame;
-	
-	if( timecodes )
-		*timecodes = mTimecode;
-
-	return true;
+	return frame;
 }
 
 HRESULT	STDMETHODCALLTYPE DeckLinkDevice::QueryInterface( REFIID iid, LPVOID *ppv )
@@ -556,14 +925,12 @@ HRESULT	STDMETHODCALLTYPE DeckLinkDevice::QueryInterface( REFIID iid, LPVOID *pp
 
 ULONG STDMETHODCALLTYPE DeckLinkDevice::AddRef( void )
 {
-	return InterlockedIncrement( (LONG*)&m_refCount );
+	return ++m_refCount;
 }
 
 ULONG STDMETHODCALLTYPE DeckLinkDevice::Release( void )
 {
-	int		newRefValue;
-
-	newRefValue = InterlockedDecrement( (LONG*)&m_refCount );
+	const ULONG	newRefValue = --m_refCount;
 	if( newRefValue == 0 )
 	{
 		delete this;
@@ -573,5 +940,6 @@ ULONG STDMETHODCALLTYPE DeckLinkDevice::Release( void )
 	return newRefValue;
 }
 
-#include "Runtime/Core/Public/Windows/HideWindowsPlatformAtomics.h"
+#if PLATFORM_WINDOWS
 #include "Runtime/Core/Public/Windows/HideWindowsPlatformTypes.h"
+#endif
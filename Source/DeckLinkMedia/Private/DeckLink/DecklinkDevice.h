@@ -30,12 +30,26 @@
 
 #pragma once
 
-#include "DeckLinkAPI_h.h"
+#include "DeckLinkPlatform.h"
+#include "DeckLinkFramePool.h"
+#include "DeckLinkFrameConverter.h"
+#include "DeckLinkFrameQueue.h"
+#include "DeckLinkMemoryAllocator.h"
+#include "DeckLinkAudioRing.h"
+#include "DeckLinkAvSync.h"
+#include "DeckLinkAncillary.h"
+#include "DeckLinkSpscQueue.h"
+#include "DeckLinkCaptureStats.h"
+#include "DeckLinkLatency.h"
+#include "DeckLinkTrace.h"
+#include "DeckLinkTestPattern.h"
 #include "CoreMinimal.h"
 
 #include <vector>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <functional>
 
 class DeckLinkDeviceDiscovery : public IDeckLinkDeviceNotificationCallback
@@ -49,6 +63,9 @@ public:
 
 	std::string										GetDeviceName( IDeckLink* device );
 
+	/** Announces a DeckLinkVirtualDevice through the device callback, as if a card with that sub-device index arrived. */
+	void											AddVirtualDevice( size_t index, DeckLinkTestPattern::Pattern pattern );
+
 	// IDeckLinkDeviceNotificationCallback interface
 	virtual HRESULT	STDMETHODCALLTYPE	DeckLinkDeviceArrived(/* in */ IDeckLink* deckLink );
 	virtual HRESULT	STDMETHODCALLTYPE	DeckLinkDeviceRemoved(/* in */ IDeckLink* deckLink );
@@ -60,7 +77,7 @@ public:
 
 private:
 	IDeckLinkDiscovery*					m_deckLinkDiscovery;
-	ULONG								m_refCount;
+	std::atomic<ULONG>					m_refCount;
 
 	IDeckLinkVideoConversion*	GetConverter() { return mVideoConverter; }
 	IDeckLinkVideoConversion*	mVideoConverter;
@@ -73,67 +90,28 @@ private:
 
 class DeckLinkDevice : private IDeckLinkInputCallback {
 public:
-	class VideoFrameBGRA : public IDeckLinkVideoFrame {
-	public:
-
-		VideoFrameBGRA() : mWidth{ 0 }, mHeight{ 0 } { }
-
-		VideoFrameBGRA( long width, long height )
-			: mWidth{ width }, mHeight{ height }
-		{
-			mData.resize( height * width * 4 );
-		}
-
-		uint8_t * data() const { return (uint8_t*)mData.data(); }
-
-		//override these methods for virtual
-		virtual long			GetWidth( void ) { return mWidth; }
-		virtual long			GetHeight( void ) { return mHeight; }
-		virtual long			GetRowBytes( void ) { return mWidth * 4; }
-		virtual BMDPixelFormat	GetPixelFormat( void ) { return bmdFormat8BitBGRA; }
-		virtual BMDFrameFlags	GetFlags( void ) { return 0; }
-		virtual HRESULT			GetBytes( void **buffer )
-		{
-			*buffer = (void*)mData.data();
-			return S_OK;
-		}
-
-		virtual HRESULT			GetTimecode( BMDTimecodeFormat format, IDeckLinkTimecode **timecode ) { return E_NOINTERFACE; };
-		virtual HRESULT			GetAncillaryData( IDeckLinkVideoFrameAncillary **ancillary ) { return E_NOINTERFACE; };
-		virtual HRESULT			QueryInterface( REFIID iid, LPVOID *ppv ) { return E_NOINTERFACE; }
-		virtual ULONG			AddRef() { return 1; }
-		virtual ULONG			Release() { return 1; }
-	private:
-		long mWidth, mHeight;
-		std::vector<uint8_t> mData;
-	};
-
-	typedef struct {
-		// VITC timecodes and user bits for field 1 & 2
-		std::string vitcF1Timecode;
-		std::string vitcF1UserBits;
-		std::string vitcF2Timecode;
-		std::string vitcF2UserBits;
-
-		// RP188 timecodes and user bits (VITC1, VITC2 and LTC)
-		std::string rp188vitc1Timecode;
-		std::string rp188vitc1UserBits;
-		std::string rp188vitc2Timecode;
-		std::string rp188vitc2UserBits;
-		std::string rp188ltcTimecode;
-		std::string rp188ltcUserBits;
-	} Timecodes;
+	typedef DeckLinkTimecodes Timecodes;
 
 	DeckLinkDevice( DeckLinkDeviceDiscovery * manager, IDeckLink * device );
 	virtual ~DeckLinkDevice();
 
+	/** False if the card has no input interface; such a device cannot capture. */
+	bool						IsValid() const { return mDecklinkInput != NULL; }
+
 	FIntPoint					GetCurrentSize() const { return mCurrentSize; }
 	float						GetCurrentFps() const { return mCurrentFps; }
+	BMDDisplayMode				GetCurrentDisplayMode() const { return mCurrentMode; }
+
+	/** Identifies the device's events in DeckLinkTrace. */
+	void						SetTraceId( uint32_t id ) { mTraceId = id; }
+	uint32_t					GetTraceId() const { return mTraceId; }
 	std::vector<std::string>	GetDisplayModeNames();
 
 	FIntPoint					GetDisplayModeBufferSize( BMDDisplayMode mode );
 	static float				GetDisplayModeBufferFps( BMDDisplayMode mode );
 	static std::string			GetDisplayModeString( BMDDisplayMode mode );
+	/** Looks a mode up by its GetDisplayModeString name, with or without the "Mode " prefix and ignoring case. */
+	static bool					FindDisplayMode( const std::string& name, BMDDisplayMode& mode );
 
 	bool						IsFormatDetectionEnabled();
 	bool						IsCapturing();
@@ -143,12 +121,110 @@ public:
 	void						Stop();
 	void						Cleanup();
 
-	void						ReadFrameCallback( std::function<void( VideoFrameBGRA * frame )> callback );
+	void						ReadFrameCallback( std::function<void( const DeckLinkFrameRef& frame )> callback );
 
+	/** Timecodes of the most recently processed frame. */
 	Timecodes					GetTimecode() const;
-	bool						GetFrame( VideoFrameBGRA* frame, Timecodes * timecodes = nullptr );
+	/**
+	 * Takes the next frame from the capture queue, if there is one. Under the
+	 * LatestOnly policy this is the most recently captured frame.
+	 *
+	 * The returned handle is read-only and keeps its pool slot alive until it
+	 * is released. Never blocks the capture callback.
+	 */
+	DeckLinkFrameRef			GetFrame( Timecodes * timecodes = nullptr );
+
+	void						SetFramePoolDepth( uint32_t depth );
+
+	/** Sets how many converted frames may wait for GetFrame and what happens when that queue is full. */
+	void						SetFrameQueue( uint32_t depth, DeckLinkQueuePolicy policy );
+	const DeckLinkFrameQueue&	GetFrameQueue() const { return mFrameQueue; }
+	const DeckLinkMemoryAllocator&	GetCaptureAllocator() const { return *mCaptureAllocator; }
+	void						SetConverter( const DeckLinkConverterSettings& settings );
+
+	/**
+	 * Selects the layout of frames handed out by GetFrame. BGRA8 is captured
+	 * as 8-bit YUV; the 10 and 16-bit layouts capture v210 so no precision is
+	 * lost on the way.
+	 */
+	void						SetOutputFormat( DeckLinkPixelConversion::OutputFormat format );
+	DeckLinkPixelConversion::OutputFormat	GetOutputFormat() const { return mOutputFormat; }
+	std::string					GetConverterDescription() const { return mConverter->GetDescription(); }
+	const DeckLinkFramePool&	GetFramePool() const { return mFramePool; }
+
+	/** Current time of the card's hardware reference clock, in DeckLinkFrameTimes::TimeScale units. Returns false if unavailable. */
+	bool						GetHardwareReferenceTime( int64_t& time ) const;
+
+	/**
+	 * Selects the embedded audio to capture at 48kHz: 2, 8 or 16 channels,
+	 * or 0 to capture no audio.
+	 */
+	void						SetAudioInput( uint32_t channels, DeckLinkAudioSampleType sampleType );
+	bool						IsAudioEnabled() const { return mAudioEnabled; }
+	uint32_t					GetAudioChannels() const { return mAudioEnabled ? mAudioRing.GetChannels() : 0; }
+	uint32_t					GetAudioSampleRate() const { return mAudioEnabled ? mAudioRing.GetSampleRate() : 0; }
+
+	/**
+	 * Sets how much later than its video the audio is presented and how far
+	 * it may trail the video before samples are dropped to resync, both in
+	 * DeckLinkFrameTimes::TimeScale units.
+	 */
+	void						SetAudioSync( int64_t offset, int64_t tolerance );
+	const DeckLinkAvSync&		GetAudioSync() const { return mAvSync; }
+
+	/**
+	 * Reads captured audio; the player is the only reader. With videoTimes
+	 * this is the audio that belongs with that frame, without it whatever has
+	 * arrived. time receives the first sample's time on the video timeline.
+	 */
+	uint32_t					ReadAudio( void* samples, uint32_t maxSampleFrames, const DeckLinkFrameTimes* videoTimes, int64_t& time );
+	const DeckLinkAudioRing&	GetAudioRing() const { return mAudioRing; }
+
+	/**
+	 * Enables reading ancillary packets from the given blanking lines into
+	 * every captured frame, keeping only packets that match one of the
+	 * filters (all packets if there are none). Capture switches to 10-bit
+	 * while this is on, since 8-bit lines cannot carry ancillary data intact.
+	 */
+	void						SetAncillaryCapture( bool enabled, const std::vector<DeckLinkAncillaryFilter>& filters, uint32_t firstLine, uint32_t lastLine );
+	bool						IsAncillaryCaptureEnabled() const { return mAncillaryEnabled; }
+	const DeckLinkAncillaryReader&	GetAncillaryReader() const { return mAncillaryReader; }
+
+	/** Frames the driver delivered while the processing thread was still busy with earlier ones. */
+	uint64_t					GetArrivalDropCount() const { return mArrivalDrops; }
+
+	/** Frame counters and conversion timings since capture started. */
+	const DeckLinkCaptureStats&	GetCaptureStats() const { return mCaptureStats; }
+
+	/** Per stage latency histograms since capture started; the player records the stages after the queue. */
+	const DeckLinkLatency&		GetLatency() const { return mLatency; }
+	DeckLinkLatency&			GetLatency() { return mLatency; }
 private:
-	void						GetAncillaryDataFromFrame( IDeckLinkVideoInputFrame* frame, BMDTimecodeFormat format, std::string& timecodeString, std::string& userBitsString );
+	/** A video frame and/or audio packet from one driver callback, either may be NULL. */
+	struct ArrivedFrame {
+		ArrivedFrame() : video{ NULL }, audio{ NULL }, sequence{ 0 } { }
+		ArrivedFrame( IDeckLinkVideoInputFrame* inVideo, IDeckLinkAudioInputPacket* inAudio, uint64_t inSequence ) : video{ inVideo }, audio{ inAudio }, sequence{ inSequence }, arrivalTime{ DeckLinkLatency::Now() } { }
+
+		IDeckLinkVideoInputFrame*	video;
+		IDeckLinkAudioInputPacket*	audio;
+		uint64_t					sequence;
+		/** DeckLinkLatency::Now when the driver called back. */
+		int64_t						arrivalTime;
+	};
+
+	void						ApplyFramePoolDepth();
+
+	/** Pixel format the driver is asked for: v210 when the output or ancillary capture needs 10 bits, UYVY otherwise. */
+	BMDPixelFormat				GetCapturePixelFormat() const;
+	/** Prefaults the capture allocator's buffers for frames of the given size and pixel format. */
+	void						ReserveCaptureBuffers( const FIntPoint& size, BMDPixelFormat pixelFormat );
+
+	void						StartProcessing();
+	void						StopProcessing();
+	void						ProcessingLoop();
+	void						ProcessFrame( IDeckLinkVideoInputFrame* frame, uint64_t sequence, int64_t arrivalTime );
+	void						ProcessAudio( IDeckLinkAudioInputPacket* packet );
+	static void					ReleaseArrivedFrame( ArrivedFrame& arrived );
 
 	virtual HRESULT				VideoInputFormatChanged( BMDVideoInputFormatChangedEvents notificationEvents, IDeckLinkDisplayMode *newDisplayMode, BMDDetectedVideoInputFormatFlags detectedSignalFlags ) override;
 	virtual HRESULT				VideoInputFrameArrived( IDeckLinkVideoInputFrame* frame, IDeckLinkAudioInputPacket* audioPacket ) override;
@@ -162,19 +238,56 @@ private:
 	IDeckLinkInput *					mDecklinkInput;
 	std::vector<IDeckLinkDisplayMode*>	mModesList;
 
+	// capture buffers the driver DMAs into, enough for the arrival queue plus what the driver holds
+	static const uint32_t				CaptureBufferReserve = 8;
+	DeckLinkMemoryAllocator*			mCaptureAllocator;
+
 	mutable std::mutex									mMutex;
-	std::atomic_bool									mNewFrame;
 	std::atomic_bool									mReadSurface;
-	std::function<void( VideoFrameBGRA * frame )>		mReadFrameCallback;
+	std::function<void( const DeckLinkFrameRef& frame )>	mReadFrameCallback;
 
 	std::atomic_bool					mCurrentlyCapturing;
 	bool								mSupportsFormatDetection;
 	
-	VideoFrameBGRA						mVideoFrame;
+	DeckLinkFramePool					mFramePool;
+	uint32_t							mRequestedPoolDepth;
+	std::unique_ptr<DeckLinkFrameConverter>	mConverter;
+	DeckLinkPixelConversion::OutputFormat	mOutputFormat;
+
+	DeckLinkFrameQueue					mFrameQueue;
+
+	// The driver callback only AddRefs the frame and audio packet and queues
+	// them here; the processing thread converts them, so slow work never
+	// delays the card.
+	static const uint32_t				ArrivedFrameQueueCapacity = 4;
+	DeckLinkSpscQueue<ArrivedFrame>		mArrivedFrames;
+	std::thread							mProcessingThread;
+	std::mutex							mProcessingMutex;
+	std::condition_variable				mProcessingCondition;
+	std::atomic_bool					mProcessingStop;
+	std::atomic<uint64_t>				mArrivalDrops;
+	// only touched by the driver callback, reset by Start
+	uint64_t							mVideoSequence;
+	DeckLinkCaptureStats				mCaptureStats;
+	DeckLinkLatency						mLatency;
+	uint32_t							mTraceId;
+
+	static const uint32_t				AudioSampleRate = 48000;
+	static const uint32_t				AudioBufferMilliseconds = 1000;
+	uint32_t							mAudioChannels;
+	DeckLinkAudioSampleType				mAudioSampleType;
+	std::atomic_bool					mAudioEnabled;
+	DeckLinkAudioRing					mAudioRing;
+	DeckLinkAvSync						mAvSync;
+
+	bool								mAncillaryEnabled;
+	DeckLinkAncillaryReader				mAncillaryReader;
+
+	BMDDisplayMode						mCurrentMode;
 	FIntPoint							mCurrentSize;
 	float								mCurrentFps;
 
 	Timecodes							mTimecode;
 
-	ULONG								m_refCount;
+	std::atomic<ULONG>					m_refCount;
 };
@@ -0,0 +1,295 @@
+// Copyright 2017 The Mill, Inc. All Rights Reserved.
+
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkMediaBenchmarkCommandlet.h"
+#include "DeckLinkMediaPipelineBenchmark.h"
+
+#include "HAL/PlatformMisc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Paths.h"
+
+#include "DeckLink/DecklinkDevice.h"
+#include "DeckLink/DeckLinkAudioBenchmark.h"
+#include "DeckLink/DeckLinkConversionBenchmark.h"
+
+
+namespace DeckLinkMediaBenchmark
+{
+	/** Splits a comma separated option value, empty if the option is not given. */
+	TArray<FString> ParseList( const FString& Params, const TCHAR* Option )
+	{
+		TArray<FString> Items;
+		FString Value;
+		if( FParse::Value( *Params, Option, Value, false ) )
+		{
+			Value.ParseIntoArray( Items, TEXT( "," ), true );
+		}
+		return Items;
+	}
+
+	/** Reads -ISA=Scalar,SSE41,AVX2|All, returns false if the option is not given. */
+	bool ParseInstructionSets( const FString& Params, std::vector<DeckLinkPixelConversion::InstructionSet>& OutInstructionSets )
+	{
+		const TArray<FString> Names = ParseList( Params, TEXT( "ISA=" ) );
+		if( Names.Num() == 0 )
+		{
+			return false;
+		}
+
+		OutInstructionSets.clear();
+		const DeckLinkPixelConversion::InstructionSet All[] = { DeckLinkPixelConversion::InstructionSet::Scalar, DeckLinkPixelConversion::InstructionSet::SSE41, DeckLinkPixelConversion::InstructionSet::AVX2 };
+		for( DeckLinkPixelConversion::InstructionSet Isa : All )
+		{
+			const FString IsaName = FString( UTF8_TO_TCHAR( DeckLinkPixelConversion::GetInstructionSetName( Isa ) ) ).Replace( TEXT( "." ), TEXT( "" ) );
+			if( Names.Contains( TEXT( "All" ) ) || Names.Contains( IsaName ) )
+			{
+				OutInstructionSets.push_back( Isa );
+			}
+		}
+		return true;
+	}
+
+	bool WriteResults( const FString& Path, const FString& Text )
+	{
+		if( ! FFileHelper::SaveStringToFile( Text, *Path ) )
+		{
+			UE_LOG( LogDeckLinkMedia, Error, TEXT( "Unable to write benchmark results to %s." ), *Path );
+			return false;
+		}
+
+		UE_LOG( LogDeckLinkMedia, Display, TEXT( "Wrote benchmark results to %s." ), *Path );
+		return true;
+	}
+}
+
+
+/* UDeckLinkMediaBenchmarkCommandlet structors
+ *****************************************************************************/
+
+UDeckLinkMediaBenchmarkCommandlet::UDeckLinkMediaBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+
+/* UCommandlet interface
+ *****************************************************************************/
+
+int32 UDeckLinkMediaBenchmarkCommandlet::Main( const FString& Params )
+{
+	if( FParse::Param( *Params, TEXT( "Pipeline" ) ) )
+	{
+		return RunPipelineBenchmark( Params );
+	}
+	if( FParse::Param( *Params, TEXT( "VerifyAudio" ) ) )
+	{
+		return VerifyAudio();
+	}
+	if( FParse::Param( *Params, TEXT( "Audio" ) ) )
+	{
+		return RunAudioBenchmark( Params );
+	}
+	return RunConversionBenchmark( Params );
+}
+
+
+/* UDeckLinkMediaBenchmarkCommandlet implementation
+ *****************************************************************************/
+
+int32 UDeckLinkMediaBenchmarkCommandlet::RunConversionBenchmark( const FString& Params )
+{
+	using namespace DeckLinkMediaBenchmark;
+
+	DeckLinkConversionBenchmarkSettings Settings;
+
+	for( const FString& Name : ParseList( Params, TEXT( "Modes=" ) ) )
+	{
+		BMDDisplayMode Mode;
+		if( ! DeckLinkDevice::FindDisplayMode( TCHAR_TO_UTF8( *Name ), Mode ) )
+		{
+			UE_LOG( LogDeckLinkMedia, Error, TEXT( "Unknown display mode %s." ), *Name );
+			return 1;
+		}
+		Settings.modes.push_back( Mode );
+	}
+
+	for( const FString& Name : ParseList( Params, TEXT( "Paths=" ) ) )
+	{
+		const DeckLinkConversionPath Paths[] = { DeckLinkConversionPath::UYVYToBGRA8, DeckLinkConversionPath::V210ToBGRA8, DeckLinkConversionPath::V210ToA2B10G10R10, DeckLinkConversionPath::V210ToRGBA16 };
+		bool Found = false;
+		for( DeckLinkConversionPath Path : Paths )
+		{
+			if( Name.Equals( UTF8_TO_TCHAR( DeckLinkConversionBenchmark::GetPathName( Path ) ), ESearchCase::IgnoreCase ) )
+			{
+				Settings.paths.push_back( Path );
+				Found = true;
+			}
+		}
+
+		if( ! Found )
+		{
+			UE_LOG( LogDeckLinkMedia, Error, TEXT( "Unknown conversion path %s." ), *Name );
+			return 1;
+		}
+	}
+
+	const TArray<FString> Threads = ParseList( Params, TEXT( "Threads=" ) );
+	if( Threads.Num() > 0 )
+	{
+		Settings.threadCounts.clear();
+		for( const FString& Count : Threads )
+		{
+			Settings.threadCounts.push_back( (uint32)FMath::Clamp( FCString::Atoi( *Count ), 1, 64 ) );
+		}
+	}
+
+	ParseInstructionSets( Params, Settings.instructionSets );
+
+	Settings.includeSdk = !FParse::Param( *Params, TEXT( "NoSdk" ) );
+	FParse::Value( *Params, TEXT( "Seconds=" ), Settings.secondsPerCase );
+
+	FString Output;
+	if( ! FParse::Value( *Params, TEXT( "Output=" ), Output ) )
+	{
+		Output = FPaths::Combine( FPaths::GameSavedDir(), TEXT( "DeckLinkMedia" ), FString::Printf( TEXT( "ConversionBenchmark-%s" ), *FDateTime::Now().ToString() ) );
+	}
+
+	IDeckLinkVideoConversion* SdkConverter = Settings.includeSdk ? DeckLinkPlatform::CreateVideoConversion() : nullptr;
+	if( Settings.includeSdk && SdkConverter == nullptr )
+	{
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "DeckLink driver not found, skipping the SDK converter." ) );
+	}
+
+	const FString Machine = FPlatformMisc::GetCPUBrand();
+	UE_LOG( LogDeckLinkMedia, Display, TEXT( "Conversion benchmark on %s, %s." ), *Machine, UTF8_TO_TCHAR( DeckLinkPixelConversion::GetInstructionSetName( DeckLinkPixelConversion::DetectInstructionSet() ) ) );
+
+	std::vector<DeckLinkConversionResult> Results;
+	{
+		DeckLinkConversionBenchmark Benchmark( SdkConverter );
+		Results = Benchmark.Run( Settings, []( const DeckLinkConversionResult& Result ) {
+			UE_LOG( LogDeckLinkMedia, Display, TEXT( "%s" ), UTF8_TO_TCHAR( DeckLinkConversionBenchmark::FormatLine( Result ).c_str() ) );
+		} );
+	}
+
+	if( SdkConverter != nullptr )
+	{
+		SdkConverter->Release();
+	}
+
+	const bool Written = WriteResults( Output + TEXT( ".json" ), UTF8_TO_TCHAR( DeckLinkConversionBenchmark::FormatJson( Results, TCHAR_TO_UTF8( *Machine ) ).c_str() ) )
+		&& WriteResults( Output + TEXT( ".csv" ), UTF8_TO_TCHAR( DeckLinkConversionBenchmark::FormatCsv( Results ).c_str() ) );
+
+	return Written ? 0 : 1;
+}
+
+
+int32 UDeckLinkMediaBenchmarkCommandlet::RunPipelineBenchmark( const FString& Params )
+{
+	using namespace DeckLinkMediaBenchmark;
+
+	FDeckLinkMediaPipelineBenchmarkSettings Settings;
+	FParse::Value( *Params, TEXT( "Mode=" ), Settings.DisplayMode );
+	FParse::Value( *Params, TEXT( "TickRate=" ), Settings.TickRate );
+	FParse::Value( *Params, TEXT( "Warmup=" ), Settings.WarmupSeconds );
+	FParse::Value( *Params, TEXT( "Seconds=" ), Settings.Seconds );
+	Settings.bSinkCopy = FParse::Param( *Params, TEXT( "SinkCopy" ) );
+
+	TArray<int32> DeviceCounts;
+	for( const FString& Count : ParseList( Params, TEXT( "Devices=" ) ) )
+	{
+		DeviceCounts.Add( FMath::Clamp( FCString::Atoi( *Count ), 1, FDeckLinkMediaPipelineBenchmark::MaxDevices ) );
+	}
+	if( DeviceCounts.Num() == 0 )
+	{
+		DeviceCounts = { 1, 2, 4, 8 };
+	}
+
+	FString Output;
+	if( ! FParse::Value( *Params, TEXT( "Output=" ), Output ) )
+	{
+		Output = FPaths::Combine( FPaths::GameSavedDir(), TEXT( "DeckLinkMedia" ), FString::Printf( TEXT( "PipelineBenchmark-%s" ), *FDateTime::Now().ToString() ) );
+	}
+
+	const FString Machine = FPlatformMisc::GetCPUBrand();
+	UE_LOG( LogDeckLinkMedia, Display, TEXT( "Pipeline benchmark on %s, %s for %.1f s per run." ), *Machine, *Settings.DisplayMode, Settings.Seconds );
+
+	TArray<FDeckLinkMediaPipelineResult> Results;
+	for( int32 Devices : DeviceCounts )
+	{
+		Settings.Devices = Devices;
+
+		FDeckLinkMediaPipelineResult Result;
+		if( ! FDeckLinkMediaPipelineBenchmark::Run( Settings, Result ) )
+		{
+			return 1;
+		}
+
+		UE_LOG( LogDeckLinkMedia, Display, TEXT( "%s" ), *FDeckLinkMediaPipelineBenchmark::FormatSummary( Result ) );
+		for( const FDeckLinkMediaPipelineDeviceResult& Device : Result.PerDevice )
+		{
+			UE_LOG( LogDeckLinkMedia, Display, TEXT( "%s" ), *FDeckLinkMediaPipelineBenchmark::FormatLine( Result, Device ) );
+		}
+		Results.Add( Result );
+	}
+
+	const bool Written = WriteResults( Output + TEXT( ".json" ), FDeckLinkMediaPipelineBenchmark::FormatJson( Results, Machine ) )
+		&& WriteResults( Output + TEXT( ".csv" ), FDeckLinkMediaPipelineBenchmark::FormatCsv( Results ) );
+
+	return Written ? 0 : 1;
+}
+
+
+int32 UDeckLinkMediaBenchmarkCommandlet::RunAudioBenchmark( const FString& Params )
+{
+	using namespace DeckLinkMediaBenchmark;
+
+	DeckLinkAudioBenchmarkSettings Settings;
+	ParseInstructionSets( Params, Settings.instructionSets );
+	FParse::Value( *Params, TEXT( "Frames=" ), Settings.framesPerPacket );
+	Settings.framesPerPacket = FMath::Clamp<uint32>( Settings.framesPerPacket, 1, 8192 );
+	FParse::Value( *Params, TEXT( "Seconds=" ), Settings.secondsPerCase );
+
+	FString Output;
+	if( ! FParse::Value( *Params, TEXT( "Output=" ), Output ) )
+	{
+		Output = FPaths::Combine( FPaths::GameSavedDir(), TEXT( "DeckLinkMedia" ), FString::Printf( TEXT( "AudioBenchmark-%s" ), *FDateTime::Now().ToString() ) );
+	}
+
+	const FString Machine = FPlatformMisc::GetCPUBrand();
+	UE_LOG( LogDeckLinkMedia, Display, TEXT( "Audio benchmark on %s, %s, %u frames per packet." ), *Machine, UTF8_TO_TCHAR( DeckLinkPixelConversion::GetInstructionSetName( DeckLinkPixelConversion::DetectInstructionSet() ) ), Settings.framesPerPacket );
+
+	bool bMatches = true;
+	const std::vector<DeckLinkAudioBenchmarkResult> Results = DeckLinkAudioBenchmark::Run( Settings, [&bMatches]( const DeckLinkAudioBenchmarkResult& Result ) {
+		UE_LOG( LogDeckLinkMedia, Display, TEXT( "%s" ), UTF8_TO_TCHAR( DeckLinkAudioBenchmark::FormatLine( Result ).c_str() ) );
+		bMatches &= Result.matchesScalar;
+	} );
+
+	const bool Written = WriteResults( Output + TEXT( ".json" ), UTF8_TO_TCHAR( DeckLinkAudioBenchmark::FormatJson( Results, TCHAR_TO_UTF8( *Machine ) ).c_str() ) )
+		&& WriteResults( Output + TEXT( ".csv" ), UTF8_TO_TCHAR( DeckLinkAudioBenchmark::FormatCsv( Results ).c_str() ) );
+
+	return ( Written && bMatches ) ? 0 : 1;
+}
+
+
+int32 UDeckLinkMediaBenchmarkCommandlet::VerifyAudio()
+{
+	UE_LOG( LogDeckLinkMedia, Display, TEXT( "Checking the audio kernels against the scalar path, %s supported." ), UTF8_TO_TCHAR( DeckLinkPixelConversion::GetInstructionSetName( DeckLinkPixelConversion::DetectInstructionSet() ) ) );
+
+	const std::vector<std::string> Mismatches = DeckLinkAudioBenchmark::Verify();
+	for( const std::string& Mismatch : Mismatches )
+	{
+		UE_LOG( LogDeckLinkMedia, Error, TEXT( "%s" ), UTF8_TO_TCHAR( Mismatch.c_str() ) );
+	}
+
+	if( Mismatches.empty() )
+	{
+		UE_LOG( LogDeckLinkMedia, Display, TEXT( "All audio kernels match the scalar path." ) );
+		return 0;
+	}
+	return 1;
+}
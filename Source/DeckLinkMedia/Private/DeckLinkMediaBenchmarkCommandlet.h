@@ -0,0 +1,71 @@
+// Copyright 2017 The Mill, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "UObject/ObjectMacros.h"
+
+#include "DeckLinkMediaBenchmarkCommandlet.generated.h"
+
+
+/**
+ * Measures the capture pipeline on synthetic frames, no card needed: the
+ * frame conversion on its own, with -Audio the audio kernels, or with
+ * -Pipeline whole players capturing from several virtual devices.
+ *
+ * UE4Editor-Cmd.exe <Project> -run=DeckLinkMediaBenchmark [options]
+ *
+ *   -Modes=HD1080p5994,4K2160p60   display modes by GetDisplayModeString name, default all
+ *   -Paths=UYVYToBGRA8,...         conversion paths, default all
+ *   -Threads=1,2,4                 threads per frame, default powers of two up to the core count
+ *   -ISA=Scalar,SSE41,AVX2|All     native kernel variants, default the widest supported
+ *   -NoSdk                         skip the SDK converter
+ *   -Seconds=0.5                   time spent on each case
+ *   -Output=<path>                 results as <path>.json and <path>.csv, default Saved/DeckLinkMedia
+ *
+ * UE4Editor-Cmd.exe <Project> -run=DeckLinkMediaBenchmark -Pipeline [options]
+ *
+ *   -Devices=1,2,4,8               virtual devices captured at once, one run per count, up to 8
+ *   -Mode=HD1080p5994              display mode of every device
+ *   -SinkCopy                      copy every frame out in the texture sink instead of only counting it
+ *   -TickRate=0                    player ticks per second, default every millisecond
+ *   -Warmup=2 -Seconds=10          time before and during measurement of each run
+ *   -Output=<path>                 results as <path>.json and <path>.csv, default Saved/DeckLinkMedia
+ *
+ * UE4Editor-Cmd.exe <Project> -run=DeckLinkMediaBenchmark -Audio [options]
+ *
+ *   -ISA=Scalar,SSE41,AVX2|All     kernel variants, default scalar and the widest supported
+ *   -Frames=1601                   sample frames per packet
+ *   -Seconds=0.25                  time spent on each case
+ *   -Output=<path>                 results as <path>.json and <path>.csv, default Saved/DeckLinkMedia
+ *
+ * UE4Editor-Cmd.exe <Project> -run=DeckLinkMediaBenchmark -VerifyAudio
+ *
+ *   Checks every supported audio kernel variant against the scalar path, bit
+ *   for bit, and fails if any differs.
+ */
+UCLASS()
+class UDeckLinkMediaBenchmarkCommandlet
+	: public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Default constructor. */
+	UDeckLinkMediaBenchmarkCommandlet();
+
+public:
+
+	//~ UCommandlet interface
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+
+	int32 RunConversionBenchmark(const FString& Params);
+	int32 RunPipelineBenchmark(const FString& Params);
+	int32 RunAudioBenchmark(const FString& Params);
+	int32 VerifyAudio();
+};
@@ -6,8 +6,12 @@
 #include "Modules/ModuleManager.h"
 #include "DeckLinkMediaPlayer.h"
 
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
 #include "HAL/PlatformProcess.h"
 #include "IPluginManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeLock.h"
 #include "Paths.h"
 
 #include "DeckLink/DecklinkDevice.h"
@@ -32,8 +36,33 @@ public:
 	void DeviceArrived( IDeckLink* decklink, size_t id );
 	virtual TSharedPtr<IMediaPlayer> CreatePlayer() override;
 private:
+	/**
+	 * Cards are keyed by their sub-device index, at most 0 to 7 on the
+	 * largest cards. Virtual devices take the keys from here on, so they
+	 * never collide with a card that arrives later.
+	 */
+	static const uint8 FirstVirtualDeviceKey = 8;
+
+	/** Adds a device to DeviceMap, on the game thread where the players read it. */
+	void AddDevice( IDeckLink* decklink, size_t id );
+
+	/** Adds the cards that arrived on the driver's thread since the last tick. */
+	bool TickArrivals( float DeltaTime );
+
+	/** Writes the latency histograms of every device to a file each, in the given directory or Saved/DeckLinkMedia. */
+	void DumpLatency( const TArray<FString>& Args );
+
+	/** Stops tracing and writes the trace to the given file or Saved/DeckLinkMedia. */
+	void StopTrace( const TArray<FString>& Args );
+
 	TSharedPtr<DeckLinkDeviceDiscovery> DeviceDiscovery;
 	TMap<uint8, TUniquePtr<DeckLinkDevice>> DeviceMap;
+	TArray<IConsoleObject*> ConsoleCommands;
+
+	/** Cards the driver announced and that are not in DeviceMap yet, each holding a reference. */
+	FCriticalSection PendingArrivalsLock;
+	TArray<TPair<IDeckLink*, size_t>> PendingArrivals;
+	FDelegateHandle TickArrivalsHandle;
 };
 
 IMPLEMENT_MODULE(FDeckLinkMediaModule, DeckLinkMedia);
@@ -44,18 +73,105 @@ void FDeckLinkMediaModule::StartupModule()
 	auto DeviceCallback = std::bind( &FDeckLinkMediaModule::DeviceArrived, this, _1, _2 );
 	DeviceDiscovery.Reset();
 	DeviceDiscovery = MakeShareable( new DeckLinkDeviceDiscovery( DeviceCallback ) );
+
+	// cards arrive later on the driver's thread, virtual devices now and at their own keys
+	const UDeckLinkMediaSettings* Settings = GetDefault<UDeckLinkMediaSettings>();
+	const DeckLinkTestPattern::Pattern Pattern = ( Settings->VirtualDevicePattern == EDeckLinkMediaTestPattern::Ramp ) ? DeckLinkTestPattern::Pattern::Ramp
+		: ( ( Settings->VirtualDevicePattern == EDeckLinkMediaTestPattern::ZonePlate ) ? DeckLinkTestPattern::Pattern::ZonePlate : DeckLinkTestPattern::Pattern::Bars );
+	for( int32 Index = 0; Index < Settings->VirtualDevices; ++Index )
+	{
+		DeviceDiscovery->AddVirtualDevice( FirstVirtualDeviceKey + Index, Pattern );
+	}
+
+	TickArrivalsHandle = FTicker::GetCoreTicker().AddTicker( FTickerDelegate::CreateRaw( this, &FDeckLinkMediaModule::TickArrivals ) );
+
+	ConsoleCommands.Add( IConsoleManager::Get().RegisterConsoleCommand(
+		TEXT( "DeckLinkMedia.DumpLatency" ),
+		TEXT( "Writes the capture latency histograms of every DeckLink device to a text file. Optional argument: output directory." ),
+		FConsoleCommandWithArgsDelegate::CreateRaw( this, &FDeckLinkMediaModule::DumpLatency ),
+		ECVF_Default ) );
+
+	ConsoleCommands.Add( IConsoleManager::Get().RegisterConsoleCommand(
+		TEXT( "DeckLinkMedia.StartTrace" ),
+		TEXT( "Starts recording per-frame capture events of every DeckLink device." ),
+		FConsoleCommandDelegate::CreateStatic( &DeckLinkTrace::Start ),
+		ECVF_Default ) );
+
+	ConsoleCommands.Add( IConsoleManager::Get().RegisterConsoleCommand(
+		TEXT( "DeckLinkMedia.StopTrace" ),
+		TEXT( "Stops recording capture events and writes them as Chrome trace JSON. Optional argument: output file." ),
+		FConsoleCommandWithArgsDelegate::CreateRaw( this, &FDeckLinkMediaModule::StopTrace ),
+		ECVF_Default ) );
 }
 
 void FDeckLinkMediaModule::ShutdownModule()
 {
+	for( IConsoleObject* Command : ConsoleCommands )
+	{
+		IConsoleManager::Get().UnregisterConsoleObject( Command );
+	}
+	ConsoleCommands.Empty();
+	DeckLinkTrace::Stop();
+	FTicker::GetCoreTicker().RemoveTicker( TickArrivalsHandle );
+
 	DeviceMap.Empty();
 	DeviceDiscovery.Reset();
+
+	// nothing arrives once the discovery is gone
+	for( const auto& Arrival : PendingArrivals )
+	{
+		Arrival.Key->Release();
+	}
+	PendingArrivals.Empty();
 }
 
 void FDeckLinkMediaModule::DeviceArrived( IDeckLink* decklink, size_t id )
+{
+	if( IsInGameThread() )
+	{
+		AddDevice( decklink, id );
+		return;
+	}
+
+	decklink->AddRef();
+	FScopeLock Lock( &PendingArrivalsLock );
+	PendingArrivals.Emplace( decklink, id );
+}
+
+bool FDeckLinkMediaModule::TickArrivals( float DeltaTime )
+{
+	TArray<TPair<IDeckLink*, size_t>> Arrivals;
+	{
+		FScopeLock Lock( &PendingArrivalsLock );
+		Swap( Arrivals, PendingArrivals );
+	}
+
+	for( const auto& Arrival : Arrivals )
+	{
+		AddDevice( Arrival.Key, Arrival.Value );
+		Arrival.Key->Release();
+	}
+	return true;
+}
+
+void FDeckLinkMediaModule::AddDevice( IDeckLink* decklink, size_t id )
 {
 	uint8 DeviceId = static_cast<uint8>(id);
-	DeviceMap.Emplace( DeviceId, MakeUnique<DeckLinkDevice>( DeviceDiscovery.Get(), decklink ) );
+	if( id > MAX_uint8 || DeviceMap.Contains( DeviceId ) )
+	{
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Device %d arrived with the key of another device and was skipped." ), id );
+		return;
+	}
+
+	TUniquePtr<DeckLinkDevice> Device = MakeUnique<DeckLinkDevice>( DeviceDiscovery.Get(), decklink );
+	if( ! Device->IsValid() )
+	{
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Device %d has no video input and was skipped." ), id );
+		return;
+	}
+
+	DeviceMap.Emplace( DeviceId, MoveTemp( Device ) );
+	DeviceMap[DeviceId]->SetTraceId( DeviceId + 1 );
 	UE_LOG( LogDeckLinkMedia, Log, TEXT( "Device %d arrived." ), id );
 
 	DeviceMap.KeySort( []( uint8 A, uint8 B ) {
@@ -63,6 +179,45 @@ void FDeckLinkMediaModule::DeviceArrived( IDeckLink* decklink, size_t id )
 	} );
 }
 
+void FDeckLinkMediaModule::DumpLatency( const TArray<FString>& Args )
+{
+	const FString Directory = ( Args.Num() > 0 ) ? Args[0] : FPaths::Combine( FPaths::GameSavedDir(), TEXT( "DeckLinkMedia" ) );
+	const FString Timestamp = FDateTime::Now().ToString();
+
+	for( const auto& Entry : DeviceMap )
+	{
+		if( ! Entry.Value.IsValid() || ! Entry.Value->IsCapturing() )
+		{
+			continue;
+		}
+
+		const FString FileName = FPaths::Combine( Directory, FString::Printf( TEXT( "Latency-Device%d-%s.txt" ), Entry.Key + 1, *Timestamp ) );
+		if( FFileHelper::SaveStringToFile( UTF8_TO_TCHAR( Entry.Value->GetLatency().Format().c_str() ), *FileName ) )
+		{
+			UE_LOG( LogDeckLinkMedia, Log, TEXT( "Wrote latency histograms to %s." ), *FileName );
+		}
+		else
+		{
+			UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Unable to write latency histograms to %s." ), *FileName );
+		}
+	}
+}
+
+void FDeckLinkMediaModule::StopTrace( const TArray<FString>& Args )
+{
+	DeckLinkTrace::Stop();
+
+	const FString FileName = ( Args.Num() > 0 ) ? Args[0] : FPaths::Combine( FPaths::GameSavedDir(), TEXT( "DeckLinkMedia" ), FString::Printf( TEXT( "Trace-%s.json" ), *FDateTime::Now().ToString() ) );
+	if( FFileHelper::SaveStringToFile( UTF8_TO_TCHAR( DeckLinkTrace::FormatJson().c_str() ), *FileName ) )
+	{
+		UE_LOG( LogDeckLinkMedia, Log, TEXT( "Wrote capture trace to %s." ), *FileName );
+	}
+	else
+	{
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Unable to write capture trace to %s." ), *FileName );
+	}
+}
+
 TSharedPtr<IMediaPlayer> FDeckLinkMediaModule::CreatePlayer()
 {
 	return MakeShared<FDeckLinkMediaPlayer>( &DeviceMap );
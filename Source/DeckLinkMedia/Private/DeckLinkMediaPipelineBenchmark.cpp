@@ -0,0 +1,412 @@
+// Copyright 2017 The Mill, Inc. All Rights Reserved.
+
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkMediaPipelineBenchmark.h"
+#include "DeckLinkMediaPlayer.h"
+
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "IMediaTextureSink.h"
+#include "UObject/Package.h"
+
+#include "DeckLink/DecklinkDevice.h"
+#include "DeckLink/DeckLinkTestPattern.h"
+#include "DeckLink/DeckLinkVirtualDevice.h"
+
+#if PLATFORM_WINDOWS
+	#include "Windows/WindowsHWrapper.h"
+#else
+	#include <sys/resource.h>
+#endif
+
+
+namespace DeckLinkMediaPipelineBenchmark
+{
+	/** Counts the frames it is given, and copies them out if asked to. */
+	class FNullTextureSink
+		: public IMediaTextureSink
+	{
+	public:
+
+		explicit FNullTextureSink( bool bInCopy )
+			: Dimensions( FIntPoint::ZeroValue )
+			, Format( EMediaTextureSinkFormat::CharBGRA )
+			, Mode( EMediaTextureSinkMode::Unbuffered )
+			, bCopy( bInCopy )
+			, FrameBytes( 0 )
+			, DisplayedFrames( 0 )
+		{ }
+
+		uint64 GetDisplayedFrames() const
+		{
+			return DisplayedFrames;
+		}
+
+		/** Size of the last frame uploaded, 0 before the first one. */
+		uint64 GetFrameBytes() const
+		{
+			return FrameBytes;
+		}
+
+	public:
+
+		//~ IMediaTextureSink interface
+
+		virtual void* AcquireTextureSinkBuffer() override
+		{
+			return Staging.GetData();
+		}
+
+		virtual void DisplayTextureSinkBuffer( FTimespan Time ) override
+		{
+			++DisplayedFrames;
+		}
+
+		virtual FIntPoint GetTextureSinkDimensions() const override
+		{
+			return Dimensions;
+		}
+
+		virtual EMediaTextureSinkFormat GetTextureSinkFormat() const override
+		{
+			return Format;
+		}
+
+		virtual EMediaTextureSinkMode GetTextureSinkMode() const override
+		{
+			return Mode;
+		}
+
+		virtual bool InitializeTextureSink( FIntPoint OutputDim, FIntPoint BufferDim, EMediaTextureSinkFormat InFormat, EMediaTextureSinkMode InMode ) override
+		{
+			Dimensions = OutputDim;
+			Format = InFormat;
+			Mode = InMode;
+			return true;
+		}
+
+		virtual void ReleaseTextureSinkBuffer() override { }
+
+		virtual void ShutdownTextureSink() override
+		{
+			Dimensions = FIntPoint::ZeroValue;
+			Staging.Empty();
+		}
+
+		virtual bool SupportsTextureSinkFormat( EMediaTextureSinkFormat InFormat ) const override
+		{
+			return ( InFormat == EMediaTextureSinkFormat::CharBGRA );
+		}
+
+		virtual void UpdateTextureSinkBuffer( const uint8* Data, uint32 Pitch = 0 ) override
+		{
+			FrameBytes = (uint64)Pitch * Dimensions.Y;
+			if( bCopy )
+			{
+				Staging.SetNumUninitialized( FrameBytes, false );
+				FMemory::Memcpy( Staging.GetData(), Data, FrameBytes );
+			}
+		}
+
+		virtual void UpdateTextureSinkResource( FRHITexture* RenderTarget, FRHITexture* ShaderResource ) override { }
+
+	private:
+
+		FIntPoint Dimensions;
+		EMediaTextureSinkFormat Format;
+		EMediaTextureSinkMode Mode;
+		bool bCopy;
+		TArray<uint8> Staging;
+		uint64 FrameBytes;
+		uint64 DisplayedFrames;
+	};
+
+
+	/** Running totals of one device, the result is the difference of two of these. */
+	struct FDeviceCounters
+	{
+		uint64 Delivered;
+		uint64 Skipped;
+		uint64 Captured;
+		uint64 Displayed;
+		uint64 RenderMicroseconds;
+	};
+
+
+	/** User and kernel time of the whole process, in seconds. */
+	double GetProcessCpuSeconds()
+	{
+#if PLATFORM_WINDOWS
+		FILETIME Creation, Exit, Kernel, User;
+		if( ! ::GetProcessTimes( ::GetCurrentProcess(), &Creation, &Exit, &Kernel, &User ) )
+		{
+			return 0.0;
+		}
+
+		auto ToSeconds = []( const FILETIME& Time ) { return ( ( (uint64)Time.dwHighDateTime << 32 ) | Time.dwLowDateTime ) * 1e-7; };
+		return ToSeconds( Kernel ) + ToSeconds( User );
+#else
+		struct rusage Usage;
+		if( getrusage( RUSAGE_SELF, &Usage ) != 0 )
+		{
+			return 0.0;
+		}
+
+		return ( Usage.ru_utime.tv_sec + Usage.ru_stime.tv_sec ) + ( Usage.ru_utime.tv_usec + Usage.ru_stime.tv_usec ) * 1e-6;
+#endif
+	}
+
+
+	FString EscapeJson( const FString& Text )
+	{
+		return Text.Replace( TEXT( "\\" ), TEXT( "\\\\" ) ).Replace( TEXT( "\"" ), TEXT( "\\\"" ) );
+	}
+}
+
+
+/* FDeckLinkMediaPipelineResult implementation
+ *****************************************************************************/
+
+bool FDeckLinkMediaPipelineResult::IsSustained() const
+{
+	for( const FDeckLinkMediaPipelineDeviceResult& Device : PerDevice )
+	{
+		if( Device.Displayed < Device.Generated * 0.995 )
+		{
+			return false;
+		}
+	}
+
+	return ( PerDevice.Num() > 0 );
+}
+
+
+/* FDeckLinkMediaPipelineBenchmark implementation
+ *****************************************************************************/
+
+bool FDeckLinkMediaPipelineBenchmark::Run( const FDeckLinkMediaPipelineBenchmarkSettings& Settings, FDeckLinkMediaPipelineResult& OutResult )
+{
+	using namespace DeckLinkMediaPipelineBenchmark;
+
+	BMDDisplayMode Mode;
+	if( ! DeckLinkDevice::FindDisplayMode( TCHAR_TO_UTF8( *Settings.DisplayMode ), Mode ) )
+	{
+		UE_LOG( LogDeckLinkMedia, Error, TEXT( "Unknown display mode %s." ), *Settings.DisplayMode );
+		return false;
+	}
+
+	const int32 NumDevices = FMath::Clamp( Settings.Devices, 1, MaxDevices );
+
+	// every device is virtual, cards announced by the driver are left alone
+	TSharedPtr<DeckLinkDeviceDiscovery> Discovery = MakeShareable( new DeckLinkDeviceDiscovery( []( IDeckLink*, size_t ) { } ) );
+
+	// our own reference to each card keeps its counters readable until the devices are gone
+	TMap<uint8, TUniquePtr<DeckLinkDevice>> DeviceMap;
+	TArray<DeckLinkVirtualDevice*> Cards;
+	for( int32 Index = 0; Index < NumDevices; ++Index )
+	{
+		DeckLinkVirtualDevice* Card = new DeckLinkVirtualDevice( Index );
+		DeviceMap.Emplace( (uint8)Index, MakeUnique<DeckLinkDevice>( Discovery.Get(), Card ) );
+		DeviceMap[Index]->SetTraceId( Index + 1 );
+		Cards.Add( Card );
+	}
+
+	UDeckLinkMediaSource* Source = NewObject<UDeckLinkMediaSource>( GetTransientPackage() );
+	Source->AddToRoot();
+	Source->DisplayMode = Settings.DisplayMode;
+	Source->QueueDepth = Settings.QueueDepth;
+	Source->QueuePolicy = Settings.QueuePolicy;
+	Source->AudioChannels = EDeckLinkMediaAudioChannels::Disabled;
+
+	TArray<TUniquePtr<FNullTextureSink>> Sinks;
+	TArray<TUniquePtr<FDeckLinkMediaPlayer>> Players;
+	bool Started = true;
+	for( int32 Index = 0; Index < NumDevices && Started; ++Index )
+	{
+		Sinks.Add( MakeUnique<FNullTextureSink>( Settings.bSinkCopy ) );
+		Players.Add( MakeUnique<FDeckLinkMediaPlayer>( &DeviceMap ) );
+
+		Source->SetDeviceId( (uint8)( Index + 1 ) );
+		Started = Players[Index]->Open( Source->GetUrl(), *Source ) && DeviceMap[Index]->IsCapturing();
+		Players[Index]->SetVideoSink( Sinks[Index].Get() );
+
+		if( ! Started )
+		{
+			UE_LOG( LogDeckLinkMedia, Error, TEXT( "Virtual device %d did not start capturing." ), Index + 1 );
+		}
+	}
+
+	auto TickPlayers = [&]( double Seconds )
+	{
+		const double End = FPlatformTime::Seconds() + Seconds;
+		double LastTick = FPlatformTime::Seconds();
+		for( double Now = LastTick; Now < End; Now = FPlatformTime::Seconds() )
+		{
+			const float DeltaTime = (float)( Now - LastTick );
+			LastTick = Now;
+			for( const TUniquePtr<FDeckLinkMediaPlayer>& Player : Players )
+			{
+				Player->TickPlayer( DeltaTime );
+				Player->TickVideo( DeltaTime );
+			}
+
+			const double Interval = ( Settings.TickRate > 0.0f ) ? 1.0 / Settings.TickRate : 0.001;
+			FPlatformProcess::Sleep( (float)FMath::Max( Interval - ( FPlatformTime::Seconds() - Now ), 0.0 ) );
+		}
+	};
+
+	auto ReadCounters = [&]()
+	{
+		TArray<FDeviceCounters> Counters;
+		for( int32 Index = 0; Index < NumDevices; ++Index )
+		{
+			const DeckLinkCaptureStats& Capture = DeviceMap[Index]->GetCaptureStats();
+			Counters.Add( FDeviceCounters{ Cards[Index]->GetDeliveredFrames(), Cards[Index]->GetSkippedFrames(), Capture.GetCapturedFrames(), Sinks[Index]->GetDisplayedFrames(), Cards[Index]->GetRenderMicroseconds() } );
+		}
+		return Counters;
+	};
+
+	if( Started )
+	{
+		TickPlayers( Settings.WarmupSeconds );
+
+		for( const auto& Entry : DeviceMap )
+		{
+			Entry.Value->GetLatency().Reset();
+		}
+
+		const TArray<FDeviceCounters> Begin = ReadCounters();
+		const double BeginCpu = GetProcessCpuSeconds();
+		const double BeginTime = FPlatformTime::Seconds();
+
+		TickPlayers( Settings.Seconds );
+
+		const TArray<FDeviceCounters> End = ReadCounters();
+		const double EndCpu = GetProcessCpuSeconds();
+		const double EndTime = FPlatformTime::Seconds();
+
+		const DeckLinkDevice& First = *DeviceMap[0];
+		OutResult.DisplayMode = UTF8_TO_TCHAR( DeckLinkDevice::GetDisplayModeString( Mode ).c_str() );
+		OutResult.DisplayMode.RemoveFromStart( TEXT( "Mode " ) );
+		OutResult.Size = First.GetCurrentSize();
+		OutResult.ModeFps = First.GetCurrentFps();
+		OutResult.Converter = UTF8_TO_TCHAR( DeviceMap[0]->GetConverterDescription().c_str() );
+		OutResult.bSinkCopy = Settings.bSinkCopy;
+		OutResult.Seconds = EndTime - BeginTime;
+		OutResult.CpuSeconds = EndCpu - BeginCpu;
+		OutResult.MemoryBytes = 0;
+		OutResult.PerDevice.Reset();
+
+		// the card writes the 8-bit YUV frame and the converter reads it back, then writes BGRA which the sink may copy out
+		const uint64 SourceBytes = (uint64)DeckLinkTestPattern::GetRowBytes( OutResult.Size.X, DeckLinkTestPattern::Format::UYVY ) * OutResult.Size.Y;
+		for( int32 Index = 0; Index < NumDevices; ++Index )
+		{
+			const FDeviceCounters& From = Begin[Index];
+			const FDeviceCounters& To = End[Index];
+			const DeckLinkLatencyHistogram& Total = DeviceMap[Index]->GetLatency().Get( DeckLinkLatencyStage::Total );
+
+			FDeckLinkMediaPipelineDeviceResult Device;
+			Device.Device = Index + 1;
+			Device.Generated = ( To.Delivered - From.Delivered ) + ( To.Skipped - From.Skipped );
+			Device.SkippedByCard = To.Skipped - From.Skipped;
+			Device.Captured = To.Captured - From.Captured;
+			Device.Displayed = To.Displayed - From.Displayed;
+			Device.LatencyP50 = Total.GetPercentile( 0.5 );
+			Device.LatencyP99 = Total.GetPercentile( 0.99 );
+			Device.ConversionAverage = DeviceMap[Index]->GetCaptureStats().GetConversionTiming().GetAverage();
+			OutResult.PerDevice.Add( Device );
+
+			const uint64 ConvertedBytes = ( Sinks[Index]->GetFrameBytes() > 0 ) ? Sinks[Index]->GetFrameBytes() : (uint64)OutResult.Size.X * OutResult.Size.Y * 4;
+			OutResult.MemoryBytes += ( To.Delivered - From.Delivered ) * SourceBytes * 2 + Device.Captured * ConvertedBytes;
+			if( Settings.bSinkCopy )
+			{
+				OutResult.MemoryBytes += Device.Displayed * ConvertedBytes * 2;
+			}
+
+			// a card draws nothing, so the test pattern's share of the process time is not the pipeline's
+			OutResult.CpuSeconds -= ( To.RenderMicroseconds - From.RenderMicroseconds ) * 1e-6;
+		}
+		OutResult.CpuSeconds = FMath::Max( OutResult.CpuSeconds, 0.0 );
+	}
+
+	// players before their devices, devices before their cards
+	for( const TUniquePtr<FDeckLinkMediaPlayer>& Player : Players )
+	{
+		Player->Close();
+	}
+	Players.Empty();
+	Sinks.Empty();
+	DeviceMap.Empty();
+	for( DeckLinkVirtualDevice* Card : Cards )
+	{
+		Card->Release();
+	}
+	Source->RemoveFromRoot();
+	Discovery.Reset();
+
+	return Started;
+}
+
+
+FString FDeckLinkMediaPipelineBenchmark::FormatLine( const FDeckLinkMediaPipelineResult& Result, const FDeckLinkMediaPipelineDeviceResult& Device )
+{
+	return FString::Printf( TEXT( "    device %d: %8.2f fps, %llu of %llu frames dropped (%llu by the card), latency %lld / %lld us p50 / p99, conversion %lld us" ),
+		Device.Device, Result.GetFramesPerSecond( Device ), Device.GetDropped(), Device.Generated, Device.SkippedByCard,
+		Device.LatencyP50, Device.LatencyP99, Device.ConversionAverage );
+}
+
+
+FString FDeckLinkMediaPipelineBenchmark::FormatSummary( const FDeckLinkMediaPipelineResult& Result )
+{
+	return FString::Printf( TEXT( "%-14s x%d: %s, %.2f CPU cores per device, %.1f MB/s memory traffic%s" ),
+		*Result.DisplayMode, Result.PerDevice.Num(), Result.IsSustained() ? TEXT( "sustained" ) : TEXT( "NOT sustained" ),
+		Result.GetCpuPerDevice(), Result.GetMegabytesPerSecond(), Result.bSinkCopy ? TEXT( " (sink copies)" ) : TEXT( "" ) );
+}
+
+
+FString FDeckLinkMediaPipelineBenchmark::FormatCsv( const TArray<FDeckLinkMediaPipelineResult>& Results )
+{
+	FString Csv = TEXT( "mode,width,height,modeFps,converter,sinkCopy,devices,device,seconds,generated,skippedByCard,captured,displayed,dropped,fps,latencyP50Us,latencyP99Us,conversionUs,cpuPerDevice,mbPerSecond,sustained\n" );
+	for( const FDeckLinkMediaPipelineResult& Result : Results )
+	{
+		for( const FDeckLinkMediaPipelineDeviceResult& Device : Result.PerDevice )
+		{
+			Csv += FString::Printf( TEXT( "%s,%d,%d,%.3f,\"%s\",%d,%d,%d,%.3f,%llu,%llu,%llu,%llu,%llu,%.3f,%lld,%lld,%lld,%.4f,%.3f,%d\n" ),
+				*Result.DisplayMode, Result.Size.X, Result.Size.Y, Result.ModeFps, *Result.Converter, Result.bSinkCopy ? 1 : 0,
+				Result.PerDevice.Num(), Device.Device, Result.Seconds, Device.Generated, Device.SkippedByCard, Device.Captured, Device.Displayed, Device.GetDropped(),
+				Result.GetFramesPerSecond( Device ), Device.LatencyP50, Device.LatencyP99, Device.ConversionAverage,
+				Result.GetCpuPerDevice(), Result.GetMegabytesPerSecond(), Result.IsSustained() ? 1 : 0 );
+		}
+	}
+	return Csv;
+}
+
+
+FString FDeckLinkMediaPipelineBenchmark::FormatJson( const TArray<FDeckLinkMediaPipelineResult>& Results, const FString& Machine )
+{
+	using namespace DeckLinkMediaPipelineBenchmark;
+
+	FString Json = FString::Printf( TEXT( "{\"machine\":\"%s\",\"hardwareThreads\":%d,\"results\":[" ), *EscapeJson( Machine ), FPlatformMisc::NumberOfCoresIncludingHyperthreads() );
+	for( int32 Index = 0; Index < Results.Num(); ++Index )
+	{
+		const FDeckLinkMediaPipelineResult& Result = Results[Index];
+		Json += FString::Printf( TEXT( "%s\n{\"mode\":\"%s\",\"width\":%d,\"height\":%d,\"modeFps\":%.3f,\"converter\":\"%s\",\"sinkCopy\":%s,\"devices\":%d,\"seconds\":%.3f,"
+			"\"cpuSeconds\":%.3f,\"cpuPerDevice\":%.4f,\"mbPerSecond\":%.3f,\"sustained\":%s,\"perDevice\":[" ),
+			( Index > 0 ) ? TEXT( "," ) : TEXT( "" ),
+			*Result.DisplayMode, Result.Size.X, Result.Size.Y, Result.ModeFps, *EscapeJson( Result.Converter ), Result.bSinkCopy ? TEXT( "true" ) : TEXT( "false" ),
+			Result.PerDevice.Num(), Result.Seconds, Result.CpuSeconds, Result.GetCpuPerDevice(), Result.GetMegabytesPerSecond(), Result.IsSustained() ? TEXT( "true" ) : TEXT( "false" ) );
+
+		for( int32 DeviceIndex = 0; DeviceIndex < Result.PerDevice.Num(); ++DeviceIndex )
+		{
+			const FDeckLinkMediaPipelineDeviceResult& Device = Result.PerDevice[DeviceIndex];
+			Json += FString::Printf( TEXT( "%s{\"device\":%d,\"generated\":%llu,\"skippedByCard\":%llu,\"captured\":%llu,\"displayed\":%llu,\"dropped\":%llu,\"fps\":%.3f,"
+				"\"latencyP50Us\":%lld,\"latencyP99Us\":%lld,\"conversionUs\":%lld}" ),
+				( DeviceIndex > 0 ) ? TEXT( "," ) : TEXT( "" ),
+				Device.Device, Device.Generated, Device.SkippedByCard, Device.Captured, Device.Displayed, Device.GetDropped(),
+				Result.GetFramesPerSecond( Device ), Device.LatencyP50, Device.LatencyP99, Device.ConversionAverage );
+		}
+		Json += TEXT( "]}" );
+	}
+	return Json + TEXT( "\n]}" );
+}
@@ -0,0 +1,146 @@
+// Copyright 2017 The Mill, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DeckLinkMediaSource.h"
+
+
+/** What one FDeckLinkMediaPipelineBenchmark run captures. */
+struct FDeckLinkMediaPipelineBenchmarkSettings
+{
+	/** Virtual devices captured at once. */
+	int32 Devices;
+
+	/** Display mode of every device, by DeckLinkDevice::GetDisplayModeString name. */
+	FString DisplayMode;
+
+	/** Capture queue of every player. */
+	int32 QueueDepth;
+	EDeckLinkMediaQueuePolicy QueuePolicy;
+
+	/** Copy each frame out of the sink, as an upload to a mapped texture would, instead of just counting it. */
+	bool bSinkCopy;
+
+	/** Player ticks per second, 0 to tick every millisecond. */
+	float TickRate;
+
+	/** Time to run before measuring, so pools and queues settle. */
+	float WarmupSeconds;
+
+	/** Time measured. */
+	float Seconds;
+
+	FDeckLinkMediaPipelineBenchmarkSettings()
+		: Devices( 1 )
+		, DisplayMode( TEXT( "HD1080p5994" ) )
+		, QueueDepth( 1 )
+		, QueuePolicy( EDeckLinkMediaQueuePolicy::LatestOnly )
+		, bSinkCopy( false )
+		, TickRate( 0.0f )
+		, WarmupSeconds( 2.0f )
+		, Seconds( 10.0f )
+	{ }
+};
+
+
+/** Counters of one device over the measured time. */
+struct FDeckLinkMediaPipelineDeviceResult
+{
+	/** Device number, starting at 1. */
+	int32 Device;
+
+	/** Frames the virtual card was due to deliver, including those it skipped. */
+	uint64 Generated;
+
+	/** Frames the card skipped because the capture side still held all of its buffers. */
+	uint64 SkippedByCard;
+
+	/** Frames converted and queued for the player. */
+	uint64 Captured;
+
+	/** Frames that reached the texture sink. */
+	uint64 Displayed;
+
+	/** Card arrival to sink upload, in microseconds. */
+	int64 LatencyP50;
+	int64 LatencyP99;
+
+	/** Rolling average of the frame conversion, in microseconds. */
+	int64 ConversionAverage;
+
+	uint64 GetDropped() const
+	{
+		return ( Generated > Displayed ) ? Generated - Displayed : 0;
+	}
+};
+
+
+/** Outcome of one FDeckLinkMediaPipelineBenchmark run. */
+struct FDeckLinkMediaPipelineResult
+{
+	FString DisplayMode;
+	FIntPoint Size;
+	double ModeFps;
+	FString Converter;
+	bool bSinkCopy;
+	double Seconds;
+
+	/** Process CPU time over the measured time, less what the virtual cards spent drawing test patterns. */
+	double CpuSeconds;
+
+	/** Bytes written and read by the card, the conversion and the sink, estimated from the frame sizes. */
+	uint64 MemoryBytes;
+
+	TArray<FDeckLinkMediaPipelineDeviceResult> PerDevice;
+
+	/** Frames per second one device delivered to its sink. */
+	double GetFramesPerSecond( const FDeckLinkMediaPipelineDeviceResult& Device ) const
+	{
+		return ( Seconds > 0.0 ) ? Device.Displayed / Seconds : 0.0;
+	}
+
+	/** CPU cores busy per device on average. */
+	double GetCpuPerDevice() const
+	{
+		return ( Seconds > 0.0 && PerDevice.Num() > 0 ) ? CpuSeconds / Seconds / PerDevice.Num() : 0.0;
+	}
+
+	double GetMegabytesPerSecond() const
+	{
+		return ( Seconds > 0.0 ) ? MemoryBytes / ( Seconds * 1024.0 * 1024.0 ) : 0.0;
+	}
+
+	/** True if every device got at least 99.5% of its frames to the sink. */
+	bool IsSustained() const;
+};
+
+
+/**
+ * Captures from several virtual devices at once through the whole player
+ * pipeline, to find where a machine stops keeping up.
+ *
+ * Each device is a DeckLinkVirtualDevice behind a DeckLinkDevice, played by
+ * an FDeckLinkMediaPlayer into a texture sink that only counts frames. The
+ * players are ticked on the calling thread, standing in for the game thread.
+ * Real cards are ignored, and the engine's media framework is not involved.
+ */
+class FDeckLinkMediaPipelineBenchmark
+{
+public:
+
+	/** Most devices captured at once. */
+	static const int32 MaxDevices = 8;
+
+	/**
+	 * Runs one capture, blocking for the warmup and measured time.
+	 *
+	 * @return false if the mode is unknown or a device did not start.
+	 */
+	static bool Run( const FDeckLinkMediaPipelineBenchmarkSettings& Settings, FDeckLinkMediaPipelineResult& OutResult );
+
+	static FString FormatLine( const FDeckLinkMediaPipelineResult& Result, const FDeckLinkMediaPipelineDeviceResult& Device );
+	static FString FormatSummary( const FDeckLinkMediaPipelineResult& Result );
+	static FString FormatCsv( const TArray<FDeckLinkMediaPipelineResult>& Results );
+	static FString FormatJson( const TArray<FDeckLinkMediaPipelineResult>& Results, const FString& Machine );
+};
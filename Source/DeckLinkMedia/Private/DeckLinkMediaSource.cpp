@@ -6,11 +6,37 @@
 #include "Misc/Paths.h"
 
 
+/* DeckLinkMediaOption names
+ *****************************************************************************/
+
+const FName DeckLinkMediaOption::DisplayMode( TEXT( "DisplayMode" ) );
+const FName DeckLinkMediaOption::QueueDepth( TEXT( "QueueDepth" ) );
+const FName DeckLinkMediaOption::QueuePolicy( TEXT( "QueuePolicy" ) );
+const FName DeckLinkMediaOption::AudioChannels( TEXT( "AudioChannels" ) );
+const FName DeckLinkMediaOption::AudioSampleType( TEXT( "AudioSampleType" ) );
+const FName DeckLinkMediaOption::AudioChannelMap( TEXT( "AudioChannelMap" ) );
+const FName DeckLinkMediaOption::AudioOffset( TEXT( "AudioOffset" ) );
+const FName DeckLinkMediaOption::AudioSyncTolerance( TEXT( "AudioSyncTolerance" ) );
+const FName DeckLinkMediaOption::AncillaryData( TEXT( "AncillaryData" ) );
+const FName DeckLinkMediaOption::AncillaryFilter( TEXT( "AncillaryFilter" ) );
+const FName DeckLinkMediaOption::AncillaryFirstLine( TEXT( "AncillaryFirstLine" ) );
+const FName DeckLinkMediaOption::AncillaryLastLine( TEXT( "AncillaryLastLine" ) );
+
+
 /* UDeckLinkMediaSource structors
  *****************************************************************************/
 
 UDeckLinkMediaSource::UDeckLinkMediaSource()
-	: DeviceId( 1 )
+	: QueueDepth( 1 )
+	, QueuePolicy( EDeckLinkMediaQueuePolicy::LatestOnly )
+	, AudioChannels( EDeckLinkMediaAudioChannels::Stereo )
+	, AudioSampleType( EDeckLinkMediaAudioSampleType::Int16 )
+	, AudioOffset( 0.0f )
+	, AudioSyncTolerance( 20.0f )
+	, bCaptureAncillaryData( false )
+	, AncillaryFirstLine( 1 )
+	, AncillaryLastLine( 41 )
+	, DeviceId( 1 )
 { }
 
 /* UDeckLinkMediaSource interface
@@ -34,3 +60,108 @@ bool UDeckLinkMediaSource::Validate() const
 {
 	return true;
 }
+
+/* IMediaOptions interface
+ *****************************************************************************/
+
+int64 UDeckLinkMediaSource::GetMediaOption( const FName& Key, int64 DefaultValue ) const
+{
+	if( Key == DeckLinkMediaOption::QueueDepth )
+	{
+		return QueueDepth;
+	}
+
+	if( Key == DeckLinkMediaOption::QueuePolicy )
+	{
+		return (int64)QueuePolicy;
+	}
+
+	if( Key == DeckLinkMediaOption::AudioChannels )
+	{
+		static const int64 ChannelCounts[] = { 0, 2, 8, 16 };
+		return ChannelCounts[(int32)AudioChannels];
+	}
+
+	if( Key == DeckLinkMediaOption::AudioSampleType )
+	{
+		return (int64)AudioSampleType;
+	}
+
+	if( Key == DeckLinkMediaOption::AudioOffset )
+	{
+		return FTimespan::FromMilliseconds( AudioOffset ).GetTicks();
+	}
+
+	if( Key == DeckLinkMediaOption::AudioSyncTolerance )
+	{
+		return FTimespan::FromMilliseconds( FMath::Max( AudioSyncTolerance, 0.0f ) ).GetTicks();
+	}
+
+	if( Key == DeckLinkMediaOption::AncillaryData )
+	{
+		return bCaptureAncillaryData ? 1 : 0;
+	}
+
+	if( Key == DeckLinkMediaOption::AncillaryFirstLine )
+	{
+		return AncillaryFirstLine;
+	}
+
+	if( Key == DeckLinkMediaOption::AncillaryLastLine )
+	{
+		return AncillaryLastLine;
+	}
+
+	return Super::GetMediaOption( Key, DefaultValue );
+}
+
+
+FString UDeckLinkMediaSource::GetMediaOption( const FName& Key, const FString& DefaultValue ) const
+{
+	if( Key == DeckLinkMediaOption::DisplayMode )
+	{
+		return DisplayMode;
+	}
+
+	if( Key == DeckLinkMediaOption::AudioChannelMap )
+	{
+		FString Map;
+		for( int32 Channel : AudioChannelMap )
+		{
+			Map += Map.IsEmpty() ? FString::FromInt( Channel ) : FString::Printf( TEXT( ",%d" ), Channel );
+		}
+		return Map;
+	}
+
+	if( Key == DeckLinkMediaOption::AncillaryFilter )
+	{
+		FString Filters;
+		for( const FDeckLinkMediaAncillaryFilter& Filter : AncillaryFilter )
+		{
+			if( !Filters.IsEmpty() )
+			{
+				Filters += TEXT( "," );
+			}
+			Filters += ( Filter.SDID < 0 ) ? FString::Printf( TEXT( "%02x" ), Filter.DID & 0xff ) : FString::Printf( TEXT( "%02x/%02x" ), Filter.DID & 0xff, Filter.SDID & 0xff );
+		}
+		return Filters;
+	}
+
+	return Super::GetMediaOption( Key, DefaultValue );
+}
+
+
+bool UDeckLinkMediaSource::HasMediaOption( const FName& Key ) const
+{
+	if( ( Key == DeckLinkMediaOption::DisplayMode ) || ( Key == DeckLinkMediaOption::QueueDepth ) || ( Key == DeckLinkMediaOption::QueuePolicy ) ||
+		( Key == DeckLinkMediaOption::AudioChannels ) || ( Key == DeckLinkMediaOption::AudioSampleType ) ||
+		( Key == DeckLinkMediaOption::AudioChannelMap ) || ( Key == DeckLinkMediaOption::AudioOffset ) ||
+		( Key == DeckLinkMediaOption::AudioSyncTolerance ) || ( Key == DeckLinkMediaOption::AncillaryData ) ||
+		( Key == DeckLinkMediaOption::AncillaryFilter ) || ( Key == DeckLinkMediaOption::AncillaryFirstLine ) ||
+		( Key == DeckLinkMediaOption::AncillaryLastLine ) )
+	{
+		return true;
+	}
+
+	return Super::HasMediaOption( Key );
+}
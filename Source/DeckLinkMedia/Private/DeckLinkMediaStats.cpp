@@ -0,0 +1,77 @@
+// Copyright 2017 The Mill, Inc. All Rights Reserved.
+
+#include "DeckLinkMediaPrivate.h"
+#include "DeckLinkMediaStats.h"
+
+#include "DeckLink/DecklinkDevice.h"
+
+DEFINE_STAT( STAT_DeckLinkMedia_FrameArrived );
+DEFINE_STAT( STAT_DeckLinkMedia_FormatChanged );
+DEFINE_STAT( STAT_DeckLinkMedia_ProcessFrame );
+DEFINE_STAT( STAT_DeckLinkMedia_ConvertFrame );
+DEFINE_STAT( STAT_DeckLinkMedia_ReadAncillary );
+DEFINE_STAT( STAT_DeckLinkMedia_ProcessAudio );
+DEFINE_STAT( STAT_DeckLinkMedia_TickVideo );
+DEFINE_STAT( STAT_DeckLinkMedia_UpdateTextureSink );
+DEFINE_STAT( STAT_DeckLinkMedia_DrainAudio );
+DEFINE_STAT( STAT_DeckLinkMedia_ConvertAudio );
+DEFINE_STAT( STAT_DeckLinkMedia_FramePoolMemory );
+DEFINE_STAT( STAT_DeckLinkMedia_CaptureBufferMemory );
+
+
+#if STATS
+
+namespace DeckLinkMediaStats
+{
+	TStatId CreateDeviceStat( int32 DeviceNumber, const TCHAR* Name )
+	{
+		return FDynamicStats::CreateStatId<FStatGroup_STATGROUP_DeckLinkMedia>( FString::Printf( TEXT( "Device %d: %s" ), DeviceNumber, Name ), false );
+	}
+
+	void SetDeviceStat( const TStatId& Stat, uint64 Value )
+	{
+		SET_DWORD_STAT_FName( Stat.GetName(), Value );
+	}
+}
+
+
+FDeckLinkMediaDeviceStats::FDeckLinkMediaDeviceStats( int32 DeviceNumber )
+	: FramesArrived( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Frames arrived" ) ) )
+	, FramesCaptured( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Frames captured" ) ) )
+	, FramesWithoutSignal( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Frames without signal" ) ) )
+	, DroppedByCard( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Dropped by card" ) ) )
+	, DroppedOnArrival( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Dropped on arrival" ) ) )
+	, DroppedByPool( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Dropped for lack of pool slots" ) ) )
+	, DroppedByQueue( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Dropped by queue" ) ) )
+	, QueuedFrames( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Queued frames" ) ) )
+	, PoolSlotsInUse( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Pool slots in use" ) ) )
+	, FramePoolBytes( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Frame pool bytes" ) ) )
+	, CaptureBufferBytes( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Capture buffer bytes" ) ) )
+	, BufferedAudioFrames( DeckLinkMediaStats::CreateDeviceStat( DeviceNumber, TEXT( "Buffered audio frames" ) ) )
+{ }
+
+
+void FDeckLinkMediaDeviceStats::Publish( const DeckLinkDevice& Device ) const
+{
+	using namespace DeckLinkMediaStats;
+
+	const DeckLinkCaptureStats& Capture = Device.GetCaptureStats();
+	SetDeviceStat( FramesArrived, Capture.GetArrivedFrames() );
+	SetDeviceStat( FramesCaptured, Capture.GetCapturedFrames() );
+	SetDeviceStat( FramesWithoutSignal, Capture.GetNoSignalFrames() );
+	SetDeviceStat( DroppedByCard, Capture.GetCardDroppedFrames() );
+	SetDeviceStat( DroppedOnArrival, Device.GetArrivalDropCount() );
+	SetDeviceStat( DroppedByPool, Capture.GetPoolExhaustedDrops() );
+
+	const DeckLinkFrameQueue& Queue = Device.GetFrameQueue();
+	SetDeviceStat( DroppedByQueue, Queue.GetOverwrittenCount() + Queue.GetDroppedOldestCount() + Queue.GetDroppedNewestCount() );
+	SetDeviceStat( QueuedFrames, Queue.Num() );
+
+	const DeckLinkFramePool& Pool = Device.GetFramePool();
+	SetDeviceStat( PoolSlotsInUse, Pool.GetSlotsInUse() );
+	SetDeviceStat( FramePoolBytes, Pool.GetAllocatedBytes() );
+	SetDeviceStat( CaptureBufferBytes, Device.GetCaptureAllocator().GetAllocatedBytes() );
+	SetDeviceStat( BufferedAudioFrames, Device.IsAudioEnabled() ? Device.GetAudioRing().GetAvailableFrames() : 0 );
+}
+
+#endif
@@ -0,0 +1,64 @@
+// Copyright 2017 The Mill, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+class DeckLinkDevice;
+
+DECLARE_STATS_GROUP( TEXT( "DeckLinkMedia" ), STATGROUP_DeckLinkMedia, STATCAT_Advanced );
+
+// capture side, on the driver callback and each device's processing thread
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Frame arrived callback" ), STAT_DeckLinkMedia_FrameArrived, STATGROUP_DeckLinkMedia, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Format changed callback" ), STAT_DeckLinkMedia_FormatChanged, STATGROUP_DeckLinkMedia, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Process frame" ), STAT_DeckLinkMedia_ProcessFrame, STATGROUP_DeckLinkMedia, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Convert frame" ), STAT_DeckLinkMedia_ConvertFrame, STATGROUP_DeckLinkMedia, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Read ancillary data" ), STAT_DeckLinkMedia_ReadAncillary, STATGROUP_DeckLinkMedia, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Process audio" ), STAT_DeckLinkMedia_ProcessAudio, STATGROUP_DeckLinkMedia, );
+
+// player side, on the game thread
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Tick video" ), STAT_DeckLinkMedia_TickVideo, STATGROUP_DeckLinkMedia, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Update texture sink" ), STAT_DeckLinkMedia_UpdateTextureSink, STATGROUP_DeckLinkMedia, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Drain audio" ), STAT_DeckLinkMedia_DrainAudio, STATGROUP_DeckLinkMedia, );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Convert audio" ), STAT_DeckLinkMedia_ConvertAudio, STATGROUP_DeckLinkMedia, );
+
+// memory of all devices together, the per device split is in FDeckLinkMediaDeviceStats
+DECLARE_MEMORY_STAT_EXTERN( TEXT( "Frame pool memory" ), STAT_DeckLinkMedia_FramePoolMemory, STATGROUP_DeckLinkMedia, );
+DECLARE_MEMORY_STAT_EXTERN( TEXT( "Capture buffer memory" ), STAT_DeckLinkMedia_CaptureBufferMemory, STATGROUP_DeckLinkMedia, );
+
+
+#if STATS
+
+/**
+ * Counters of one device in STATGROUP_DeckLinkMedia.
+ *
+ * Stats are normally declared at compile time, but the number of devices is
+ * only known once they arrive, so these are registered by name per device.
+ * They are cleared every frame and published by the player that owns the
+ * device from TickPlayer.
+ */
+class FDeckLinkMediaDeviceStats
+{
+public:
+	explicit FDeckLinkMediaDeviceStats( int32 DeviceNumber );
+
+	/** Copies the device's current counters into the stats system. */
+	void Publish( const DeckLinkDevice& Device ) const;
+
+private:
+	TStatId FramesArrived;
+	TStatId FramesCaptured;
+	TStatId FramesWithoutSignal;
+	TStatId DroppedByCard;
+	TStatId DroppedOnArrival;
+	TStatId DroppedByPool;
+	TStatId DroppedByQueue;
+	TStatId QueuedFrames;
+	TStatId PoolSlotsInUse;
+	TStatId FramePoolBytes;
+	TStatId CaptureBufferBytes;
+	TStatId BufferedAudioFrames;
+};
+
+#endif
@@ -2,30 +2,148 @@
 
 #include "DeckLinkMediaPrivate.h"
 #include "DeckLinkMediaPlayer.h"
+#include "DeckLinkMediaSource.h"
+#include "DeckLinkMediaFrameInfo.h"
+#include "DeckLinkMediaStats.h"
 
 #include "HAL/FileManager.h"
+#include "IMediaAudioSink.h"
 #include "IMediaOptions.h"
 #include "IMediaTextureSink.h"
 #include "IMediaBinarySink.h"
 #include "Misc/ScopeLock.h"
 
 #include "DeckLink/DecklinkDevice.h"
+#include "DeckLink/DeckLinkAudioConversion.h"
 
 
 #define LOCTEXT_NAMESPACE "FDeckLinkMediaPlayer"
 
 
+namespace DeckLinkMediaPlayer
+{
+	/** Metadata track indices, the ancillary track only exists while ancillary capture is on. */
+	const int32 FrameInfoTrack = 0;
+	const int32 AncillaryTrack = 1;
+
+	FDeckLinkMediaFrameInfo MakeFrameInfo(const DeckLinkFrameTimes& Times, const DeckLinkTimecodes& Timecodes, uint32 DroppedFrames)
+	{
+		FDeckLinkMediaFrameInfo Info;
+		FMemory::Memzero(Info);
+		Info.Version = FDeckLinkMediaFrameInfo::CurrentVersion;
+		Info.Size = sizeof(FDeckLinkMediaFrameInfo);
+		Info.Sequence = Times.sequence;
+		Info.StreamTime = Times.streamTime;
+		Info.StreamDuration = Times.streamDuration;
+		Info.HardwareTime = Times.hardwareTime;
+		Info.DroppedFrames = DroppedFrames;
+
+		if (DroppedFrames > 0)
+		{
+			Info.Flags |= EDeckLinkMediaFrameInfoFlags::FramesDropped;
+		}
+
+		// VITC1 is what most sources embed, LTC and VITC2 are the fallbacks
+		const DeckLinkTimecode* Timecode = Timecodes.rp188vitc1.valid ? &Timecodes.rp188vitc1
+			: Timecodes.rp188ltc.valid ? &Timecodes.rp188ltc
+			: Timecodes.rp188vitc2.valid ? &Timecodes.rp188vitc2
+			: nullptr;
+
+		if (Timecode != nullptr)
+		{
+			Info.Timecode = Timecode->bcd;
+			Info.TimecodeUserBits = Timecode->userBits;
+			Info.Flags |= EDeckLinkMediaFrameInfoFlags::HasTimecode;
+
+			if (Timecode->IsDropFrame())
+			{
+				Info.Flags |= EDeckLinkMediaFrameInfoFlags::DropFrameTimecode;
+			}
+
+			if (Timecode == &Timecodes.rp188ltc)
+			{
+				Info.Flags |= EDeckLinkMediaFrameInfoFlags::TimecodeFromLTC;
+			}
+		}
+
+		return Info;
+	}
+
+	DeckLinkPixelConversion::InstructionSet ToInstructionSet(EDeckLinkMediaInstructionSet InstructionSet)
+	{
+		switch (InstructionSet)
+		{
+		case EDeckLinkMediaInstructionSet::Scalar:
+			return DeckLinkPixelConversion::InstructionSet::Scalar;
+
+		case EDeckLinkMediaInstructionSet::SSE41:
+			return DeckLinkPixelConversion::InstructionSet::SSE41;
+
+		default:
+			return DeckLinkPixelConversion::InstructionSet::AVX2;
+		}
+	}
+
+	DeckLinkQueuePolicy ToQueuePolicy(int64 Policy)
+	{
+		switch ((EDeckLinkMediaQueuePolicy)Policy)
+		{
+		case EDeckLinkMediaQueuePolicy::DropOldest:
+			return DeckLinkQueuePolicy::DropOldest;
+
+		case EDeckLinkMediaQueuePolicy::DropNewest:
+			return DeckLinkQueuePolicy::DropNewest;
+
+		case EDeckLinkMediaQueuePolicy::Block:
+			return DeckLinkQueuePolicy::Block;
+
+		default:
+			return DeckLinkQueuePolicy::LatestOnly;
+		}
+	}
+
+	std::vector<DeckLinkAncillaryFilter> ParseAncillaryFilters(const FString& Filters)
+	{
+		TArray<FString> Entries;
+		Filters.ParseIntoArray(Entries, TEXT(","), true);
+
+		std::vector<DeckLinkAncillaryFilter> Result;
+		for (const FString& Entry : Entries)
+		{
+			FString Did, Sdid;
+			if (Entry.Split(TEXT("/"), &Did, &Sdid))
+			{
+				Result.push_back(DeckLinkAncillaryFilter((uint8)FParse::HexNumber(*Did.Trim()), (uint8)FParse::HexNumber(*Sdid.Trim())));
+			}
+			else
+			{
+				Result.push_back(DeckLinkAncillaryFilter((uint8)FParse::HexNumber(*Entry.Trim())));
+			}
+		}
+		return Result;
+	}
+}
+
+
 /* FDeckLinkMediaPlayer structors
  *****************************************************************************/
 
 FDeckLinkMediaPlayer::FDeckLinkMediaPlayer( const TMap<uint8, TUniquePtr<DeckLinkDevice>>* Devices )
-	: VideoSink( nullptr )
+	: AudioSink( nullptr )
+	, AudioInstructionSet( DeckLinkPixelConversion::InstructionSet::Scalar )
+	, AudioChannels( 0 )
+	, AudioSampleRate( 0 )
 	, BinarySink( nullptr )
+	, NextMetadataSequence( 0 )
+	, VideoSink( nullptr )
 	, SelectedAudioTrack( INDEX_NONE )
 	, SelectedMetadataTrack( INDEX_NONE )
 	, SelectedVideoTrack( INDEX_NONE )
 	, CurrentDim( FIntPoint::ZeroValue )
 	, CurrentFps( 0.0 )
+	, LastAudioConversionSeconds( 0.0 )
+	, LastAudioConversionFrames( 0 )
+	, PeakAudioConversionSeconds( 0.0 )
 	, DeviceMap( Devices )
 	, CurrentDeviceIndex( 0 )
 	, Paused( false )
@@ -143,12 +261,27 @@ void FDeckLinkMediaPlayer::Close()
 
 		CurrentFps = 0.0f;
 		CurrentState = EMediaState::Closed;
+		CurrentTime = FTimespan::Zero();
+		AudioChannels = 0;
+		AudioSampleRate = 0;
+		AudioChannelMap.Reset();
+		LastAudioConversionSeconds = 0.0;
+		LastAudioConversionFrames = 0;
+		PeakAudioConversionSeconds = 0.0;
+
+		if( AudioSink != nullptr )
+		{
+			AudioSink->FlushAudioSink();
+		}
+		LastLatency = FTimespan::Zero();
+		PeakLatency = FTimespan::Zero();
 		CurrentUrl.Empty();
 		CurrentDim = FIntPoint::ZeroValue;
 
 		SelectedAudioTrack = INDEX_NONE;
 		SelectedMetadataTrack = INDEX_NONE;
 		SelectedVideoTrack = INDEX_NONE;
+		NextMetadataSequence = 0;
 	}
 
 	MediaEvent.Broadcast(EMediaEvent::TracksChanged);
@@ -185,8 +318,77 @@ FString FDeckLinkMediaPlayer::GetStats() const
 {
 	FString StatsString;
 	{
-		StatsString += TEXT("not implemented yet");
-		StatsString += TEXT("\n");
+		const auto& Device = (*DeviceMap)[CurrentDeviceIndex];
+		if( Device )
+		{
+			const FIntPoint Size = Device->GetCurrentSize();
+			StatsString += FString::Printf(TEXT("%s (%dx%d, %.2f fps)\n"), UTF8_TO_TCHAR(DeckLinkDevice::GetDisplayModeString(Device->GetCurrentDisplayMode()).c_str()), Size.X, Size.Y, Device->GetCurrentFps());
+			StatsString += FString::Printf(TEXT("Converter: %s\n"), UTF8_TO_TCHAR(Device->GetConverterDescription().c_str()));
+
+			const DeckLinkCaptureStats& Capture = Device->GetCaptureStats();
+			const DeckLinkRollingTiming& Conversion = Capture.GetConversionTiming();
+			const DeckLinkRollingTiming& Processing = Capture.GetProcessingTiming();
+			StatsString += TEXT("Capture\n");
+			StatsString += FString::Printf(TEXT("    Frames: %llu arrived, %llu captured, %llu without signal\n"), Capture.GetArrivedFrames(), Capture.GetCapturedFrames(), Capture.GetNoSignalFrames());
+			StatsString += FString::Printf(TEXT("    Dropped by card: %llu\n"), Capture.GetCardDroppedFrames());
+			StatsString += FString::Printf(TEXT("    Dropped on arrival: %llu\n"), Device->GetArrivalDropCount());
+			StatsString += FString::Printf(TEXT("    Dropped for lack of pool slots: %llu\n"), Capture.GetPoolExhaustedDrops());
+			StatsString += FString::Printf(TEXT("    Conversion failures: %llu\n"), Capture.GetConversionFailures());
+			StatsString += FString::Printf(TEXT("    Conversion: %lld / %lld / %lld us min / avg / max (peak %lld us)\n"), Conversion.GetMin(), Conversion.GetAverage(), Conversion.GetMax(), Conversion.GetPeak());
+			StatsString += FString::Printf(TEXT("    Arrival to queue: %lld / %lld / %lld us min / avg / max (peak %lld us)\n"), Processing.GetMin(), Processing.GetAverage(), Processing.GetMax(), Processing.GetPeak());
+			StatsString += FString::Printf(TEXT("Capture to sink latency: %.2f ms (peak %.2f ms)\n"), LastLatency.GetTotalMilliseconds(), PeakLatency.GetTotalMilliseconds());
+
+			const DeckLinkLatency& Latency = Device->GetLatency();
+			StatsString += TEXT("Latency (p50 / p99 / max us)\n");
+			for( int32 Stage = 0; Stage < (int32)DeckLinkLatencyStage::Count; ++Stage )
+			{
+				const DeckLinkLatencyHistogram& Histogram = Latency.Get( (DeckLinkLatencyStage)Stage );
+				StatsString += FString::Printf(TEXT("    %s: %lld / %lld / %lld\n"), UTF8_TO_TCHAR(DeckLinkLatency::GetStageName( (DeckLinkLatencyStage)Stage )), Histogram.GetPercentile( 0.5 ), Histogram.GetPercentile( 0.99 ), Histogram.GetMax());
+			}
+
+			const DeckLinkMemoryAllocator& Allocator = Device->GetCaptureAllocator();
+			StatsString += TEXT("Capture buffers\n");
+			StatsString += FString::Printf(TEXT("    In use: %u / %u\n"), Allocator.GetBuffersInUse(), Allocator.GetBufferCount());
+			StatsString += FString::Printf(TEXT("    Misses: %llu\n"), Allocator.GetMissCount());
+			StatsString += FString::Printf(TEXT("    Allocated: %.1f MB\n"), Allocator.GetAllocatedBytes() / (1024.0 * 1024.0));
+
+			if( AudioChannels > 0 )
+			{
+				const DeckLinkAudioRing& Ring = Device->GetAudioRing();
+				StatsString += FString::Printf(TEXT("Audio (%u channels, %u Hz)\n"), AudioChannels, AudioSampleRate);
+				StatsString += FString::Printf(TEXT("    Buffered: %u / %u frames\n"), Ring.GetAvailableFrames(), Ring.GetCapacityFrames());
+				StatsString += FString::Printf(TEXT("    Dropped: %llu packets (%llu frames)\n"), Ring.GetDroppedPackets(), Ring.GetDroppedFrames());
+				const DeckLinkAvSync& Sync = Device->GetAudioSync();
+				StatsString += FString::Printf(TEXT("    Sync: %s, offset %.1f ms, last error %.1f ms (tolerance %.1f ms)\n"), VideoSink ? TEXT("locked to video") : TEXT("free running"), FTimespan(Sync.GetOffset()).GetTotalMilliseconds(), FTimespan(Sync.GetLastError()).GetTotalMilliseconds(), FTimespan(Sync.GetTolerance()).GetTotalMilliseconds());
+				StatsString += FString::Printf(TEXT("    Resyncs: %llu (%llu frames dropped)\n"), Sync.GetCorrectionCount(), Sync.GetSkippedFrames());
+				StatsString += FString::Printf(TEXT("    Conversion: %.1f us for %u frames (peak %.1f us, %s)\n"), LastAudioConversionSeconds * 1000000.0, LastAudioConversionFrames, PeakAudioConversionSeconds * 1000000.0, UTF8_TO_TCHAR(DeckLinkPixelConversion::GetInstructionSetName(AudioInstructionSet)));
+			}
+
+			if( Device->IsAncillaryCaptureEnabled() )
+			{
+				const DeckLinkAncillaryReader& Reader = Device->GetAncillaryReader();
+				StatsString += FString::Printf(TEXT("Ancillary data (%d filters)\n"), (int32)Reader.GetFilters().size());
+				StatsString += FString::Printf(TEXT("    Packets: %llu (%llu filtered out)\n"), Reader.GetPacketCount(), Reader.GetFilteredCount());
+				StatsString += FString::Printf(TEXT("    Checksum errors: %llu\n"), Reader.GetChecksumErrorCount());
+				StatsString += FString::Printf(TEXT("    Buffer overflows: %llu\n"), Reader.GetOverflowCount());
+			}
+
+			const DeckLinkFramePool& Pool = Device->GetFramePool();
+			StatsString += TEXT("Frame pool\n");
+			StatsString += FString::Printf(TEXT("    Slots in use: %u / %u (peak %u)\n"), Pool.GetSlotsInUse(), Pool.GetDepth(), Pool.GetPeakSlotsInUse());
+			StatsString += FString::Printf(TEXT("    Exhausted: %llu\n"), Pool.GetExhaustedCount());
+			StatsString += FString::Printf(TEXT("    Reallocations: %llu\n"), Pool.GetReallocationCount());
+			StatsString += FString::Printf(TEXT("    Allocated: %.1f MB\n"), Pool.GetAllocatedBytes() / (1024.0 * 1024.0));
+
+			static const TCHAR* PolicyNames[] = { TEXT("LatestOnly"), TEXT("DropOldest"), TEXT("DropNewest"), TEXT("Block") };
+			const DeckLinkFrameQueue& Queue = Device->GetFrameQueue();
+			StatsString += FString::Printf(TEXT("Frame queue (%s)\n"), PolicyNames[(int32)Queue.GetPolicy()]);
+			StatsString += FString::Printf(TEXT("    Queued: %u / %u\n"), Queue.Num(), Queue.GetDepth());
+			StatsString += FString::Printf(TEXT("    Pushed: %llu, popped: %llu\n"), Queue.GetPushedCount(), Queue.GetPoppedCount());
+			StatsString += FString::Printf(TEXT("    Overwritten: %llu\n"), Queue.GetOverwrittenCount());
+			StatsString += FString::Printf(TEXT("    Dropped oldest: %llu, dropped newest: %llu\n"), Queue.GetDroppedOldestCount(), Queue.GetDroppedNewestCount());
+			StatsString += FString::Printf(TEXT("    Blocked: %llu (%.1f ms)\n"), Queue.GetBlockedCount(), Queue.GetBlockedMicroseconds() / 1000.0);
+		}
 	}
 
 	return StatsString;
@@ -214,18 +416,58 @@ bool FDeckLinkMediaPlayer::Open( const FString& Url, const IMediaOptions& Option
 
 	const TCHAR* DeviceNumberStr = &Url[12];
 	auto NewIndex = FCString::Atoi( DeviceNumberStr ) - 1;
-	if( NewIndex < 0 || NewIndex >= DeviceMap->Num() ) {
+	// device keys are not contiguous, virtual devices start after the cards' range
+	const TUniquePtr<DeckLinkDevice>* NewDevice = ( NewIndex >= 0 && NewIndex <= MAX_uint8 ) ? DeviceMap->Find( (uint8)NewIndex ) : nullptr;
+	if( NewDevice == nullptr ) {
 		UE_LOG( LogDeckLinkMedia, Error, TEXT( "Invalid device id." ) );
 		return false;
 	}
+	if( ! (*NewDevice)->IsValid() ) {
+		UE_LOG( LogDeckLinkMedia, Error, TEXT( "Device %d cannot capture." ), NewIndex + 1 );
+		return false;
+	}
 	CurrentDeviceIndex = NewIndex;
 
 	Close();
 
 	const auto& Device = (*DeviceMap)[CurrentDeviceIndex];
-	auto Mode = BMDDisplayMode::bmdModeHD1080p2398;
+	const UDeckLinkMediaSettings* Settings = GetDefault<UDeckLinkMediaSettings>();
+	Device->SetFramePoolDepth( Settings->FramePoolDepth );
+
+	const int64 QueueDepth = Options.GetMediaOption( DeckLinkMediaOption::QueueDepth, (int64)1 );
+	const int64 QueuePolicy = Options.GetMediaOption( DeckLinkMediaOption::QueuePolicy, (int64)EDeckLinkMediaQueuePolicy::LatestOnly );
+	Device->SetFrameQueue( (uint32)FMath::Clamp<int64>( QueueDepth, 1, DeckLinkFrameQueue::MaxDepth ), DeckLinkMediaPlayer::ToQueuePolicy( QueuePolicy ) );
+
+	const int64 Channels = Options.GetMediaOption( DeckLinkMediaOption::AudioChannels, (int64)2 );
+	const int64 SampleType = Options.GetMediaOption( DeckLinkMediaOption::AudioSampleType, (int64)EDeckLinkMediaAudioSampleType::Int16 );
+	Device->SetAudioInput( (uint32)FMath::Max<int64>( Channels, 0 ), ((EDeckLinkMediaAudioSampleType)SampleType == EDeckLinkMediaAudioSampleType::Int32) ? DeckLinkAudioSampleType::Int32 : DeckLinkAudioSampleType::Int16 );
+	Device->SetAudioSync( Options.GetMediaOption( DeckLinkMediaOption::AudioOffset, (int64)0 ), Options.GetMediaOption( DeckLinkMediaOption::AudioSyncTolerance, (int64)DeckLinkAvSync::DefaultTolerance ) );
+
+	const int64 FirstLine = Options.GetMediaOption( DeckLinkMediaOption::AncillaryFirstLine, (int64)DeckLinkAncillaryReader::DefaultFirstLine );
+	const int64 LastLine = Options.GetMediaOption( DeckLinkMediaOption::AncillaryLastLine, (int64)DeckLinkAncillaryReader::DefaultLastLine );
+	Device->SetAncillaryCapture( Options.GetMediaOption( DeckLinkMediaOption::AncillaryData, (int64)0 ) != 0,
+		DeckLinkMediaPlayer::ParseAncillaryFilters( Options.GetMediaOption( DeckLinkMediaOption::AncillaryFilter, FString() ) ),
+		(uint32)FMath::Max<int64>( FirstLine, 1 ), (uint32)FMath::Max<int64>( LastLine, 1 ) );
+
+	DeckLinkConverterSettings ConverterSettings;
+	ConverterSettings.type = (Settings->Converter == EDeckLinkMediaConverter::Sdk) ? DeckLinkConverterType::Sdk : DeckLinkConverterType::Native;
+	ConverterSettings.instructionSet = DeckLinkMediaPlayer::ToInstructionSet( Settings->ConverterInstructionSet );
+	ConverterSettings.workerThreads = FMath::Max( Settings->ConversionWorkerThreads, 0 );
+	ConverterSettings.parallelMinHeight = Settings->ParallelConversionMinHeight;
+	Device->SetConverter( ConverterSettings );
+
+	BMDDisplayMode Mode = BMDDisplayMode::bmdModeHD1080p2398;
+	const FString ModeName = Options.GetMediaOption( DeckLinkMediaOption::DisplayMode, FString() );
+	if( ! ModeName.IsEmpty() && ! DeckLinkDevice::FindDisplayMode( TCHAR_TO_UTF8( *ModeName ), Mode ) )
+	{
+		UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Unknown display mode %s, capturing %s." ), *ModeName, UTF8_TO_TCHAR( DeckLinkDevice::GetDisplayModeString( Mode ).c_str() ) );
+	}
 	Device->Start( Mode );
 
+#if STATS
+	DeviceStats = MakeUnique<FDeckLinkMediaDeviceStats>( CurrentDeviceIndex + 1 );
+#endif
+
 	// finalize
 	{
 		FScopeLock Lock(&CriticalSection);
@@ -233,6 +475,45 @@ bool FDeckLinkMediaPlayer::Open( const FString& Url, const IMediaOptions& Option
 		CurrentFps = Device->GetCurrentFps();
 		CurrentState = EMediaState::Stopped;
 		CurrentUrl = Url;
+
+		// ancillary packets keep going to the metadata sink when they are captured, until another track is selected
+		SelectedMetadataTrack = Device->IsAncillaryCaptureEnabled() ? DeckLinkMediaPlayer::AncillaryTrack : DeckLinkMediaPlayer::FrameInfoTrack;
+
+		AudioChannels = Device->GetAudioChannels();
+		AudioSampleRate = Device->GetAudioSampleRate();
+		AudioInstructionSet = DeckLinkPixelConversion::ResolveInstructionSet( ConverterSettings.instructionSet );
+		if( AudioChannels > 0 )
+		{
+			// captured audio plays until its track is deselected
+			SelectedAudioTrack = 0;
+
+			const DeckLinkAudioRing& Ring = Device->GetAudioRing();
+			AudioBuffer.SetNumUninitialized( Ring.GetCapacityFrames() * Ring.GetFrameBytes() );
+
+			TArray<FString> MapEntries;
+			Options.GetMediaOption( DeckLinkMediaOption::AudioChannelMap, FString() ).ParseIntoArray( MapEntries, TEXT( "," ), true );
+			for( const FString& Entry : MapEntries )
+			{
+				int32 Channel = FCString::Atoi( *Entry );
+				if( Channel >= (int32)AudioChannels )
+				{
+					UE_LOG( LogDeckLinkMedia, Warning, TEXT( "Audio channel map entry %d is out of range, only %u channels are captured." ), Channel, AudioChannels );
+					Channel = -1;
+				}
+				AudioChannelMap.Add( FMath::Max( Channel, -1 ) );
+			}
+
+			if( AudioChannelMap.Num() > 0 )
+			{
+				AudioChannels = AudioChannelMap.Num();
+				AudioRemapBuffer.SetNumUninitialized( Ring.GetCapacityFrames() * AudioChannels * GetAudioSampleBytes( Ring.GetSampleType() ) );
+			}
+
+			if( AudioSink != nullptr )
+			{
+				AudioSink->InitializeAudioSink( AudioChannels, AudioSampleRate );
+			}
+		}
 	}
 
 	// notify listeners
@@ -251,32 +532,144 @@ bool FDeckLinkMediaPlayer::Open(const TSharedRef<FArchive, ESPMode::ThreadSafe>&
 
 void FDeckLinkMediaPlayer::TickPlayer(float DeltaTime)
 {
+#if STATS
+	if( DeviceStats.IsValid() && CurrentState != EMediaState::Closed )
+	{
+		DeviceStats->Publish( *(*DeviceMap)[CurrentDeviceIndex] );
+	}
+#endif
+
+	// with a video sink the audio goes out together with its frame in TickVideo
+	if( VideoSink == nullptr )
+	{
+		DrainAudio( nullptr );
+	}
+}
+
+
+void FDeckLinkMediaPlayer::DrainAudio( const DeckLinkFrameTimes* VideoTimes )
+{
+	SCOPE_CYCLE_COUNTER( STAT_DeckLinkMedia_DrainAudio );
+
+	// runs off the game thread too, and Close resets the ring, the channel map and the sink under the same lock
+	FScopeLock Lock( &CriticalSection );
+
+	if( Paused || ! AudioSink || AudioChannels == 0 )
+		return;
+
+	const auto& Device = (*DeviceMap)[CurrentDeviceIndex];
+	const DeckLinkAudioRing& Ring = Device->GetAudioRing();
+	const uint32 MaxFrames = AudioBuffer.Num() / Ring.GetFrameBytes();
+
+	int64_t AudioTime = 0;
+	const uint32 Frames = Device->ReadAudio( AudioBuffer.GetData(), MaxFrames, VideoTimes, AudioTime );
+
+	// a deselected track still drains the ring, so selecting it again starts from live audio
+	if( Frames == 0 || SelectedAudioTrack == INDEX_NONE )
+		return;
+
+	const double StartSeconds = FPlatformTime::Seconds();
+
+	uint8* Samples = AudioBuffer.GetData();
+	{
+		SCOPE_CYCLE_COUNTER( STAT_DeckLinkMedia_ConvertAudio );
+
+		if( AudioChannelMap.Num() > 0 ) {
+			DeckLinkAudioConversion::RemapChannels( Samples, Ring.GetChannels(), AudioRemapBuffer.GetData(), AudioChannelMap.GetData(), AudioChannels, Frames, Ring.GetSampleType(), AudioInstructionSet );
+			Samples = AudioRemapBuffer.GetData();
+		}
+
+		// the sink takes 16-bit PCM, converted in place
+		DeckLinkAudioConversion::ConvertToInt16( Samples, Ring.GetSampleType(), (int16_t*)Samples, Frames * AudioChannels, AudioInstructionSet );
+	}
+
+	LastAudioConversionSeconds = FPlatformTime::Seconds() - StartSeconds;
+	LastAudioConversionFrames = Frames;
+	PeakAudioConversionSeconds = FMath::Max( PeakAudioConversionSeconds, LastAudioConversionSeconds );
+
+	AudioSink->PlayAudioSink( Samples, Frames * AudioChannels * sizeof( int16 ), FTimespan( AudioTime ) );
 }
 
 
 void FDeckLinkMediaPlayer::TickVideo(float DeltaTime)
 {
-	QUICK_SCOPE_CYCLE_COUNTER( STAT_DeckLinkMediaPlayer_TickVideo );
+	SCOPE_CYCLE_COUNTER( STAT_DeckLinkMedia_TickVideo );
 
 	if( Paused || ! VideoSink )
 		return;
 
-	DeckLinkDevice::VideoFrameBGRA frame;
-	auto newFrame = (*DeviceMap)[CurrentDeviceIndex]->GetFrame( &frame );
-	if( newFrame ) {
-		auto LastBufferDim = FIntPoint( frame.GetWidth(), frame.GetHeight() );
+	// the handle keeps the pool slot alive until the sink has copied it
+	const auto& Device = (*DeviceMap)[CurrentDeviceIndex];
+	DeckLinkFrameRef frame = Device->GetFrame();
+	if( frame.IsValid() ) {
+		const int64 PickupTime = DeckLinkLatency::Now();
+		const DeckLinkStageTimes& StageTimes = frame->GetStageTimes();
+		const uint32 TraceId = Device->GetTraceId();
+		DeckLinkLatency& Latency = Device->GetLatency();
+		Latency.Record( DeckLinkLatencyStage::QueueWait, StageTimes.queued, PickupTime );
+
+		auto LastBufferDim = FIntPoint( frame->GetWidth(), frame->GetHeight() );
 		auto LastVideoDim = LastBufferDim;
-		FScopeLock Lock( &CriticalSection );
-		if( VideoSink->GetTextureSinkDimensions() != LastVideoDim ) {
-			if( !VideoSink->InitializeTextureSink( LastVideoDim, LastBufferDim, EMediaTextureSinkFormat::CharBGRA, EMediaTextureSinkMode::Unbuffered ) ) {
-				return;
+		const DeckLinkFrameTimes& Times = frame->GetTimes();
+		DeckLinkTrace::Record( DeckLinkTraceEvent::Dequeue, TraceId, Times.sequence );
+		{
+			FScopeLock Lock( &CriticalSection );
+			if( VideoSink->GetTextureSinkDimensions() != LastVideoDim ) {
+				if( !VideoSink->InitializeTextureSink( LastVideoDim, LastBufferDim, EMediaTextureSinkFormat::CharBGRA, EMediaTextureSinkMode::Unbuffered ) ) {
+					return;
+				}
+			}
+			const int64 UploadStart = DeckLinkLatency::Now();
+			{
+				SCOPE_CYCLE_COUNTER( STAT_DeckLinkMedia_UpdateTextureSink );
+				DeckLinkTrace::Record( DeckLinkTraceEvent::UploadBegin, TraceId, Times.sequence );
+				VideoSink->UpdateTextureSinkBuffer( frame->data(), frame->GetRowBytes() );
+				DeckLinkTrace::Record( DeckLinkTraceEvent::UploadEnd, TraceId, Times.sequence );
+			}
+			const int64 UploadEnd = DeckLinkLatency::Now();
+			Latency.Record( DeckLinkLatencyStage::Upload, UploadStart, UploadEnd );
+			Latency.Record( DeckLinkLatencyStage::Total, StageTimes.arrival, UploadEnd );
+			VideoSink->DisplayTextureSinkBuffer( FTimespan( Times.streamTime ) );
+			DeckLinkTrace::Record( DeckLinkTraceEvent::Display, TraceId, Times.sequence );
+			CurrentTime = FTimespan( Times.streamTime );
+
+			int64_t HardwareNow = 0;
+			if( Times.hardwareTime != 0 && Device->GetHardwareReferenceTime( HardwareNow ) ) {
+				LastLatency = FTimespan( HardwareNow - Times.hardwareTime );
+				PeakLatency = FMath::Max( PeakLatency, LastLatency );
 			}
+
+			SendMetadata( *frame );
 		}
-		VideoSink->UpdateTextureSinkBuffer( frame.data(), frame.GetRowBytes() );
-		VideoSink->DisplayTextureSinkBuffer( FTimespan{} );
+
+		// release the audio captured alongside this frame, so both reach their sinks together
+		DrainAudio( &Times );
 	}
+}
+
 
-	CurrentTime += DeltaTime;
+void FDeckLinkMediaPlayer::SendMetadata( const DeckLinkVideoFrame& Frame )
+{
+	const DeckLinkFrameTimes& Times = Frame.GetTimes();
+
+	// frames the queue or the callback dropped show up as a gap in the sequence
+	const uint64 Dropped = ( Times.sequence > NextMetadataSequence ) ? Times.sequence - NextMetadataSequence : 0;
+	NextMetadataSequence = Times.sequence + 1;
+
+	if( ! BinarySink )
+		return;
+
+	if( SelectedMetadataTrack == DeckLinkMediaPlayer::FrameInfoTrack ) {
+		const FDeckLinkMediaFrameInfo FrameInfo = DeckLinkMediaPlayer::MakeFrameInfo( Times, Frame.GetTimecodes(), (uint32)FMath::Min<uint64>( Dropped, MAX_uint32 ) );
+		BinarySink->ProcessBinarySinkData( (const uint8*)&FrameInfo, sizeof( FrameInfo ), FTimespan( Times.streamTime ), FTimespan( Times.streamDuration ) );
+	}
+	else if( SelectedMetadataTrack == DeckLinkMediaPlayer::AncillaryTrack ) {
+		// the packets stay in the frame's own buffer, valid for as long as the frame is held
+		const DeckLinkAncillaryBuffer& Ancillary = Frame.GetAncillaryPackets();
+		if( Ancillary.GetPacketCount() > 0 ) {
+			BinarySink->ProcessBinarySinkData( Ancillary.GetData(), (uint32)Ancillary.GetSize(), FTimespan( Times.streamTime ), FTimespan( Times.streamDuration ) );
+		}
+	}
 }
 
 
@@ -285,7 +678,24 @@ void FDeckLinkMediaPlayer::TickVideo(float DeltaTime)
 
 void FDeckLinkMediaPlayer::SetAudioSink(IMediaAudioSink* Sink)
 {
-	// not supported
+	if( Sink == AudioSink )
+	{
+		return;
+	}
+
+	FScopeLock Lock( &CriticalSection );
+
+	if( AudioSink != nullptr )
+	{
+		AudioSink->ShutdownAudioSink();
+	}
+
+	AudioSink = Sink;
+
+	if( ( Sink != nullptr ) && ( AudioChannels > 0 ) )
+	{
+		Sink->InitializeAudioSink( AudioChannels, AudioSampleRate );
+	}
 }
 
 
@@ -346,13 +756,13 @@ void FDeckLinkMediaPlayer::SetVideoSink(IMediaTextureSink* Sink)
 
 uint32 FDeckLinkMediaPlayer::GetAudioTrackChannels(int32 TrackIndex) const
 {
-	return 0; // not supported
+	return (TrackIndex == 0) ? AudioChannels : 0;
 }
 
 
 uint32 FDeckLinkMediaPlayer::GetAudioTrackSampleRate(int32 TrackIndex) const
 {
-	return 0; // not supported
+	return (TrackIndex == 0) ? AudioSampleRate : 0;
 }
 
 
@@ -364,6 +774,16 @@ int32 FDeckLinkMediaPlayer::GetNumTracks(EMediaTrackType TrackType) const
 		{
 			return 1;
 		}
+
+		if ((TrackType == EMediaTrackType::Audio) && (AudioChannels > 0))
+		{
+			return 1;
+		}
+
+		if ((TrackType == EMediaTrackType::Metadata) && (CurrentState != EMediaState::Closed))
+		{
+			return (*DeviceMap)[CurrentDeviceIndex]->IsAncillaryCaptureEnabled() ? 2 : 1;
+		}
 	}
 
 	return 0;
@@ -379,8 +799,12 @@ int32 FDeckLinkMediaPlayer::GetSelectedTrack(EMediaTrackType TrackType) const
 
 	switch( TrackType )
 	{
-	case EMediaTrackType::Audio:
 	case EMediaTrackType::Metadata:
+		return SelectedMetadataTrack;
+
+	case EMediaTrackType::Audio:
+		return ( AudioChannels > 0 ) ? SelectedAudioTrack : INDEX_NONE;
+
 	case EMediaTrackType::Video:
 		return 0;
 
@@ -392,6 +816,11 @@ int32 FDeckLinkMediaPlayer::GetSelectedTrack(EMediaTrackType TrackType) const
 
 FText FDeckLinkMediaPlayer::GetTrackDisplayName(EMediaTrackType TrackType, int32 TrackIndex) const
 {
+	if( (TrackType == EMediaTrackType::Metadata) && (TrackIndex == DeckLinkMediaPlayer::AncillaryTrack) && (GetNumTracks(TrackType) > TrackIndex) )
+	{
+		return LOCTEXT( "AncillaryMetadataTrackName", "Ancillary Data" );
+	}
+
 	if( (*DeviceMap)[CurrentDeviceIndex] == nullptr || (TrackIndex != 0) )
 	{
 		return FText::GetEmpty();
@@ -403,7 +832,7 @@ FText FDeckLinkMediaPlayer::GetTrackDisplayName(EMediaTrackType TrackType, int32
 		return LOCTEXT( "DefaultAudioTrackName", "Audio Track" );
 
 	case EMediaTrackType::Metadata:
-		return LOCTEXT( "DefaultMetadataTrackName", "Metadata Track" );
+		return LOCTEXT( "FrameInfoMetadataTrackName", "Frame Info" );
 
 	case EMediaTrackType::Video:
 		return LOCTEXT( "DefaultVideoTrackName", "Video Track" );
@@ -464,6 +893,19 @@ float FDeckLinkMediaPlayer::GetVideoTrackFrameRate(int32 TrackIndex) const
 
 bool FDeckLinkMediaPlayer::SelectTrack(EMediaTrackType TrackType, int32 TrackIndex)
 {
+	if (TrackType == EMediaTrackType::Metadata)
+	{
+		if ((TrackIndex != INDEX_NONE) && ((TrackIndex < 0) || (TrackIndex >= GetNumTracks(TrackType))))
+		{
+			return false;
+		}
+
+		FScopeLock Lock(&CriticalSection);
+		SelectedMetadataTrack = TrackIndex;
+
+		return true;
+	}
+
 	if ((TrackIndex != INDEX_NONE) && (TrackIndex != 0))
 	{
 		return false;
@@ -473,6 +915,10 @@ bool FDeckLinkMediaPlayer::SelectTrack(EMediaTrackType TrackType, int32 TrackInd
 	{
 		SelectedVideoTrack = TrackIndex;
 	}
+	else if (TrackType == EMediaTrackType::Audio)
+	{
+		SelectedAudioTrack = TrackIndex;
+	}
 	else
 	{
 		return false;
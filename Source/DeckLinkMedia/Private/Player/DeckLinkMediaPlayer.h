@@ -9,6 +9,14 @@
 #include "IMediaTracks.h"
 
 class DeckLinkDevice;
+class FDeckLinkMediaDeviceStats;
+class DeckLinkVideoFrame;
+struct DeckLinkFrameTimes;
+
+namespace DeckLinkPixelConversion
+{
+	enum class InstructionSet;
+}
 
 /**
  * Implements a media player EXR image sequences.
@@ -93,9 +101,45 @@ public:
 
 private:
 
-	/** The currently used video sink. */
+	/**
+	 * Moves captured audio from the device to the audio sink: the audio that
+	 * belongs with the given frame, or without one everything that has arrived.
+	 */
+	void DrainAudio( const DeckLinkFrameTimes* VideoTimes );
+
+	/** Sends the selected metadata track's data for the given frame to the metadata sink. */
+	void SendMetadata( const DeckLinkVideoFrame& Frame );
+
+private:
+
+	/** The currently used audio sink. */
+	IMediaAudioSink* AudioSink;
+
+	/** Scratch buffer audio is read into and converted in, sized once per Open. */
+	TArray<uint8> AudioBuffer;
+
+	/** Holds the sink's channels picked out of AudioBuffer when a channel map is set. */
+	TArray<uint8> AudioRemapBuffer;
+
+	/** Captured channel for each sink channel, empty to pass every captured channel through. */
+	TArray<int32> AudioChannelMap;
+
+	/** Instruction set the audio kernels run with. */
+	DeckLinkPixelConversion::InstructionSet AudioInstructionSet;
+
+	/** Audio channels sent to the audio sink, 0 if audio is off. */
+	uint32 AudioChannels;
+
+	/** Audio sample rate captured by the device. */
+	uint32 AudioSampleRate;
+
+	/** The currently used metadata sink. */
 	IMediaBinarySink* BinarySink;
 
+	/** Sequence number the next frame sent to the metadata sink has if none were dropped. */
+	uint64 NextMetadataSequence;
+
+	/** The currently used video sink. */
 	IMediaTextureSink* VideoSink;
 private:
 
@@ -125,9 +169,22 @@ private:
 	/** Current state of the media player. */
 	EMediaState CurrentState;
 
-	/** The current time of the playback. */
+	/** Stream time of the last frame handed to the video sink, on the capture clock. */
 	FTimespan CurrentTime;
 
+	/** Time from capture on the card's hardware clock to the frame reaching the video sink. */
+	FTimespan LastLatency;
+
+	/** Highest LastLatency since the media was opened. */
+	FTimespan PeakLatency;
+
+	/** Time spent remapping and converting the last block of audio, and the number of sample frames in it. */
+	double LastAudioConversionSeconds;
+	uint32 LastAudioConversionFrames;
+
+	/** Highest time spent converting one block of audio since the media was opened. */
+	double PeakAudioConversionSeconds;
+
 	/** The URL of the currently opened media. */
 	FString CurrentUrl;
 
@@ -148,4 +205,9 @@ private:
 
 	const TMap<uint8, TUniquePtr<DeckLinkDevice>> *			DeviceMap;
 	int32													CurrentDeviceIndex;
+
+#if STATS
+	/** Per device counters published to STATGROUP_DeckLinkMedia every tick. */
+	TUniquePtr<FDeckLinkMediaDeviceStats>					DeviceStats;
+#endif
 };
@@ -0,0 +1,72 @@
+// Copyright 2017 The Mill, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/** Bits of FDeckLinkMediaFrameInfo::Flags. */
+namespace EDeckLinkMediaFrameInfoFlags
+{
+	enum Type : uint32
+	{
+		/** Timecode holds a valid RP188 timecode. */
+		HasTimecode = 1 << 0,
+
+		/** The timecode is drop frame. */
+		DropFrameTimecode = 1 << 1,
+
+		/** The timecode was read from RP188 LTC rather than RP188 VITC. */
+		TimecodeFromLTC = 1 << 2,
+
+		/** Captured frames were dropped since the previous record, DroppedFrames tells how many. */
+		FramesDropped = 1 << 3,
+	};
+}
+
+
+/**
+ * Fixed-size record sent to the metadata sink for every frame on the frame
+ * info metadata track, at the frame's stream time.
+ *
+ * The layout is naturally aligned and little-endian, so a receiver can cast
+ * the sink data straight to this struct after checking Version and Size.
+ */
+struct FDeckLinkMediaFrameInfo
+{
+	static const uint16 CurrentVersion = 1;
+
+	/** Layout version, CurrentVersion when written. */
+	uint16 Version;
+
+	/** sizeof(FDeckLinkMediaFrameInfo) when written. */
+	uint16 Size;
+
+	/** EDeckLinkMediaFrameInfoFlags bits. */
+	uint32 Flags;
+
+	/** Number of the frame among all frames the card delivered since the media was opened. */
+	uint64 Sequence;
+
+	/** Capture time on the input's stream clock, in FTimespan ticks. */
+	int64 StreamTime;
+
+	/** Frame duration on the stream clock, in FTimespan ticks. */
+	int64 StreamDuration;
+
+	/** Capture time on the card's hardware reference clock, in FTimespan ticks, 0 if unavailable. */
+	int64 HardwareTime;
+
+	/** RP188 timecode as packed BCD, 0xHHMMSSFF. */
+	uint32 Timecode;
+
+	/** RP188 user bits. */
+	uint32 TimecodeUserBits;
+
+	/** Frames captured but never sent to the sink since the previous record. */
+	uint32 DroppedFrames;
+
+	uint32 Reserved;
+};
+
+static_assert(sizeof(FDeckLinkMediaFrameInfo) == 56, "FDeckLinkMediaFrameInfo layout must not change without bumping CurrentVersion");
@@ -11,6 +11,107 @@
 #include "DeckLinkMediaSource.generated.h"
 
 
+/** What the capture queue does when the player falls behind. */
+UENUM(BlueprintType)
+enum class EDeckLinkMediaQueuePolicy : uint8
+{
+	/** Only keep the newest frame (lowest latency, QueueDepth is ignored). */
+	LatestOnly,
+
+	/** Discard the oldest queued frame to make room for a new one. */
+	DropOldest,
+
+	/** Discard new frames until there is room in the queue. */
+	DropNewest,
+
+	/** Hold back capture processing until there is room (no queue drops, latency grows). */
+	Block,
+};
+
+
+/** Embedded SDI audio channels to capture. */
+UENUM(BlueprintType)
+enum class EDeckLinkMediaAudioChannels : uint8
+{
+	Disabled,
+	Stereo UMETA(DisplayName="2 Channels"),
+	Eight UMETA(DisplayName="8 Channels"),
+	Sixteen UMETA(DisplayName="16 Channels"),
+};
+
+
+/** Sample format the card delivers audio in. */
+UENUM(BlueprintType)
+enum class EDeckLinkMediaAudioSampleType : uint8
+{
+	/** 16-bit integer, played back as is. */
+	Int16,
+
+	/** 32-bit integer, reduced to 16 bits for playback. */
+	Int32,
+};
+
+
+/** Selects ancillary packets by their SMPTE 291 data identifiers. */
+USTRUCT(BlueprintType)
+struct FDeckLinkMediaAncillaryFilter
+{
+	GENERATED_BODY()
+
+	/** Data identifier (DID). */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Ancillary, meta=(ClampMin = "0", ClampMax = "255"))
+	int32 DID;
+
+	/** Secondary data identifier (SDID), -1 to match any. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Ancillary, meta=(ClampMin = "-1", ClampMax = "255"))
+	int32 SDID;
+
+	FDeckLinkMediaAncillaryFilter()
+		: DID( 0 )
+		, SDID( -1 )
+	{ }
+};
+
+
+/** Media option names understood by the DeckLink player. */
+namespace DeckLinkMediaOption
+{
+	/** FString: display mode to capture by name, such as HD1080p5994. Empty captures HD1080p2398. */
+	DECKLINKMEDIA_API extern const FName DisplayMode;
+
+	/** int64: number of converted frames that may wait for the player. */
+	DECKLINKMEDIA_API extern const FName QueueDepth;
+
+	/** int64: an EDeckLinkMediaQueuePolicy value. */
+	DECKLINKMEDIA_API extern const FName QueuePolicy;
+
+	/** int64: number of audio channels to capture, 0 for none. */
+	DECKLINKMEDIA_API extern const FName AudioChannels;
+
+	/** int64: an EDeckLinkMediaAudioSampleType value. */
+	DECKLINKMEDIA_API extern const FName AudioSampleType;
+
+	/** FString: comma separated captured channel for each channel sent to the audio sink, -1 for silence. */
+	DECKLINKMEDIA_API extern const FName AudioChannelMap;
+
+	/** int64: how much later than its video the audio is presented, in FTimespan ticks. */
+	DECKLINKMEDIA_API extern const FName AudioOffset;
+
+	/** int64: how far audio may trail its video before samples are dropped to resync, in FTimespan ticks. */
+	DECKLINKMEDIA_API extern const FName AudioSyncTolerance;
+
+	/** int64: non-zero to read ancillary packets from the vertical blanking lines. */
+	DECKLINKMEDIA_API extern const FName AncillaryData;
+
+	/** FString: comma separated hex DID/SDID pairs, or a lone DID for any SDID. Empty keeps every packet. */
+	DECKLINKMEDIA_API extern const FName AncillaryFilter;
+
+	/** int64: first and last vertical blanking line searched for ancillary packets. */
+	DECKLINKMEDIA_API extern const FName AncillaryFirstLine;
+	DECKLINKMEDIA_API extern const FName AncillaryLastLine;
+}
+
+
 /**
  * Media source for EXR image sequences.
  */
@@ -50,9 +151,68 @@ public:
 	virtual FString GetUrl() const override;
 	virtual bool Validate() const override;
 
+	//~ IMediaOptions interface
+
+	virtual int64 GetMediaOption(const FName& Key, int64 DefaultValue) const override;
+	virtual FString GetMediaOption(const FName& Key, const FString& DefaultValue) const override;
+	virtual bool HasMediaOption(const FName& Key) const override;
+
+public:
+
+	/** Display mode to capture, by the name shown in the player stats such as HD1080p5994. Empty captures HD1080p2398. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Capture)
+	FString DisplayMode;
+
+	/** Number of captured frames buffered for the player, used by every policy except LatestOnly. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Capture, meta=(ClampMin = "1", ClampMax = "16", UIMin = "1", UIMax = "16"))
+	int32 QueueDepth;
+
+	/** What happens to captured frames when the queue is full. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Capture)
+	EDeckLinkMediaQueuePolicy QueuePolicy;
+
+	/** Embedded audio channels to capture at 48kHz. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Audio)
+	EDeckLinkMediaAudioChannels AudioChannels;
+
+	/** Sample format to capture embedded audio in. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Audio)
+	EDeckLinkMediaAudioSampleType AudioSampleType;
+
+	/**
+	 * For each channel sent to the audio sink, the captured channel it comes
+	 * from (starting at 0, -1 for silence). Empty sends every captured channel.
+	 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Audio)
+	TArray<int32> AudioChannelMap;
+
+	/** Milliseconds to delay audio against the video it was captured with, negative values play it early. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Audio, meta=(UIMin = "-500.0", UIMax = "500.0"))
+	float AudioOffset;
+
+	/** Milliseconds audio may trail its video before samples are dropped to bring it back in sync. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Audio, AdvancedDisplay, meta=(ClampMin = "0.0", UIMin = "0.0", UIMax = "100.0"))
+	float AudioSyncTolerance;
+
+	/** Read ancillary (VANC) packets and send them to the metadata sink. Captures 10-bit video while enabled. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Ancillary)
+	bool bCaptureAncillaryData;
+
+	/** Packets to keep; empty keeps every packet. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Ancillary)
+	TArray<FDeckLinkMediaAncillaryFilter> AncillaryFilter;
+
+	/** First vertical blanking line searched for packets. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Ancillary, AdvancedDisplay, meta=(ClampMin = "1"))
+	int32 AncillaryFirstLine;
+
+	/** Last vertical blanking line searched for packets. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category=Ancillary, AdvancedDisplay, meta=(ClampMin = "1"))
+	int32 AncillaryLastLine;
+
 protected:
 
-	/** Sdi device id, starting at 1. */
-	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category=SDI, meta=(ClampMin = "1.0", ClampMax = "8.0", UIMin = "1.0", UIMax = "8.0") )
+	/** Sdi device id, starting at 1 for cards and at 9 for virtual devices. */
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category=SDI, meta=(ClampMin = "1.0", ClampMax = "16.0", UIMin = "1.0", UIMax = "16.0") )
 	uint8 DeviceId;
 };
@@ -40,7 +40,8 @@ namespace UnrealBuildTool.Rules
 			}
 
 			if ((Target.Platform == UnrealTargetPlatform.Win32) ||
-				(Target.Platform == UnrealTargetPlatform.Win64))
+				(Target.Platform == UnrealTargetPlatform.Win64) ||
+				(Target.Platform == UnrealTargetPlatform.Linux))
 			{
 				DynamicallyLoadedModuleNames.Add("DeckLinkMedia");
 			}
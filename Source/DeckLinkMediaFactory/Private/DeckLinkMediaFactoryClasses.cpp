@@ -4,4 +4,11 @@
 
 
 UDeckLinkMediaSettings::UDeckLinkMediaSettings()
+	: FramePoolDepth(4)
+	, Converter(EDeckLinkMediaConverter::Native)
+	, ConverterInstructionSet(EDeckLinkMediaInstructionSet::Auto)
+	, ConversionWorkerThreads(3)
+	, ParallelConversionMinHeight(1080)
+	, VirtualDevices(0)
+	, VirtualDevicePattern(EDeckLinkMediaTestPattern::Bars)
 { }
@@ -8,6 +8,46 @@
 
 #include "DeckLinkMediaSettings.generated.h"
 
+
+/** Available implementations for converting captured frames to BGRA. */
+UENUM()
+enum class EDeckLinkMediaConverter : uint8
+{
+	/** In-plugin SIMD kernels, falling back to the SDK for unsupported pixel formats. */
+	Native,
+
+	/** Blackmagic SDK IDeckLinkVideoConversion. */
+	Sdk UMETA(DisplayName="SDK"),
+};
+
+
+/** Instruction sets the native converter can be limited to. */
+UENUM()
+enum class EDeckLinkMediaInstructionSet : uint8
+{
+	/** Widest instruction set supported by the CPU. */
+	Auto,
+	Scalar,
+	SSE41 UMETA(DisplayName="SSE4.1"),
+	AVX2,
+};
+
+
+/** Backgrounds a virtual device can generate. */
+UENUM()
+enum class EDeckLinkMediaTestPattern : uint8
+{
+	/** SMPTE colour bars. */
+	Bars,
+
+	/** Scrolling luma ramp. */
+	Ramp,
+
+	/** Moving circular zone plate, stresses scaling and compression. */
+	ZonePlate,
+};
+
+
 UCLASS(config=Engine)
 class DECKLINKMEDIAFACTORY_API UDeckLinkMediaSettings
 	: public UObject
@@ -18,4 +58,34 @@ public:
 	 
 	/** Default constructor. */
 	UDeckLinkMediaSettings();
+
+public:
+
+	/** Number of preallocated capture frames per device (minimum of three for latest-frame handoff). */
+	UPROPERTY(config, EditAnywhere, Category=Capture, meta=(ClampMin="3", ClampMax="32", UIMin="3", UIMax="32"))
+	int32 FramePoolDepth;
+
+	/** Which implementation converts captured frames for the video sink. */
+	UPROPERTY(config, EditAnywhere, Category=Conversion)
+	EDeckLinkMediaConverter Converter;
+
+	/** Limits the native converter to an instruction set, e.g. for profiling. */
+	UPROPERTY(config, EditAnywhere, Category=Conversion)
+	EDeckLinkMediaInstructionSet ConverterInstructionSet;
+
+	/** Worker threads per device that convert frame stripes alongside the capture thread (0 = serial, native converter only). */
+	UPROPERTY(config, EditAnywhere, Category=Conversion, meta=(ClampMin="0", ClampMax="16", UIMin="0", UIMax="16"))
+	int32 ConversionWorkerThreads;
+
+	/** Frames with fewer lines than this are converted serially, where waking workers costs more than it saves. */
+	UPROPERTY(config, EditAnywhere, Category=Conversion, meta=(ClampMin="0"))
+	int32 ParallelConversionMinHeight;
+
+	/** Software input devices, sdi://device9 and up, generating frames without hardware (takes effect on restart). */
+	UPROPERTY(config, EditAnywhere, Category="Virtual Devices", meta=(ClampMin="0", ClampMax="8", UIMin="0", UIMax="8"))
+	int32 VirtualDevices;
+
+	/** What the virtual devices show behind the moving box and frame counter. */
+	UPROPERTY(config, EditAnywhere, Category="Virtual Devices")
+	EDeckLinkMediaTestPattern VirtualDevicePattern;
 };